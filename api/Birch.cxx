@@ -36,7 +36,7 @@ int main( int argc, char** argv )
 
   try
   {
-    // start by reading the configuration, connecting to the database and setting up the Opal service
+    // start by reading the configuration, connecting to the database and setting up services
     Application *app = Application::GetInstance();
     if( !app->ReadConfiguration( BIRCH_CONFIG_FILE ) )
     {
@@ -51,6 +51,10 @@ int main( int argc, char** argv )
       return status;
     }
     app->SetupOpalService();
+    app->SetupScheduler();
+    app->SetupImageCache();
+    app->SetupRatingWriter();
+    app->SetupStudyFacetCache();
 
     // now create the user interface
     QBirchApplication qapp( argc, argv );
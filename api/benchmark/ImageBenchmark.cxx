@@ -0,0 +1,147 @@
+/*=========================================================================
+
+  Program:  Birch (CLSA Retinal Image Viewer)
+  Module:   ImageBenchmark.cxx
+  Language: C++
+
+  Author: Patrick Emond <emondpd@mcmaster.ca>
+  Author: Dean Inglis <inglisd@mcmaster.ca>
+
+=========================================================================*/
+//
+// .SECTION Description
+// Measures the time taken to go from an image file on disk to the first rendered
+// frame.  Each file is decoded by the reader chosen by the viewer's reader registry
+// and, for comparison, by the GDCM reader (when it can read the file).  The decode
+// time and load-to-first-frame time (decode, display and render off screen) are
+// reported, averaged over a number of repetitions.  Reduced resolution previews
+// are also timed for JPEG files.
+//
+// Usage: birch_image_benchmark [--repeat n] file [file ...]
+//
+
+#include "vtkGDCMImageReader.h"
+#include "vtkImageData.h"
+#include "vtkImageReader2.h"
+#include "vtkMedicalImageViewer.h"
+#include "vtkRenderWindow.h"
+#include "vtkSmartPointer.h"
+#include "vtkTimerLog.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+#include <vector>
+
+// decodes a file using a reader, returns the decode time or a negative number on failure
+double decode( vtkImageReader2 *reader, const char *fileName, vtkImageData *output )
+{
+  double startTime = vtkTimerLog::GetUniversalTime();
+  reader->SetFileName( fileName );
+  reader->Update();
+  double time = vtkTimerLog::GetUniversalTime() - startTime;
+  if( 0 == reader->GetOutput()->GetNumberOfPoints() ) return -1.0;
+  output->ShallowCopy( reader->GetOutput() );
+  return time;
+}
+
+// reports the average decode and first frame times of one reader
+void report( std::string reader, int repeat, double decodeTime, double frameTime )
+{
+  cout << "  " << reader << ":" << endl
+       << "    decode:      " << 1000.0 * decodeTime / repeat << " ms" << endl
+       << "    first frame: " << 1000.0 * frameTime / repeat << " ms" << endl;
+}
+
+// main function
+int main( int argc, char** argv )
+{
+  int repeat = 5;
+  bool usage = false;
+  std::vector< const char* > fileList;
+  for( int i = 1; i < argc; ++i )
+  {
+    if( 0 == strcmp( argv[i], "--repeat" ) && i + 1 < argc ) repeat = atoi( argv[++i] );
+    else if( '-' != argv[i][0] ) fileList.push_back( argv[i] );
+    else usage = true;
+  }
+  if( usage || fileList.empty() )
+  {
+    cerr << "Usage: " << argv[0] << " [--repeat n] file [file ...]" << endl;
+    return EXIT_FAILURE;
+  }
+  if( 1 > repeat ) repeat = 1;
+
+  vtkSmartPointer< vtkMedicalImageViewer > viewer = vtkSmartPointer< vtkMedicalImageViewer >::New();
+  viewer->GetRenderWindow()->OffScreenRenderingOn();
+  viewer->GetRenderWindow()->SetSize( 800, 600 );
+
+  int status = EXIT_SUCCESS;
+  std::vector< const char* >::iterator it;
+  for( it = fileList.begin(); it != fileList.end(); ++it )
+  {
+    int format = vtkMedicalImageViewer::GetFileFormat( *it );
+    cout << *it << " (" << vtkMedicalImageViewer::GetFileFormatName( format ) << "):" << endl;
+
+    // the reader chosen by the registry, then the GDCM reader used for every format in the past
+    for( int pass = 0; pass < 2; ++pass )
+    {
+      std::string name;
+      double decodeTime = 0.0, frameTime = 0.0;
+      bool success = true;
+      for( int i = 0; i < repeat && success; ++i )
+      {
+        // use a new reader every time so that nothing is cached between repetitions
+        vtkSmartPointer< vtkImageReader2 > reader;
+        if( 0 == pass ) reader.TakeReference( vtkMedicalImageViewer::CreateReader( *it ) );
+        else
+        {
+          reader.TakeReference( vtkGDCMImageReader::New() );
+          if( !reader->CanReadFile( *it ) ) reader = NULL;
+        }
+        if( !reader ) { success = false; break; }
+        name = reader->GetClassName();
+
+        double startTime = vtkTimerLog::GetUniversalTime();
+        vtkSmartPointer< vtkImageData > image = vtkSmartPointer< vtkImageData >::New();
+        double time = decode( reader, *it, image );
+        if( 0.0 > time ) { success = false; break; }
+        viewer->SetInput( image );
+        viewer->GetRenderWindow()->Render();
+        decodeTime += time;
+        frameTime += vtkTimerLog::GetUniversalTime() - startTime;
+      }
+
+      if( success ) report( name, repeat, decodeTime, frameTime );
+      else if( 0 == pass )
+      {
+        cout << "  unable to read file" << endl;
+        status = EXIT_FAILURE;
+        break;
+      }
+      else cout << "  vtkGDCMImageReader: unable to read file" << endl;
+    }
+
+    // reduced resolution previews (JPEG only)
+    for( int factor = 2; vtkMedicalImageViewer::FORMAT_JPEG == format && factor <= 8; factor *= 2 )
+    {
+      double decodeTime = 0.0, frameTime = 0.0;
+      for( int i = 0; i < repeat; ++i )
+      {
+        double startTime = vtkTimerLog::GetUniversalTime();
+        vtkSmartPointer< vtkImageData > image = vtkSmartPointer< vtkImageData >::New();
+        vtkMedicalImageViewer::ReadPreviewImage( *it, image, factor );
+        decodeTime += vtkTimerLog::GetUniversalTime() - startTime;
+        viewer->SetInput( image );
+        viewer->GetRenderWindow()->Render();
+        frameTime += vtkTimerLog::GetUniversalTime() - startTime;
+      }
+
+      std::stringstream stream;
+      stream << "preview 1/" << factor;
+      report( stream.str(), repeat, decodeTime, frameTime );
+    }
+  }
+
+  return status;
+}
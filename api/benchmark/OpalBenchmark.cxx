@@ -0,0 +1,151 @@
+/*=========================================================================
+
+  Program:  Birch (CLSA Retinal Image Viewer)
+  Module:   OpalBenchmark.cxx
+  Language: C++
+
+  Author: Patrick Emond <emondpd@mcmaster.ca>
+  Author: Dean Inglis <inglisd@mcmaster.ca>
+
+=========================================================================*/
+//
+// .SECTION Description
+// Measures the throughput of the Opal service.  Identifiers, value pages and
+// per-entity values (one valueSet request per entity) are requested from the Opal server defined in the
+// configuration file (normally a local aux/opal_stub.py) and, optionally, the study
+// database is synchronized end to end.  The number of pages, bytes and time taken by
+// each stage is reported.
+//
+// Usage: birch_opal_benchmark [--batch-size n] [--sync]
+//
+
+#include "Application.h"
+#include "OpalService.h"
+#include "StudySyncJob.h"
+#include "Utilities.h"
+
+#include "vtkSmartPointer.h"
+#include "vtkTimerLog.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <stdexcept>
+#include <vector>
+
+using namespace Birch;
+
+// reports the statistics of one benchmark stage
+void report( std::string stage, OpalService *opal, double wallTime )
+{
+  int pages = opal->GetNumberOfRequests();
+  double bytes = opal->GetNumberOfBytesRead();
+  cout << stage << ":" << endl
+       << "  pages:     " << pages << endl
+       << "  bytes:     " << bytes << endl
+       << "  wall time: " << wallTime << " s" << endl
+       << "  pages/sec: " << ( 0.0 < wallTime ? pages / wallTime : 0.0 ) << endl
+       << "  bytes/sec: " << ( 0.0 < wallTime ? bytes / wallTime : 0.0 ) << endl;
+}
+
+// main function
+int main( int argc, char** argv )
+{
+  int batchSize = 100;
+  bool sync = false;
+  for( int i = 1; i < argc; ++i )
+  {
+    if( 0 == strcmp( argv[i], "--sync" ) ) sync = true;
+    else if( 0 == strcmp( argv[i], "--batch-size" ) && i + 1 < argc ) batchSize = atoi( argv[++i] );
+    else
+    {
+      cerr << "Usage: " << argv[0] << " [--batch-size n] [--sync]" << endl;
+      return EXIT_FAILURE;
+    }
+  }
+  if( 1 > batchSize ) batchSize = 100;
+
+  try
+  {
+    Application *app = Application::GetInstance();
+    if( !app->ReadConfiguration( BIRCH_CONFIG_FILE ) )
+    {
+      cerr << "ERROR: error while reading configuration file \"" << BIRCH_CONFIG_FILE << "\"" << endl;
+      Application::DeleteInstance();
+      return EXIT_FAILURE;
+    }
+    if( sync && !app->ConnectToDatabase() )
+    {
+      cerr << "ERROR: error while connecting to the database" << endl;
+      Application::DeleteInstance();
+      return EXIT_FAILURE;
+    }
+    app->SetupOpalService();
+
+    OpalService *opal = app->GetOpal();
+    vtkSmartPointer< StudySyncJob > job = vtkSmartPointer< StudySyncJob >::New();
+    job->SetBatchSize( batchSize );
+    double totalStartTime = vtkTimerLog::GetUniversalTime();
+
+    // the identifier list is a single (large) request
+    opal->ResetStatistics();
+    double startTime = vtkTimerLog::GetUniversalTime();
+    std::vector< std::string > identifierList =
+      opal->GetIdentifiers( job->GetIdentifierDataSource(), job->GetIdentifierTable() );
+    report( "GetIdentifiers", opal, vtkTimerLog::GetUniversalTime() - startTime );
+    cout << "  entities:  " << identifierList.size() << endl;
+
+    // value lists are paged, request pages until Opal returns an empty one (the server
+    // may return fewer value sets than requested, so the offset advances by the number
+    // actually returned)
+    opal->ResetStatistics();
+    startTime = vtkTimerLog::GetUniversalTime();
+    int count = 0;
+    for( int offset = 0; ; )
+    {
+      int pageSize = 0;
+      std::map< std::string, std::string > valueList = opal->GetValueList(
+        job->GetValueDataSource(), job->GetValueTable(), "InstrumentRun.user",
+        offset, batchSize, &pageSize );
+      if( 0 == pageSize ) break;
+      offset += pageSize;
+      count += valueList.size();
+    }
+    report( "GetValueList", opal, vtkTimerLog::GetUniversalTime() - startTime );
+    cout << "  values:    " << count << endl;
+
+    // per-entity values are requested one entity at a time, as Opal can't select entities
+    // from a valueSets request (using a variable which isn't memoized yet)
+    opal->ResetStatistics();
+    opal->SetMaxBatchSize( batchSize );
+    startTime = vtkTimerLog::GetUniversalTime();
+    std::map< std::string, std::string > valueList = opal->GetValues(
+      job->GetValueDataSource(), job->GetValueTable(), "InstrumentRun.timeStart", identifierList );
+    report( "GetValues", opal, vtkTimerLog::GetUniversalTime() - startTime );
+    cout << "  values:    " << valueList.size() << endl;
+    opal->ClearCache();
+
+    // run the study synchronization on this thread (it uses the main database connection)
+    if( sync )
+    {
+      opal->ResetStatistics();
+      startTime = vtkTimerLog::GetUniversalTime();
+      job->Reset();
+      job->Run( NULL );
+      report( "StudySyncJob", opal, vtkTimerLog::GetUniversalTime() - startTime );
+      cout << "  studies:   " << job->GetNumberOfStudiesWritten() << endl;
+      if( Job::FAILED == job->GetState() )
+        throw std::runtime_error( job->GetErrorMessage() );
+    }
+
+    cout << "Total wall time: " << vtkTimerLog::GetUniversalTime() - totalStartTime << " s" << endl;
+    Application::DeleteInstance();
+  }
+  catch( std::exception &e )
+  {
+    cerr << "Uncaught exception: " << e.what() << endl;
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,171 @@
+/*=========================================================================
+
+  Program:  Birch (CLSA Retinal Image Viewer)
+  Module:   WindowLevelBenchmark.cxx
+  Language: C++
+
+  Author: Patrick Emond <emondpd@mcmaster.ca>
+  Author: Dean Inglis <inglisd@mcmaster.ca>
+
+=========================================================================*/
+//
+// .SECTION Description
+// Measures window/level performance during an interactive drag.  A drag is
+// simulated by changing the window and level a number of times, mapping the
+// whole image with the generic VTK filter and with the viewer's dedicated filter,
+// then rendering the viewer off screen after every change.  Maps/sec and
+// frames/sec are reported, along with the scaling of the dedicated filter from
+// one thread up to the number of processors (or --threads n).
+//
+// The image is either read from a file or generated (--type uchar|ushort with
+// --components 1|3 and --size width height).
+//
+// Usage: birch_window_level_benchmark [--steps n] [--threads n] [--type t]
+//                                     [--components c] [--size w h] [file]
+//
+
+#include "vtkBirchImageMapToWindowLevelColors.h"
+#include "vtkImageData.h"
+#include "vtkImageMapToWindowLevelColors.h"
+#include "vtkMedicalImageViewer.h"
+#include "vtkMultiThreader.h"
+#include "vtkPointData.h"
+#include "vtkRenderWindow.h"
+#include "vtkSmartPointer.h"
+#include "vtkTimerLog.h"
+
+#include <cstdlib>
+#include <cstring>
+
+// fills an image with a smooth ramp plus noise (roughly like a fundus image)
+void generate( vtkImageData *image, int type, int components, int width, int height )
+{
+  image->SetDimensions( width, height, 1 );
+  image->SetScalarType( type );
+  image->SetNumberOfScalarComponents( components );
+  image->AllocateScalars();
+
+  double max = VTK_UNSIGNED_CHAR == type ? VTK_UNSIGNED_CHAR_MAX : 4095.0;
+  vtkIdType size = static_cast<vtkIdType>( width ) * height * components;
+  vtkDataArray *scalars = image->GetPointData()->GetScalars();
+  for( vtkIdType i = 0; i < size; ++i )
+  {
+    double value = max * ( ( i / components ) % width ) / width + rand() % 16;
+    scalars->SetComponent( i / components, i % components, value > max ? max : value );
+  }
+}
+
+// maps the whole image repeatedly while changing the window, returns maps/sec
+double mapRate( vtkImageMapToWindowLevelColors *filter, vtkImageData *image, int steps, double range )
+{
+  filter->SetInput( image );
+  filter->SetOutputFormatToLuminance();
+  if( 3 <= image->GetNumberOfScalarComponents() ) filter->SetOutputFormatToRGB();
+
+  double startTime = vtkTimerLog::GetUniversalTime();
+  for( int i = 0; i < steps; ++i )
+  {
+    filter->SetWindow( range * ( 0.25 + 0.75 * ( i + 1 ) / steps ) );
+    filter->SetLevel( range * ( 0.25 + 0.5 * ( i + 1 ) / steps ) );
+    filter->Update();
+  }
+  double time = vtkTimerLog::GetUniversalTime() - startTime;
+  return 0.0 < time ? steps / time : 0.0;
+}
+
+// main function
+int main( int argc, char** argv )
+{
+  int threads = vtkMultiThreader::GetGlobalDefaultNumberOfThreads();
+  int steps = 100, type = VTK_UNSIGNED_CHAR, components = 1, width = 3888, height = 2592;
+  const char *fileName = NULL;
+  bool usage = false;
+  for( int i = 1; i < argc; ++i )
+  {
+    if( 0 == strcmp( argv[i], "--steps" ) && i + 1 < argc ) steps = atoi( argv[++i] );
+    else if( 0 == strcmp( argv[i], "--threads" ) && i + 1 < argc ) threads = atoi( argv[++i] );
+    else if( 0 == strcmp( argv[i], "--components" ) && i + 1 < argc ) components = atoi( argv[++i] );
+    else if( 0 == strcmp( argv[i], "--size" ) && i + 2 < argc )
+    {
+      width = atoi( argv[++i] );
+      height = atoi( argv[++i] );
+    }
+    else if( 0 == strcmp( argv[i], "--type" ) && i + 1 < argc )
+    {
+      ++i;
+      if( 0 == strcmp( argv[i], "uchar" ) ) type = VTK_UNSIGNED_CHAR;
+      else if( 0 == strcmp( argv[i], "ushort" ) ) type = VTK_UNSIGNED_SHORT;
+      else usage = true;
+    }
+    else if( '-' != argv[i][0] && !fileName ) fileName = argv[i];
+    else usage = true;
+  }
+  if( usage || 1 > steps || 1 > threads || 1 > width || 1 > height || ( 1 != components && 3 != components ) )
+  {
+    cerr << "Usage: " << argv[0] << " [--steps n] [--threads n] [--type uchar|ushort] [--components 1|3] "
+         << "[--size width height] [file]" << endl;
+    return EXIT_FAILURE;
+  }
+
+  vtkSmartPointer< vtkImageData > image = vtkSmartPointer< vtkImageData >::New();
+  if( fileName )
+  {
+    if( !vtkMedicalImageViewer::ReadImage( fileName, image ) )
+    {
+      cerr << "ERROR: unable to read image file \"" << fileName << "\"" << endl;
+      return EXIT_FAILURE;
+    }
+  }
+  else generate( image, type, components, width, height );
+
+  int *dims = image->GetDimensions();
+  double *range = image->GetScalarRange();
+  cout << "image: " << dims[0] << "x" << dims[1] << ", " << image->GetScalarTypeAsString()
+       << ", " << image->GetNumberOfScalarComponents() << " component(s)" << endl
+       << "kernel: " << vtkBirchImageMapToWindowLevelColors::GetInstructionSet()
+       << ( vtkBirchImageMapToWindowLevelColors::IsFastScalarType( image->GetScalarType() ) ?
+            "" : " (not used for this scalar type)" ) << endl;
+
+  // filters on their own, mapping the whole image
+  vtkSmartPointer< vtkImageMapToWindowLevelColors > generic =
+    vtkSmartPointer< vtkImageMapToWindowLevelColors >::New();
+  vtkSmartPointer< vtkBirchImageMapToWindowLevelColors > dedicated =
+    vtkSmartPointer< vtkBirchImageMapToWindowLevelColors >::New();
+  double genericRate = mapRate( generic, image, steps, range[1] - range[0] );
+  double dedicatedRate = mapRate( dedicated, image, steps, range[1] - range[0] );
+  cout << "vtkImageMapToWindowLevelColors:      " << genericRate << " maps/sec" << endl
+       << "vtkBirchImageMapToWindowLevelColors: " << dedicatedRate << " maps/sec" << endl;
+
+  // the dedicated filter's scaling with the number of threads mapping slabs
+  cout << "thread scaling:" << endl;
+  double singleRate = 0.0;
+  for( int n = 1; n <= threads; ++n )
+  {
+    dedicated->SetNumberOfThreads( n );
+    double rate = mapRate( dedicated, image, steps, range[1] - range[0] );
+    if( 1 == n ) singleRate = rate;
+    cout << "  " << n << " thread(s): " << rate << " maps/sec ("
+         << ( 0.0 < singleRate ? rate / singleRate : 0.0 ) << "x)" << endl;
+  }
+
+  // the viewer during a window/level drag (including the texture upload and render)
+  vtkSmartPointer< vtkMedicalImageViewer > viewer = vtkSmartPointer< vtkMedicalImageViewer >::New();
+  viewer->GetRenderWindow()->OffScreenRenderingOn();
+  viewer->GetRenderWindow()->SetSize( 1024, 768 );
+  viewer->SetInput( image );
+  viewer->GetRenderWindow()->Render();
+
+  double window = viewer->GetColorWindow(), level = viewer->GetColorLevel();
+  double startTime = vtkTimerLog::GetUniversalTime();
+  for( int i = 0; i < steps; ++i )
+  {
+    double factor = 0.5 + 0.5 * ( i + 1 ) / steps;
+    viewer->SetColorWindowLevel( window * factor, level * factor );
+    viewer->GetRenderWindow()->Render();
+  }
+  double time = vtkTimerLog::GetUniversalTime() - startTime;
+  cout << "vtkMedicalImageViewer:               " << ( 0.0 < time ? steps / time : 0.0 )
+       << " frames/sec" << endl;
+
+  return EXIT_SUCCESS;
+}
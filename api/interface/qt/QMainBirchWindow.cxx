@@ -12,9 +12,16 @@
 #include "ui_QMainBirchWindow.h"
 
 #include "Application.h"
+#include "Configuration.h"
 #include "Image.h"
-#include "Rating.h"
+#include "ImageCache.h"
+#include "JobScheduler.h"
+#include "RatingWriter.h"
+#include "ReviewQueue.h"
 #include "Study.h"
+#include "StudyLease.h"
+#include "StudyPrioritizeJob.h"
+#include "StudySyncJob.h"
 #include "User.h"
 
 #include "vtkMedicalImageViewer.h"
@@ -23,14 +30,24 @@
 #include "QLoginDialog.h"
 #include "QProgressDialog.h"
 #include "QSelectStudyDialog.h"
+#include "QStudyTreeModel.h"
 #include "QUserListDialog.h"
 
 #include <QCloseEvent>
+#include <QHeaderView>
 #include <QInputDialog>
+#include <QItemSelectionModel>
+#include <QLabel>
 #include <QMessageBox>
+#include <QProgressBar>
+#include <QPushButton>
 #include <QSettings>
-#include <QTreeWidgetItem>
+#include <QShortcut>
+#include <QSignalMapper>
+#include <QStatusBar>
+#include <QTimer>
 
+#include <algorithm>
 #include <stdexcept>
 
 //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
@@ -44,7 +61,64 @@ QMainBirchWindow::QMainBirchWindow( QWidget* parent )
   this->ui->setupUi( this );
   
   // set up child widgets
-  this->ui->studyTreeWidget->header()->hide();
+  this->studyTreeModel = new QStudyTreeModel( this );
+  this->ui->studyTreeView->setModel( this->studyTreeModel );
+  this->ui->studyTreeView->header()->hide();
+  this->ui->studyTreeView->setSelectionMode( QAbstractItemView::SingleSelection );
+
+  // background jobs report their progress in the status bar
+  this->jobProgressBar = new QProgressBar( this );
+  this->jobProgressBar->setRange( 0, 100 );
+  this->jobProgressBar->setMaximumWidth( 200 );
+  this->jobProgressBar->setVisible( false );
+  this->ui->statusbar->addPermanentWidget( this->jobProgressBar );
+  this->jobCancelPushButton = new QPushButton( tr( "Cancel" ), this );
+  this->jobCancelPushButton->setVisible( false );
+  this->ui->statusbar->addPermanentWidget( this->jobCancelPushButton );
+
+  // rapid rating shows its throughput in the status bar, its shortcuts are only
+  // enabled while it is on
+  this->throughputLabel = new QLabel( this );
+  this->throughputLabel->setVisible( false );
+  this->ui->statusbar->addPermanentWidget( this->throughputLabel );
+  this->ratingShortcutMapper = new QSignalMapper( this );
+  for( int value = 1; value <= this->ui->ratingSlider->maximum(); ++value )
+  {
+    QShortcut *shortcut = new QShortcut( QKeySequence( Qt::Key_0 + value ), this );
+    shortcut->setEnabled( false );
+    this->ratingShortcutMapper->setMapping( shortcut, value );
+    QObject::connect(
+      shortcut, SIGNAL( activated() ),
+      this->ratingShortcutMapper, SLOT( map() ) );
+    this->ratingShortcuts.push_back( shortcut );
+  }
+  this->imageTime.start();
+
+  this->studySyncJob = vtkSmartPointer< Birch::StudySyncJob >::New();
+  this->prioritizeJob = vtkSmartPointer< Birch::StudyPrioritizeJob >::New();
+  this->jobObserver = vtkSmartPointer< Command >::New();
+  this->jobObserver->window = this;
+  Birch::JobScheduler *scheduler = app->GetScheduler();
+  scheduler->AddObserver( Birch::JobScheduler::JobStartedEvent, this->jobObserver );
+  scheduler->AddObserver( Birch::JobScheduler::JobProgressEvent, this->jobObserver );
+  scheduler->AddObserver( Birch::JobScheduler::JobFinishedEvent, this->jobObserver );
+  scheduler->AddObserver( Birch::JobScheduler::JobDataEvent, this->jobObserver );
+
+  // each part of the interface is refreshed when the application state it shows changes
+  this->applicationObserver = vtkSmartPointer< Command >::New();
+  this->applicationObserver->window = this;
+  app->AddObserver( Birch::Application::ActiveUserChangedEvent, this->applicationObserver );
+  app->AddObserver( Birch::Application::ActiveStudyChangedEvent, this->applicationObserver );
+  app->AddObserver( Birch::Application::ActiveImageChangedEvent, this->applicationObserver );
+  app->AddObserver( Birch::Application::RatingChangedEvent, this->applicationObserver );
+
+  // synchronize the study database periodically if requested by the configuration
+  double interval = vtkVariant( app->GetConfig()->GetValue( "Opal", "SyncInterval" ) ).ToDouble();
+  if( 0 < interval ) scheduler->SubmitRepeating( this->studySyncJob, 60.0 * interval );
+
+  // job events are delivered on the GUI thread by polling the scheduler
+  this->jobTimer = new QTimer( this );
+  this->jobTimer->setInterval( 100 );
 
   // connect the menu items
   QObject::connect(
@@ -56,6 +130,12 @@ QMainBirchWindow::QMainBirchWindow( QWidget* parent )
   QObject::connect(
     this->ui->actionNextStudy, SIGNAL( triggered() ),
     this, SLOT( slotNextStudy() ) );
+  QObject::connect(
+    this->ui->actionRapidRating, SIGNAL( toggled( bool ) ),
+    this, SLOT( slotRapidRating( bool ) ) );
+  QObject::connect(
+    this->ratingShortcutMapper, SIGNAL( mapped( int ) ),
+    this, SLOT( slotRapidRate( int ) ) );
   QObject::connect(
     this->ui->actionLogin, SIGNAL( triggered() ),
     this, SLOT( slotLogin() ) );
@@ -65,6 +145,9 @@ QMainBirchWindow::QMainBirchWindow( QWidget* parent )
   QObject::connect(
     this->ui->actionUpdateStudyDatabase, SIGNAL( triggered() ),
     this, SLOT( slotUpdateStudyDatabase() ) );
+  QObject::connect(
+    this->ui->actionPrioritizeStudies, SIGNAL( triggered() ),
+    this, SLOT( slotPrioritizeStudies() ) );
   QObject::connect(
     this->ui->actionExit, SIGNAL( triggered() ),
     qApp, SLOT( closeAllWindows() ) );
@@ -84,11 +167,22 @@ QMainBirchWindow::QMainBirchWindow( QWidget* parent )
     this->ui->nextStudyPushButton, SIGNAL( clicked() ),
     this, SLOT( slotNextStudy() ) );
   QObject::connect(
-    this->ui->studyTreeWidget, SIGNAL( itemSelectionChanged() ),
+    this->ui->studyTreeView->selectionModel(),
+    SIGNAL( selectionChanged( const QItemSelection&, const QItemSelection& ) ),
     this, SLOT( slotTreeSelectionChanged() ) );
   QObject::connect(
     this->ui->ratingSlider, SIGNAL( valueChanged( int ) ),
     this, SLOT( slotRatingSliderChanged( int ) ) );
+  QObject::connect(
+    this->jobCancelPushButton, SIGNAL( clicked() ),
+    this, SLOT( slotCancelJobs() ) );
+  QObject::connect(
+    this->ui->medicalImageWidget, SIGNAL( imageLoadFailed( const QString& ) ),
+    this, SLOT( slotImageLoadFailed( const QString& ) ), Qt::QueuedConnection );
+  QObject::connect(
+    this->jobTimer, SIGNAL( timeout() ),
+    this, SLOT( slotProcessJobEvents() ) );
+  this->jobTimer->start();
 
   this->readSettings();
   this->updateInterface();
@@ -97,6 +191,12 @@ QMainBirchWindow::QMainBirchWindow( QWidget* parent )
 //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
 QMainBirchWindow::~QMainBirchWindow()
 {
+  Birch::Application::GetInstance()->RemoveObserver( this->applicationObserver );
+  Birch::JobScheduler *scheduler = Birch::Application::GetInstance()->GetScheduler();
+  scheduler->RemoveObserver( this->jobObserver );
+  scheduler->RemoveRepeating( this->studySyncJob );
+  this->studySyncJob->Cancel();
+  this->prioritizeJob->Cancel();
 }
 
 //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
@@ -117,9 +217,6 @@ void QMainBirchWindow::slotOpenStudy()
     dialog.setModal( true );
     dialog.setWindowTitle( tr( "Select Study" ) );
     dialog.exec();
-
-    // active study may have changed so update the interface
-    this->updateInterface();
   }
 }
 
@@ -167,11 +264,7 @@ void QMainBirchWindow::slotPreviousStudy()
     }
   }
 
-  if( found )
-  {
-    app->SetActiveStudy( study );
-    this->updateInterface();
-  }
+  if( found ) app->SetActiveStudy( study );
 }
 
 //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
@@ -184,30 +277,31 @@ void QMainBirchWindow::slotNextStudy()
   vtkSmartPointer< Birch::Study > study;
   if( user && activeStudy )
   {
-    // check if unrated checkbox is pressed, keep searching for an unrated study
+    // check if unrated checkbox is pressed, get the next study which needs rating
     if( this->ui->unratedCheckBox->isChecked() )
     {
-      int currentStudyId = activeStudy->Get( "id" ).ToInt();
-
-      // keep getting the previous study until we find one that has images which are not rated
-      study = activeStudy->GetNext();
-      while( study->Get( "id" ).ToInt() != currentStudyId )
+      // the study is leased to this user so that other raters are given different ones
+      QString error;
+      try
       {
-        if( 0 < study->GetCount( "Image" ) && !study->IsRatedBy( user ) )
-        {
-          found = true;
-          break;
-        }
-        study = study->GetNext();
+        study = this->claimNextStudy();
+      }
+      catch( std::exception &e )
+      {
+        error = tr( "Unable to get the next unrated study: %1" ).arg( e.what() );
       }
 
+      // the active study is only handed back if it is the only one left
+      found = study && study->Get( "id" ).ToInt() != activeStudy->Get( "id" ).ToInt();
+
       // warn user if no unrated studies left
-      if( study->Get( "id" ).ToInt() == currentStudyId )
+      if( !found )
       {
         QMessageBox errorMessage( this );
         errorMessage.setWindowModality( Qt::WindowModal );
         errorMessage.setIcon( QMessageBox::Warning );
-        errorMessage.setText( tr( "There are no remaining unrated studies available at this time." ) );
+        errorMessage.setText( error.isEmpty() ?
+          tr( "There are no remaining unrated studies available at this time." ) : error );
         errorMessage.exec();
       }
     }
@@ -218,11 +312,26 @@ void QMainBirchWindow::slotNextStudy()
     }
   }
 
-  if( found )
-  {
-    app->SetActiveStudy( study );
-    this->updateInterface();
-  }
+  if( found ) app->SetActiveStudy( study );
+}
+
+//-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+vtkSmartPointer< Birch::Study > QMainBirchWindow::claimNextStudy()
+{
+  Birch::Application *app = Birch::Application::GetInstance();
+  Birch::Configuration *config = app->GetConfig();
+  int duration = vtkVariant( config->GetValue( "StudyAssignment", "LeaseDuration" ) ).ToInt();
+  int ratingsPerImage = vtkVariant( config->GetValue( "StudyAssignment", "RatingsPerImage" ) ).ToInt();
+
+  // the claim skips rated studies, so the ratings of the active study must be written
+  // first or it may be handed back as unrated
+  app->GetRatingWriter()->FlushNow();
+
+  return Birch::StudyLease::Claim(
+    app->GetActiveUser(),
+    app->GetActiveStudy(),
+    0 < duration ? duration : 30,
+    0 < ratingsPerImage ? ratingsPerImage : 1 );
 }
 
 //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
@@ -241,9 +350,6 @@ void QMainBirchWindow::slotLogin()
     dialog.setWindowTitle( tr( "Login" ) );
     dialog.exec();
   }
-
-  // active user may have changed so update the interface
-  this->updateInterface();
 }
 
 //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
@@ -281,7 +387,19 @@ void QMainBirchWindow::slotUserManagement()
 //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
 void QMainBirchWindow::slotUpdateStudyDatabase()
 {
-/* TODO: implement once Opal is ready
+  Birch::JobScheduler *scheduler = Birch::Application::GetInstance()->GetScheduler();
+
+  // only one update may run at a time
+  if( scheduler->IsPending( this->studySyncJob ) )
+  {
+    QMessageBox errorMessage( this );
+    errorMessage.setWindowModality( Qt::WindowModal );
+    errorMessage.setIcon( QMessageBox::Information );
+    errorMessage.setText( tr( "The study database is already being updated." ) );
+    errorMessage.exec();
+    return;
+  }
+
   int attempt = 1;
 
   while( attempt < 4 )
@@ -289,7 +407,7 @@ void QMainBirchWindow::slotUpdateStudyDatabase()
     // check for admin password
     QString text = QInputDialog::getText(
       this,
-      QObject::tr( "User Management" ),
+      QObject::tr( "Update Study Database" ),
       QObject::tr( attempt > 1 ? "Wrong password, try again:" : "Administrator password:" ),
       QLineEdit::Password );
     
@@ -300,19 +418,80 @@ void QMainBirchWindow::slotUpdateStudyDatabase()
     user->Load( "name", "administrator" );
     if( user->IsPassword( text.toStdString().c_str() ) )
     {
-      // create a progress dialog to observe the progress of the update
-      QProgressDialog dialog( this );
-      dialog.setModal( true );
-      dialog.setWindowTitle( tr( "Updating Study Database" ) );
-      dialog.setMessage( tr( "Please wait while the study database is updated." ) );
-      dialog.open();
-      Birch::Study::UpdateData();
-      dialog.accept();
+      // the update runs in the background, its progress is shown in the status bar
+      scheduler->Submit( this->studySyncJob );
       break;
     }
     attempt++;
   }
-*/
+}
+
+//-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+void QMainBirchWindow::slotPrioritizeStudies()
+{
+  Birch::JobScheduler *scheduler = Birch::Application::GetInstance()->GetScheduler();
+
+  // only one prioritization may run at a time
+  if( scheduler->IsPending( this->prioritizeJob ) )
+  {
+    QMessageBox errorMessage( this );
+    errorMessage.setWindowModality( Qt::WindowModal );
+    errorMessage.setIcon( QMessageBox::Information );
+    errorMessage.setText( tr( "The studies are already being prioritized." ) );
+    errorMessage.exec();
+    return;
+  }
+
+  int attempt = 1;
+
+  while( attempt < 4 )
+  {
+    // check for admin password
+    QString text = QInputDialog::getText(
+      this,
+      QObject::tr( "Prioritize Studies" ),
+      QObject::tr( attempt > 1 ? "Wrong password, try again:" : "Administrator password:" ),
+      QLineEdit::Password );
+    
+    // do nothing if the user hit the cancel button
+    if( text.isEmpty() ) break;
+
+    vtkSmartPointer< Birch::User > user = vtkSmartPointer< Birch::User >::New();
+    user->Load( "name", "administrator" );
+    if( user->IsPassword( text.toStdString().c_str() ) )
+    {
+      // the items are in the same order as the review queue's policies
+      QStringList policies;
+      policies << tr( "UID order" )
+               << tr( "Oldest acquisition first" )
+               << tr( "Sites with the largest backlog first" )
+               << tr( "Images needing another rating first" );
+
+      bool ok;
+      QString item = QInputDialog::getItem(
+        this,
+        QObject::tr( "Prioritize Studies" ),
+        QObject::tr( "Review studies in this order:" ),
+        policies, 0, false, &ok );
+      if( ok ) this->prioritizeStudies( policies.indexOf( item ) );
+      break;
+    }
+    attempt++;
+  }
+}
+
+//-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+void QMainBirchWindow::prioritizeStudies( int policy, bool keepCurrent )
+{
+  Birch::Application *app = Birch::Application::GetInstance();
+  if( app->GetScheduler()->IsPending( this->prioritizeJob ) ) return;
+
+  int ratingsPerImage =
+    vtkVariant( app->GetConfig()->GetValue( "StudyAssignment", "RatingsPerImage" ) ).ToInt();
+  this->prioritizeJob->SetPolicy( policy );
+  this->prioritizeJob->SetKeepCurrentPolicy( keepCurrent );
+  this->prioritizeJob->SetRatingsPerImage( 0 < ratingsPerImage ? ratingsPerImage : 1 );
+  app->GetScheduler()->Submit( this->prioritizeJob );
 }
 
 //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
@@ -348,48 +527,268 @@ void QMainBirchWindow::slotTreeSelectionChanged()
 {
   Birch::Application *app = Birch::Application::GetInstance();
   
-  QList<QTreeWidgetItem*> list = this->ui->studyTreeWidget->selectedItems();
+  QModelIndexList list = this->ui->studyTreeView->selectionModel()->selectedIndexes();
   if( 0 < list.size() )
   {
-    std::map< QTreeWidgetItem*, vtkSmartPointer<Birch::ActiveRecord> >::iterator it;
-    it = this->treeModelMap.find( list.at( 0 ) );
-    if( it != this->treeModelMap.end() )
-    {
-      Birch::ActiveRecord *record = it->second;
-      app->SetActiveImage( Birch::Image::SafeDownCast( record ) );
-    }
+    Birch::Image *image = this->studyTreeModel->image( list.at( 0 ) );
+    if( image ) app->SetActiveImage( image );
   }
-
-  this->updateInterface();
 }
 
 //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
 void QMainBirchWindow::slotRatingSliderChanged( int value )
+{
+  Birch::Application::GetInstance()->RateActiveImage( value );
+}
+
+//-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+void QMainBirchWindow::slotRapidRating( bool checked )
+{
+  std::vector< QShortcut* >::iterator it;
+  for( it = this->ratingShortcuts.begin(); it != this->ratingShortcuts.end(); ++it )
+    ( *it )->setEnabled( checked );
+
+  if( checked )
+  {
+    this->ratingTimes.clear();
+    this->rapidRatingTime.start();
+    this->imageTime.start();
+
+    // start with the first unrated image if none is selected
+    if( NULL == Birch::Application::GetInstance()->GetActiveImage() ) this->advanceToUnrated();
+  }
+
+  this->throughputLabel->setVisible( checked );
+  this->updateThroughput();
+}
+
+//-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+void QMainBirchWindow::slotRapidRate( int value )
 {
   Birch::Application *app = Birch::Application::GetInstance();
+  if( NULL == app->GetActiveUser() || NULL == app->GetActiveImage() ) return;
+
+  // the rating is queued and written in the background once the next image is made
+  // active (or right away when a study is claimed), and the next image will usually
+  // have been decoded by the prefetcher
+  this->ratingTimes.push_back( this->imageTime.elapsed() );
+  app->RateActiveImage( value );
+  this->advanceToUnrated();
+  this->updateThroughput();
+}
 
-  // make sure we have an active image
+//-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+void QMainBirchWindow::advanceToUnrated()
+{
+  Birch::Application *app = Birch::Application::GetInstance();
   Birch::User *user = app->GetActiveUser();
-  if( !user ) throw std::runtime_error( "Rating slider modified without an active user" );
+  Birch::Study *study = app->GetActiveStudy();
   Birch::Image *image = app->GetActiveImage();
-  if( !image ) throw std::runtime_error( "Rating slider modified without an active image" );
-
-  // See if we have a rating for this user and image
-  std::map< std::string, std::string > map;
-  map["user_id"] = user->Get( "id" ).ToString();
-  map["image_id"] = image->Get( "id" ).ToString();
-  vtkSmartPointer< Birch::Rating > rating = vtkSmartPointer< Birch::Rating >::New();
-  if( !rating->Load( map ) )
-  { // no record exists, set the user and image ids
-    rating->Set( "user_id", user->Get( "id" ).ToInt() );
-    rating->Set( "image_id", image->Get( "id" ).ToInt() );
+  if( NULL == user || NULL == study ) return;
+
+  // the tree already knows which of the study's images have been rated
+  QModelIndex index = image ?
+    this->studyTreeModel->imageIndex( image->Get( "id" ).ToInt() ) : QModelIndex();
+  index = this->studyTreeModel->nextUnratedIndex( index );
+  if( index.isValid() )
+  {
+    app->SetActiveImage( this->studyTreeModel->image( index ) );
+    return;
+  }
+
+  vtkSmartPointer< Birch::Study > nextStudy;
+  try
+  {
+    nextStudy = this->claimNextStudy();
+  }
+  catch( std::exception &e )
+  {
+    this->ui->statusbar->showMessage( tr( "Unable to find an unrated study: %1" ).arg( e.what() ), 10000 );
+    return;
   }
 
-  if( 0 == value ) rating->SetNull( "rating" );
-  else rating->Set( "rating", value );
+  // the active study is only handed back if it is the only one left
+  if( !nextStudy || nextStudy->Get( "id" ).ToInt() == study->Get( "id" ).ToInt() )
+  {
+    this->ui->statusbar->showMessage(
+      tr( "There are no remaining unrated studies available at this time." ), 10000 );
+    return;
+  }
 
-  rating->Save();
-  this->updateRating();
+  app->SetActiveStudy( nextStudy );
+  index = this->studyTreeModel->nextUnratedIndex( QModelIndex() );
+  if( index.isValid() ) app->SetActiveImage( this->studyTreeModel->image( index ) );
+}
+
+//-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+void QMainBirchWindow::updateThroughput()
+{
+  if( !this->ui->actionRapidRating->isChecked() ) return;
+
+  int count = this->ratingTimes.size();
+  double hours = this->rapidRatingTime.elapsed() / 3600000.0;
+  double median = 0.0;
+  if( 0 < count )
+  {
+    std::vector< int > times = this->ratingTimes;
+    std::nth_element( times.begin(), times.begin() + count / 2, times.end() );
+    median = times[count / 2] / 1000.0;
+  }
+
+  this->throughputLabel->setText(
+    tr( "%1 rated, %2 per hour, median %3 s per image" )
+      .arg( count )
+      .arg( 0 < hours ? count / hours : 0.0, 0, 'f', 0 )
+      .arg( median, 0, 'f', 1 ) );
+}
+
+//-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+void QMainBirchWindow::slotProcessJobEvents()
+{
+  Birch::Application *app = Birch::Application::GetInstance();
+  app->GetScheduler()->ProcessEvents();
+
+  // ratings are written once they stop changing
+  app->GetRatingWriter()->Update();
+}
+
+//-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+void QMainBirchWindow::slotCancelJobs()
+{
+  // only the study database update is cancelled, queued ratings are always written
+  this->studySyncJob->Cancel();
+  this->jobCancelPushButton->setEnabled( false );
+}
+
+//-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+void QMainBirchWindow::slotImageLoadFailed( const QString &message )
+{
+  this->ui->statusbar->showMessage( message, 10000 );
+}
+
+//-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+void QMainBirchWindow::Command::Execute(
+  vtkObject *caller, unsigned long eventId, void *callData )
+{
+  if( !this->window ) return;
+  if( Birch::Application::SafeDownCast( caller ) )
+    this->window->updateApplicationState( eventId, callData );
+  else this->window->updateJobStatus( static_cast<Birch::Job*>( callData ), eventId );
+}
+
+//-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+void QMainBirchWindow::updateApplicationState( unsigned long event, void *callData )
+{
+  if( Birch::Application::ActiveUserChangedEvent == event )
+  {
+    this->updateActions();
+    this->updateRating();
+    this->updateStudyTreeWidget();
+  }
+  else if( Birch::Application::ActiveStudyChangedEvent == event )
+  {
+    this->updateActions();
+    this->updateStudyTreeWidget();
+    this->updateStudyInformation();
+
+    // decode the images of the studies which will be shown next in the background,
+    // following the claim order when the next study is claimed
+    Birch::Application *app = Birch::Application::GetInstance();
+    Birch::User *user = app->GetActiveUser();
+    int userId = 0;
+    if( user &&
+        ( this->ui->unratedCheckBox->isChecked() || this->ui->actionRapidRating->isChecked() ) )
+      userId = user->Get( "id" ).ToInt();
+    int ratingsPerImage =
+      vtkVariant( app->GetConfig()->GetValue( "StudyAssignment", "RatingsPerImage" ) ).ToInt();
+    app->GetImageCache()->Prefetch(
+      app->GetActiveStudy(), userId, 0 < ratingsPerImage ? ratingsPerImage : 1 );
+  }
+  else if( Birch::Application::ActiveImageChangedEvent == event )
+  {
+    this->imageTime.restart();
+    this->updateActions();
+    this->updateStudyTreeSelection();
+    this->updateMedicalImageWidget();
+    this->updateRating();
+  }
+  else if( Birch::Application::RatingChangedEvent == event )
+  {
+    // the slider already shows the new value, only the label and the image's row in
+    // the tree need to follow it
+    int value = *static_cast<int*>( callData );
+    this->setRating( value );
+    Birch::Image *image = Birch::Application::GetInstance()->GetActiveImage();
+    if( image ) this->studyTreeModel->setRating( image->Get( "id" ).ToInt(), value );
+  }
+}
+
+//-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+void QMainBirchWindow::updateJobStatus( Birch::Job *job, unsigned long event )
+{
+  if( job == this->prioritizeJob.GetPointer() )
+  {
+    if( Birch::JobScheduler::JobStartedEvent == event )
+    {
+      this->ui->statusbar->showMessage( tr( "Prioritizing studies..." ) );
+    }
+    else if( Birch::JobScheduler::JobFinishedEvent == event )
+    {
+      QString message;
+      if( Birch::Job::FINISHED == job->GetState() )
+        message = tr( "Study prioritization complete" );
+      else if( Birch::Job::CANCELLED == job->GetState() )
+        message = tr( "Study prioritization cancelled" );
+      else
+        message = tr( "Study prioritization failed: %1" ).arg( job->GetErrorMessage().c_str() );
+      this->ui->statusbar->showMessage( message, 10000 );
+    }
+    return;
+  }
+
+  // otherwise only the study database update is shown to the user
+  if( job != this->studySyncJob.GetPointer() ) return;
+
+  if( Birch::JobScheduler::JobStartedEvent == event )
+  {
+    this->jobProgressBar->setValue( 0 );
+    this->jobProgressBar->setVisible( true );
+    this->jobCancelPushButton->setEnabled( true );
+    this->jobCancelPushButton->setVisible( true );
+    this->ui->statusbar->showMessage( tr( "Updating study database..." ) );
+  }
+  else if( Birch::JobScheduler::JobProgressEvent == event )
+  {
+    this->jobProgressBar->setValue( static_cast<int>( 100 * job->GetProgress() ) );
+  }
+  else if( Birch::JobScheduler::JobDataEvent == event )
+  {
+    this->ui->statusbar->showMessage(
+      tr( "Updating study database... %1 studies written" ).arg(
+        this->studySyncJob->GetNumberOfStudiesWritten() ) );
+  }
+  else if( Birch::JobScheduler::JobFinishedEvent == event )
+  {
+    this->jobProgressBar->setVisible( false );
+    this->jobCancelPushButton->setVisible( false );
+
+    QString message;
+    if( Birch::Job::FINISHED == job->GetState() )
+    {
+      message = tr( "Study database update complete" );
+
+      // new studies are ranked by the policy the queue was last ranked by (such as one
+      // picked by an administrator), the configured policy is only used until then
+      Birch::Configuration *config = Birch::Application::GetInstance()->GetConfig();
+      int policy = Birch::ReviewQueue::GetPolicy( config->GetValue( "StudyAssignment", "Policy" ) );
+      this->prioritizeStudies( policy, true );
+    }
+    else if( Birch::Job::CANCELLED == job->GetState() )
+      message = tr( "Study database update cancelled" );
+    else
+      message = tr( "Study database update failed: %1" ).arg( job->GetErrorMessage().c_str() );
+    this->ui->statusbar->showMessage( message, 10000 );
+  }
 }
 
 //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
@@ -428,51 +827,33 @@ void QMainBirchWindow::updateStudyInformation()
 //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
 void QMainBirchWindow::updateStudyTreeWidget()
 {
-  Birch::Study *study = Birch::Application::GetInstance()->GetActiveStudy();
-
-  // stop the tree's signals until we are done
-  bool oldSignalState = this->ui->studyTreeWidget->blockSignals( true );
+  Birch::Application *app = Birch::Application::GetInstance();
+  Birch::User *user = app->GetActiveUser();
 
-  // if a study is open then populate the study tree
-  this->treeModelMap.clear();
-  this->ui->studyTreeWidget->clear();
-  if( study )
-  {
-    // get the active image so that we can highlight it
-    Birch::Image *activeImage = Birch::Application::GetInstance()->GetActiveImage();
-    QTreeWidgetItem *selectedItem = NULL;
-
-    // make root the study's UID
-    QString name = tr( "Study: " );
-    name += study->Get( "uid" ).ToString().c_str();
-    QTreeWidgetItem *root = new QTreeWidgetItem( this->ui->studyTreeWidget );
-    root->setText( 0, name );
-    root->setExpanded( true );
-    root->setFlags( Qt::ItemIsEnabled );
-    this->ui->studyTreeWidget->addTopLevelItem( root );
-
-    // make each image a child of the root
-    std::vector< vtkSmartPointer< Birch::Image > > imageList;
-    std::vector< vtkSmartPointer< Birch::Image > >::iterator imageIt;
-    study->GetList( &imageList );
-    for( imageIt = imageList.begin(); imageIt != imageList.end(); ++imageIt )
-    {
-      Birch::Image *image = imageIt->GetPointer();
-      name = tr( "Laterality" );
-      name += image->Get( "laterality" ).ToString().c_str();
-      QTreeWidgetItem *imageItem = new QTreeWidgetItem( root );
-      this->treeModelMap[imageItem] = *imageIt;
-      imageItem->setText( 0, name );
-      imageItem->setFlags( Qt::ItemIsSelectable | Qt::ItemIsEnabled );
-      if( activeImage && activeImage->Get( "id" ).ToInt() == image->Get( "id" ).ToInt() )
-        selectedItem = imageItem;
-    }
-      
-    if( selectedItem ) this->ui->studyTreeWidget->setCurrentItem( selectedItem );
-  }
+  // the tree is only reset when the study changes, its images are read once the
+  // study's row is expanded
+  this->studyTreeModel->setStudy( app->GetActiveStudy() );
+  this->studyTreeModel->setUserId( user ? user->Get( "id" ).ToInt() : 0 );
+  this->ui->studyTreeView->expand( this->studyTreeModel->index( 0, 0 ) );
+  this->updateStudyTreeSelection();
+}
 
-  // re-enable the tree's signals
-  this->ui->studyTreeWidget->blockSignals( oldSignalState );
+//-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+void QMainBirchWindow::updateStudyTreeSelection()
+{
+  // highlight the active image without rebuilding the tree
+  Birch::Image *activeImage = Birch::Application::GetInstance()->GetActiveImage();
+  QModelIndex index;
+  if( activeImage ) index = this->studyTreeModel->imageIndex( activeImage->Get( "id" ).ToInt() );
+
+  QItemSelectionModel *selectionModel = this->ui->studyTreeView->selectionModel();
+  bool oldSignalState = selectionModel->blockSignals( true );
+  if( index.isValid() ) selectionModel->setCurrentIndex( index, QItemSelectionModel::ClearAndSelect );
+  else selectionModel->clearSelection();
+  selectionModel->blockSignals( oldSignalState );
+
+  // the selection model's signals were blocked so the view must be told to repaint
+  this->ui->studyTreeView->viewport()->update();
 }
 
 //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
@@ -482,7 +863,9 @@ void QMainBirchWindow::updateMedicalImageWidget()
 
   if( image )
   {
-    this->ui->medicalImageWidget->loadImage( QString( image->GetFileName().c_str() ) );
+    // cached images display at once, others are decoded in the background
+    this->ui->medicalImageWidget->loadImage(
+      image->Get( "id" ).ToInt(), QString( image->GetFileName().c_str() ) );
     // TODO: in some situations we may not want to display the static images
     // for example, when a reader should be blinded to any previous slice selections
   }
@@ -494,31 +877,16 @@ void QMainBirchWindow::updateMedicalImageWidget()
 
 //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
 void QMainBirchWindow::updateRating()
+{
+  this->setRating( Birch::Application::GetInstance()->GetActiveImageRating() );
+}
+
+//-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+void QMainBirchWindow::setRating( int ratingValue )
 {
   // stop the rating slider's signals until we are done
   bool oldSignalState = this->ui->ratingSlider->blockSignals( true );
 
-  int ratingValue = 0;
-  Birch::Application *app = Birch::Application::GetInstance();
-
-  // make sure we have an active image
-  Birch::User *user = app->GetActiveUser();
-  Birch::Image *image = app->GetActiveImage();
-
-  if( user && image )
-  {
-    std::map< std::string, std::string > map;
-    map["user_id"] = user->Get( "id" ).ToString();
-    map["image_id"] = image->Get( "id" ).ToString();
-    vtkSmartPointer< Birch::Rating > rating = vtkSmartPointer< Birch::Rating >::New();
-    
-    if( rating->Load( map ) )
-    {
-      vtkVariant v = rating->Get( "rating" );
-      if( v.IsValid() ) ratingValue = v.ToInt();
-    }
-  }
-
   this->ui->ratingSlider->setValue( ratingValue );
   this->ui->ratingValueLabel->setText( 0 == ratingValue ? tr( "N/A" ) : QString::number( ratingValue ) );
 
@@ -527,7 +895,7 @@ void QMainBirchWindow::updateRating()
 }
 
 //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
-void QMainBirchWindow::updateInterface()
+void QMainBirchWindow::updateActions()
 {
   Birch::Application *app = Birch::Application::GetInstance();
   Birch::Study *study = app->GetActiveStudy();
@@ -542,13 +910,20 @@ void QMainBirchWindow::updateInterface()
   this->ui->unratedCheckBox->setEnabled( study );
   this->ui->actionPreviousStudy->setEnabled( study );
   this->ui->actionNextStudy->setEnabled( study );
+  if( !study ) this->ui->actionRapidRating->setChecked( false );
+  this->ui->actionRapidRating->setEnabled( study );
   this->ui->previousStudyPushButton->setEnabled( study );
   this->ui->nextStudyPushButton->setEnabled( study );
   this->ui->ratingSlider->setEnabled( image );
   this->ui->notePushButton->setEnabled( false ); // TODO: notes aren't implemented
-  this->ui->studyTreeWidget->setEnabled( study );
+  this->ui->studyTreeView->setEnabled( study );
   this->ui->medicalImageWidget->setEnabled( loggedIn );
+}
 
+//-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+void QMainBirchWindow::updateInterface()
+{
+  this->updateActions();
   this->updateStudyTreeWidget();
   this->updateStudyInformation();
   this->updateMedicalImageWidget();
@@ -13,20 +13,39 @@
 #define __QMainBirchWindow_h
 
 #include <QMainWindow>
+#include <QTime>
 
 #include "Utilities.h"
 
+#include "vtkCommand.h"
 #include "vtkSmartPointer.h"
 
-#include <map>
+#include <vector>
 
-namespace Birch { class ActiveRecord; };
+namespace Birch { class Job; class Study; class StudyPrioritizeJob; class StudySyncJob; };
 class Ui_QMainBirchWindow;
-class QTreeWidgetItem;
+class QLabel;
+class QProgressBar;
+class QPushButton;
+class QShortcut;
+class QSignalMapper;
+class QStudyTreeModel;
+class QTimer;
 
 class QMainBirchWindow : public QMainWindow
 {
   Q_OBJECT
+private:
+  class Command : public vtkCommand
+  {
+  public:
+    static Command *New() { return new Command; }
+    void Execute( vtkObject *caller, unsigned long eventId, void *callData );
+    QMainBirchWindow *window;
+
+  protected:
+    Command() { this->window = NULL; }
+  };
 
 public:
   QMainBirchWindow( QWidget* parent = 0 );
@@ -41,8 +60,14 @@ public slots:
   virtual void slotLogin();
   virtual void slotUserManagement();
   virtual void slotUpdateStudyDatabase();
+  virtual void slotPrioritizeStudies();
   virtual void slotTreeSelectionChanged();
   virtual void slotRatingSliderChanged( int );
+  virtual void slotRapidRating( bool );
+  virtual void slotRapidRate( int );
+  virtual void slotProcessJobEvents();
+  virtual void slotCancelJobs();
+  virtual void slotImageLoadFailed( const QString &message );
 
   // help event functions
   virtual void slotAbout();
@@ -57,11 +82,50 @@ protected:
   virtual void writeSettings();
   virtual void updateStudyInformation();
   virtual void updateStudyTreeWidget();
+  virtual void updateStudyTreeSelection();
   virtual void updateMedicalImageWidget();
   virtual void updateRating();
-  virtual void updateInterface();
+  virtual void setRating( int value );
+  virtual void updateActions();
+  virtual void updateThroughput();
+
+  // makes the next unrated image active, moving on to the next unrated study once
+  // every image of the active study has been rated
+  virtual void advanceToUnrated();
 
-  std::map< QTreeWidgetItem*, vtkSmartPointer<Birch::ActiveRecord> > treeModelMap;
+  // leases the next study needing the active user's ratings (see Birch::StudyLease)
+  vtkSmartPointer< Birch::Study > claimNextStudy();
+
+  // re-ranks the review queue by a policy in the background (see Birch::ReviewQueue),
+  // or by the queue's current policy if it has one and keepCurrent is set
+  void prioritizeStudies( int policy, bool keepCurrent = false );
+
+  // refreshes everything, individual parts are refreshed by updateApplicationState()
+  virtual void updateInterface();
+  virtual void updateApplicationState( unsigned long event, void *callData );
+  virtual void updateJobStatus( Birch::Job *job, unsigned long event );
+
+  // the active study's images, read when the study's row is expanded
+  QStudyTreeModel *studyTreeModel;
+
+  // rapid rating, number keys rate the active image and move on to the next unrated one
+  std::vector< QShortcut* > ratingShortcuts;
+  QSignalMapper *ratingShortcutMapper;
+  QLabel *throughputLabel;
+  QTime imageTime; // since the active image was shown
+  QTime rapidRatingTime; // since rapid rating was started
+  std::vector< int > ratingTimes; // milliseconds taken to rate each image
+
+  // application state changes
+  vtkSmartPointer< Command > applicationObserver;
+
+  // background jobs
+  vtkSmartPointer< Command > jobObserver;
+  vtkSmartPointer< Birch::StudySyncJob > studySyncJob;
+  vtkSmartPointer< Birch::StudyPrioritizeJob > prioritizeJob;
+  QTimer *jobTimer;
+  QProgressBar *jobProgressBar;
+  QPushButton *jobCancelPushButton;
 
 protected slots:
 
@@ -12,7 +12,16 @@
 
 #include "ui_QMedicalImageWidget.h"
 
+#include "Application.h"
+#include "Configuration.h"
+#include "ImageCache.h"
+#include "ImageLoadJob.h"
+#include "JobScheduler.h"
+
+#include "vtkImageData.h"
+#include "vtkImageMapToWindowLevelColors.h"
 #include "vtkMedicalImageViewer.h"
+#include "vtkVariant.h"
 
 #include <QScrollBar>
 
@@ -27,8 +36,26 @@ QMedicalImageWidget::QMedicalImageWidget( QWidget* parent )
   this->ui->setupUi( this );
   this->viewer = vtkMedicalImageViewer::New();
   this->viewer->SetRenderWindow( this->ui->vtkWidget->GetRenderWindow() );
+  this->imageId = 0;
   this->resetImage();
 
+  Birch::Application *app = Birch::Application::GetInstance();
+  this->jobObserver = vtkSmartPointer< Command >::New();
+  this->jobObserver->widget = this;
+  app->GetScheduler()->AddObserver( Birch::JobScheduler::JobDataEvent, this->jobObserver );
+  app->GetScheduler()->AddObserver( Birch::JobScheduler::JobFinishedEvent, this->jobObserver );
+
+  // reduced resolution previews are displayed while images are loading unless turned off
+  std::string factor = app->GetConfig()->GetValue( "Viewer", "PreviewShrinkFactor" );
+  this->previewShrinkFactor = factor.empty() ? 4 : vtkVariant( factor ).ToInt();
+
+  // large images are displayed from the pyramids built along with cached images
+  this->viewer->SetTileSize( app->GetImageCache()->GetPyramidTileSize() );
+
+  // window/level mapping uses one thread per processor unless limited
+  int threads = vtkVariant( app->GetConfig()->GetValue( "Viewer", "Threads" ) ).ToInt();
+  if( 0 < threads ) this->viewer->GetWindowLevel()->SetNumberOfThreads( threads );
+
   QObject::connect(
     this->ui->scrollBar, SIGNAL( valueChanged( int ) ),
     this, SLOT( slotSliceChanged( int ) ) );
@@ -37,6 +64,9 @@ QMedicalImageWidget::QMedicalImageWidget( QWidget* parent )
 //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
 QMedicalImageWidget::~QMedicalImageWidget()
 {
+  Birch::Application::GetInstance()->GetScheduler()->RemoveObserver( this->jobObserver );
+  this->cancelLoad();
+
   if( NULL != this->viewer )
   {
     this->viewer->Delete();
@@ -47,6 +77,8 @@ QMedicalImageWidget::~QMedicalImageWidget()
 //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
 void QMedicalImageWidget::resetImage()
 {
+  this->cancelLoad();
+  this->imageId = 0;
   this->viewer->SetImageToSinusoid();
   this->updateInterface();
 }
@@ -54,6 +86,8 @@ void QMedicalImageWidget::resetImage()
 //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
 void QMedicalImageWidget::loadImage( QString filename )
 {
+  this->cancelLoad();
+  this->imageId = 0;
   if( !this->viewer->Load( filename.toStdString() ) )
   {
     std::stringstream stream;
@@ -64,6 +98,122 @@ void QMedicalImageWidget::loadImage( QString filename )
   this->updateInterface();
 }
 
+//-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+void QMedicalImageWidget::setImage( vtkImageData *image )
+{
+  this->setImage( image, std::vector< vtkImageData* >() );
+}
+
+//-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+void QMedicalImageWidget::setImage( vtkImageData *image, const std::vector< vtkImageData* > &pyramid )
+{
+  this->cancelLoad();
+  this->imageId = 0;
+  this->viewer->SetInput( image, pyramid );
+  this->updateInterface();
+}
+
+//-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+void QMedicalImageWidget::loadImage( int id, QString filename )
+{
+  // nothing to do if the image is already displayed (this keeps the current slice)
+  if( 0 != id && id == this->imageId ) return;
+
+  Birch::Application *app = Birch::Application::GetInstance();
+  Birch::ImageCache *cache = app->GetImageCache();
+  vtkImageData *image = cache->GetImage( id );
+  if( image )
+  {
+    this->setImage( image, cache->GetPyramid( id ) );
+    this->imageId = id;
+    return;
+  }
+
+  // nothing to do if the image is already being loaded
+  if( this->loadJob && id == this->loadJob->GetImageId() ) return;
+
+  this->cancelLoad();
+  this->viewer->SetMessage( "Loading..." );
+  this->ui->scrollBar->setVisible( false );
+
+  this->loadJob = vtkSmartPointer< Birch::ImageLoadJob >::New();
+  this->loadJob->SetImageId( id );
+  this->loadJob->SetPreviewShrinkFactor( this->previewShrinkFactor );
+  this->loadJob->SetPyramidTileSize( this->viewer->GetTileSize() );
+  this->loadJob->SetFileName( filename.toStdString() );
+  app->GetScheduler()->Submit( this->loadJob );
+}
+
+//-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+void QMedicalImageWidget::cancelLoad()
+{
+  // a cancelled load which has already started still finishes, its image is cached
+  // but not displayed (see updateJobStatus)
+  if( this->loadJob )
+  {
+    this->loadJob->Cancel();
+    this->loadJob = NULL;
+  }
+}
+
+//-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+void QMedicalImageWidget::updateJobStatus( Birch::Job *job, unsigned long event )
+{
+  Birch::ImageLoadJob *imageLoadJob = Birch::ImageLoadJob::SafeDownCast( job );
+  if( !imageLoadJob ) return;
+
+  if( Birch::JobScheduler::JobDataEvent == event )
+  {
+    // display the preview until the full image has been decoded (previews aren't cached)
+    vtkSmartPointer< vtkImageData > preview;
+    preview.TakeReference( imageLoadJob->TakePreview() );
+    if( preview && imageLoadJob == this->loadJob.GetPointer() )
+    {
+      this->viewer->SetInput( preview );
+      this->updateInterface();
+    }
+    return;
+  }
+
+  vtkSmartPointer< vtkImageData > image;
+  image.TakeReference( imageLoadJob->TakeImage() );
+  std::vector< vtkSmartPointer< vtkImageData > > levels;
+  std::vector< vtkImageData* > pyramid;
+  imageLoadJob->TakePyramid( pyramid );
+  for( std::vector< vtkImageData* >::iterator level = pyramid.begin(); level != pyramid.end(); ++level )
+  {
+    levels.push_back( vtkSmartPointer< vtkImageData >() );
+    levels.back().TakeReference( *level ); // released once the cache and viewer hold them
+  }
+  if( image )
+    Birch::Application::GetInstance()->GetImageCache()->AddImage(
+      imageLoadJob->GetImageId(), image, pyramid );
+
+  // stale loads are only cached
+  if( imageLoadJob != this->loadJob.GetPointer() ) return;
+  this->loadJob = NULL;
+
+  if( image )
+  {
+    this->setImage( image, pyramid );
+    this->imageId = imageLoadJob->GetImageId();
+  }
+  else if( Birch::Job::FAILED == imageLoadJob->GetState() )
+  {
+    // this is called while the scheduler notifies its observers, so the failure is
+    // reported by a signal rather than by throwing past the other observers
+    this->viewer->SetMessage( "Unable to load image" );
+    emit imageLoadFailed( QString( imageLoadJob->GetErrorMessage().c_str() ) );
+  }
+}
+
+//-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+void QMedicalImageWidget::Command::Execute(
+  vtkObject *caller, unsigned long eventId, void *callData )
+{
+  if( this->widget ) this->widget->updateJobStatus( static_cast<Birch::Job*>( callData ), eventId );
+}
+
 //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
 void QMedicalImageWidget::slotSliceChanged( int slice )
 {
@@ -14,12 +14,30 @@
 
 #include <QWidget>
 
+#include "vtkCommand.h"
+#include "vtkSmartPointer.h"
+
+#include <vector>
+
+namespace Birch { class ImageLoadJob; class Job; };
+class vtkImageData;
 class vtkMedicalImageViewer;
 class Ui_QMedicalImageWidget;
 
 class QMedicalImageWidget : public QWidget
 {
   Q_OBJECT
+private:
+  class Command : public vtkCommand
+  {
+  public:
+    static Command *New() { return new Command; }
+    void Execute( vtkObject *caller, unsigned long eventId, void *callData );
+    QMedicalImageWidget *widget;
+
+  protected:
+    Command() { this->widget = NULL; }
+  };
 
 public:
   //constructor
@@ -29,14 +47,35 @@ public:
 
   void resetImage();
   void loadImage( QString filename );
+  void setImage( vtkImageData *image );
+
+  // displays an image along with its prebuilt display pyramid (levels 1 and up)
+  void setImage( vtkImageData *image, const std::vector< vtkImageData* > &pyramid );
+
+  // displays an Image record's image, cached images are displayed immediately while
+  // others are decoded in the background (replacing any load still in progress),
+  // nothing is done if the image is already displayed
+  void loadImage( int id, QString filename );
+
+signals:
+  // emitted when a background load fails (the viewer shows a message in place of the image)
+  void imageLoadFailed( const QString &message );
 
 public slots:
   virtual void slotSliceChanged( int );
 
 protected:
   void updateInterface();
+  void cancelLoad();
+  void updateJobStatus( Birch::Job *job, unsigned long event );
 
   vtkMedicalImageViewer *viewer;
+  int imageId; // id of the Image record on display (0 if none)
+
+  // background image loading
+  vtkSmartPointer< Command > jobObserver;
+  vtkSmartPointer< Birch::ImageLoadJob > loadJob;
+  int previewShrinkFactor;
 
 protected slots:
 
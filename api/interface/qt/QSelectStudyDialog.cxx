@@ -12,19 +12,26 @@
 #include "ui_QSelectStudyDialog.h"
 
 #include "Application.h"
-#include "Database.h"
+#include "JobScheduler.h"
+#include "QStudyTableModel.h"
 #include "Study.h"
+#include "StudyFacetCache.h"
+#include "StudyFacetJob.h"
+#include "StudySyncJob.h"
+#include "User.h"
 #include "Utilities.h"
 
 #include "vtkSmartPointer.h"
+#include "vtkVariant.h"
 
-#include <QInputDialog>
-#include <QList>
+#include <QComboBox>
+#include <QDate>
+#include <QDateEdit>
+#include <QItemSelectionModel>
+#include <QLineEdit>
+#include <QModelIndex>
 #include <QPushButton>
-#include <QTableWidget>
-#include <QTableWidgetItem>
-
-#include <vector>
+#include <QTimer>
 
 //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
 QSelectStudyDialog::QSelectStudyDialog( QWidget* parent )
@@ -32,71 +39,122 @@ QSelectStudyDialog::QSelectStudyDialog( QWidget* parent )
 {
   this->ui = new Ui_QSelectStudyDialog;
   this->ui->setupUi( this );
-  this->ui->studyTableWidget->horizontalHeader()->setResizeMode( QHeaderView::Stretch );
-  this->ui->studyTableWidget->horizontalHeader()->setClickable( true );
-  this->ui->studyTableWidget->verticalHeader()->setVisible( false );
-  this->ui->studyTableWidget->setSelectionBehavior( QAbstractItemView::SelectRows );
-  this->ui->studyTableWidget->setSelectionMode( QAbstractItemView::SingleSelection );
 
-  this->searchText = "";
-  this->sortColumn = 0;
-  this->sortOrder = Qt::AscendingOrder;
+  Birch::Application *app = Birch::Application::GetInstance();
+
+  // the rating status filter applies to the active user's ratings
+  this->model = new QStudyTableModel( this );
+  Birch::User *user = app->GetActiveUser();
+  this->model->getQuery()->SetRatingUserId( user ? user->Get( "id" ).ToInt() : 0 );
+  this->ui->ratingComboBox->addItem( tr( "Any" ), Birch::StudyQuery::AnyRatingStatus );
+  this->ui->ratingComboBox->addItem( tr( "Rated" ), Birch::StudyQuery::RatedStatus );
+  this->ui->ratingComboBox->addItem( tr( "Unrated" ), Birch::StudyQuery::UnratedStatus );
+  this->ui->ratingComboBox->setEnabled( NULL != user );
+
+  // a date edit showing its minimum date displays "Any" and doesn't restrict the list
+  QDate minimumDate( 1900, 1, 1 );
+  this->ui->firstDateEdit->setMinimumDate( minimumDate );
+  this->ui->firstDateEdit->setDate( minimumDate );
+  this->ui->lastDateEdit->setMinimumDate( minimumDate );
+  this->ui->lastDateEdit->setDate( minimumDate );
+
+  // the list is first read when sorting is enabled (the model is sorted by the header's
+  // sort indicator) so it must be done once the model has been set
+  this->ui->studyTableView->setModel( this->model );
+  this->ui->studyTableView->horizontalHeader()->setResizeMode( QHeaderView::Stretch );
+  this->ui->studyTableView->horizontalHeader()->setClickable( true );
+  this->ui->studyTableView->horizontalHeader()->setSortIndicator( 0, Qt::AscendingOrder );
+  this->ui->studyTableView->verticalHeader()->setVisible( false );
+  this->ui->studyTableView->setSelectionBehavior( QAbstractItemView::SelectRows );
+  this->ui->studyTableView->setSelectionMode( QAbstractItemView::SingleSelection );
+  this->ui->studyTableView->setSortingEnabled( true );
+  this->ui->buttonBox->button( QDialogButtonBox::Ok )->setEnabled( false );
+
+  this->searchTimer = new QTimer( this );
+  this->searchTimer->setSingleShot( true );
+  this->searchTimer->setInterval( 250 );
 
   QObject::connect(
-    this->ui->searchPushButton, SIGNAL( clicked( bool ) ),
+    this->ui->searchLineEdit, SIGNAL( textChanged( const QString& ) ),
+    this, SLOT( slotSearchTextChanged() ) );
+  QObject::connect(
+    this->searchTimer, SIGNAL( timeout() ),
     this, SLOT( slotSearch() ) );
+  QObject::connect(
+    this->ui->siteComboBox, SIGNAL( currentIndexChanged( int ) ),
+    this, SLOT( slotFilterChanged() ) );
+  QObject::connect(
+    this->ui->interviewerComboBox, SIGNAL( currentIndexChanged( int ) ),
+    this, SLOT( slotFilterChanged() ) );
+  QObject::connect(
+    this->ui->ratingComboBox, SIGNAL( currentIndexChanged( int ) ),
+    this, SLOT( slotFilterChanged() ) );
+  QObject::connect(
+    this->ui->firstDateEdit, SIGNAL( dateChanged( const QDate& ) ),
+    this, SLOT( slotFilterChanged() ) );
+  QObject::connect(
+    this->ui->lastDateEdit, SIGNAL( dateChanged( const QDate& ) ),
+    this, SLOT( slotFilterChanged() ) );
+  QObject::connect(
+    this->ui->clearFiltersPushButton, SIGNAL( clicked( bool ) ),
+    this, SLOT( slotClearFilters() ) );
   QObject::connect(
     this->ui->buttonBox, SIGNAL( accepted() ),
     this, SLOT( slotAccepted() ) );
   QObject::connect(
-    this->ui->studyTableWidget, SIGNAL( itemSelectionChanged() ),
+    this->ui->studyTableView->selectionModel(),
+    SIGNAL( selectionChanged( const QItemSelection&, const QItemSelection& ) ),
     this, SLOT( slotSelectionChanged() ) );
   QObject::connect(
-    this->ui->studyTableWidget->horizontalHeader(), SIGNAL( sectionClicked( int ) ),
-    this, SLOT( slotHeaderClicked( int ) ) );
+    this->model, SIGNAL( dataChanged( const QModelIndex&, const QModelIndex& ) ),
+    this, SLOT( slotSelectionChanged() ) );
 
-  this->updateInterface();
+  this->observer = vtkSmartPointer< Command >::New();
+  this->observer->dialog = this;
+  app->GetScheduler()->AddObserver( Birch::JobScheduler::JobDataEvent, this->observer );
+  app->GetScheduler()->AddObserver( Birch::JobScheduler::JobFinishedEvent, this->observer );
+
+  this->updateFacets();
 }
 
 //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
 QSelectStudyDialog::~QSelectStudyDialog()
 {
+  if( this->facetJob ) this->facetJob->Cancel();
+  Birch::Application::GetInstance()->GetScheduler()->RemoveObserver( this->observer );
 }
 
 //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
 void QSelectStudyDialog::slotSearch()
 {
-  bool ok;
-  QString text = QInputDialog::getText(
-    this,
-    QObject::tr( "Search Term" ),
-    QObject::tr( "Provide some or all of the study to search for:" ),
-    QLineEdit::Normal,
-    QString(),
-    &ok );
-
-  if( ok )
-  {
-    this->searchText = text;
-    this->updateInterface();
-  }
+  // the model cancels any search still in progress
+  this->searchTimer->stop();
+  this->model->setSearchText( this->ui->searchLineEdit->text() );
+  this->updateFacets();
+}
+
+//-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+void QSelectStudyDialog::slotSearchTextChanged()
+{
+  // restarting the timer means only the text typed last is searched for
+  this->searchTimer->start();
 }
 
 //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
 void QSelectStudyDialog::slotAccepted()
 {
-  // get the uid of the selected row
+  // get the id of the selected row
   vtkSmartPointer< Birch::Study > study;
-  QList<QTableWidgetItem *> list = this->ui->studyTableWidget->selectedItems();
-  if( list.empty() )
+  QModelIndexList list = this->ui->studyTableView->selectionModel()->selectedRows();
+  int id = list.empty() ? 0 : this->model->studyId( list.first().row() );
+  if( 0 == id )
   {
     study = NULL;
   }
   else
   {
-    QTableWidgetItem *item = list.first();
     study = vtkSmartPointer< Birch::Study >::New();
-    study->Load( "uid", item->text().toStdString() );
+    study->Load( "id", vtkVariant( id ).ToString() );
   }
 
   Birch::Application::GetInstance()->SetActiveStudy( study );
@@ -106,63 +164,202 @@ void QSelectStudyDialog::slotAccepted()
 //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
 void QSelectStudyDialog::slotSelectionChanged()
 {
-  QList<QTableWidgetItem *> list = this->ui->studyTableWidget->selectedItems();
-  this->ui->buttonBox->button( QDialogButtonBox::Ok )->setEnabled( 0 != list.size() );
+  // rows which haven't been read yet can't be opened
+  QModelIndexList list = this->ui->studyTableView->selectionModel()->selectedRows();
+  this->ui->buttonBox->button( QDialogButtonBox::Ok )->setEnabled(
+    !list.empty() && 0 != this->model->studyId( list.first().row() ) );
+}
+
+//-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+void QSelectStudyDialog::slotFilterChanged()
+{
+  Birch::StudyQuery *query = this->model->getQuery();
+  QComboBox *siteComboBox = this->ui->siteComboBox;
+  QComboBox *interviewerComboBox = this->ui->interviewerComboBox;
+  QComboBox *ratingComboBox = this->ui->ratingComboBox;
+  QDateEdit *firstDateEdit = this->ui->firstDateEdit;
+  QDateEdit *lastDateEdit = this->ui->lastDateEdit;
+
+  query->SetSite(
+    siteComboBox->itemData( siteComboBox->currentIndex() ).toString().toStdString() );
+  query->SetInterviewer(
+    interviewerComboBox->itemData( interviewerComboBox->currentIndex() ).toString().toStdString() );
+  query->SetRatingStatus( ratingComboBox->itemData( ratingComboBox->currentIndex() ).toInt() );
+  query->SetFirstAcquiredDate( firstDateEdit->date() == firstDateEdit->minimumDate() ?
+    "" : firstDateEdit->date().toString( "yyyy-MM-dd" ).toStdString() );
+  query->SetLastAcquiredDate( lastDateEdit->date() == lastDateEdit->minimumDate() ?
+    "" : lastDateEdit->date().toString( "yyyy-MM-dd" ).toStdString() );
+
+  // nothing is read if the filters haven't actually changed
+  this->model->update();
+  this->updateFacets();
 }
 
 //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
-void QSelectStudyDialog::slotHeaderClicked( int index )
+void QSelectStudyDialog::slotClearFilters()
 {
-  // reverse order if already sorted
-  if( this->sortColumn == index )
-    this->sortOrder = Qt::AscendingOrder == this->sortOrder ? Qt::DescendingOrder : Qt::AscendingOrder;
-  this->sortColumn = index;
-  this->updateInterface();
+  // the filters are all cleared before the list is read again
+  QList< QWidget* > widgets;
+  widgets << this->ui->siteComboBox << this->ui->interviewerComboBox << this->ui->ratingComboBox
+          << this->ui->firstDateEdit << this->ui->lastDateEdit;
+  for( int i = 0; i < widgets.size(); ++i ) widgets[i]->blockSignals( true );
+
+  this->ui->siteComboBox->setCurrentIndex( 0 );
+  this->ui->interviewerComboBox->setCurrentIndex( 0 );
+  this->ui->ratingComboBox->setCurrentIndex( 0 );
+  this->ui->firstDateEdit->setDate( this->ui->firstDateEdit->minimumDate() );
+  this->ui->lastDateEdit->setDate( this->ui->lastDateEdit->minimumDate() );
+
+  for( int i = 0; i < widgets.size(); ++i ) widgets[i]->blockSignals( false );
+  this->slotFilterChanged();
 }
 
 //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
-void QSelectStudyDialog::updateInterface()
+void QSelectStudyDialog::updateFacets()
 {
-  this->ui->studyTableWidget->setRowCount( 0 );
-  QTableWidgetItem *item;
-  
-  std::vector< vtkSmartPointer< Birch::Study > > studyList;
-  Birch::Study::GetAll( &studyList );
-  std::vector< vtkSmartPointer< Birch::Study > >::iterator it;
-  for( it = studyList.begin(); it != studyList.end(); ++it )
-  { // for every study, add a new row
-    Birch::Study *study = *it;
-    QString uid = QString( study->Get( "uid" ).ToString().c_str() );
-
-    if( this->searchText.isEmpty() || uid.contains( this->searchText, Qt::CaseInsensitive ) )
+  if( this->facetJob )
+  {
+    this->facetJob->Cancel();
+    this->facetJob = NULL;
+  }
+
+  Birch::Application *app = Birch::Application::GetInstance();
+  Birch::StudyFacetCache *cache = app->GetStudyFacetCache();
+  Birch::StudyQuery *query = this->model->getQuery();
+
+  // cached counts are shown right away, the rest are counted by a single job
+  std::vector< int > missingFacets;
+  for( int facet = 0; facet < Birch::StudyQuery::NumberOfFacets; ++facet )
+  {
+    if( Birch::StudyQuery::RatingFacet == facet && 0 == query->GetRatingUserId() ) continue;
+
+    Birch::StudyQuery::FacetCounts counts;
+    if( cache->GetCounts( query, facet, counts ) ) this->showFacet( facet, counts );
+    else missingFacets.push_back( facet );
+  }
+  if( missingFacets.empty() ) return;
+
+  // without worker threads the facets are counted right away
+  Birch::JobScheduler *scheduler = app->GetScheduler();
+  if( !scheduler->IsRunning() )
+  {
+    std::vector< int >::iterator it;
+    for( it = missingFacets.begin(); it != missingFacets.end(); ++it )
     {
-      this->ui->studyTableWidget->insertRow( 0 );
-
-      // add uid to row
-      item = new QTableWidgetItem;
-      item->setFlags( Qt::ItemIsSelectable | Qt::ItemIsEnabled );
-      item->setText( uid );
-      this->ui->studyTableWidget->setItem( 0, 0, item );
-
-      // add site to row
-      item = new QTableWidgetItem;
-      item->setFlags( Qt::ItemIsSelectable | Qt::ItemIsEnabled );
-      item->setText( QString( study->Get( "site" ).ToString().c_str() ) );
-      this->ui->studyTableWidget->setItem( 0, 1, item );
-
-      // add interviewer to row
-      item = new QTableWidgetItem;
-      item->setFlags( Qt::ItemIsSelectable | Qt::ItemIsEnabled );
-      item->setText( QString( study->Get( "interviewer" ).ToString().c_str() ) );
-      this->ui->studyTableWidget->setItem( 0, 2, item );
-
-      // add datetime_acquired to row
-      item = new QTableWidgetItem;
-      item->setFlags( Qt::ItemIsSelectable | Qt::ItemIsEnabled );
-      item->setText( QString( study->Get( "datetime_acquired" ).ToString().c_str() ) );
-      this->ui->studyTableWidget->setItem( 0, 3, item );
+      try
+      {
+        Birch::StudyQuery::FacetCounts counts;
+        query->GetFacetCounts( *it, counts );
+        cache->SetCounts( query, *it, counts );
+        this->showFacet( *it, counts );
+      }
+      catch( std::exception& )
+      {
+        // the filter keeps its previous counts
+      }
     }
+    return;
   }
 
-  this->ui->studyTableWidget->sortItems( this->sortColumn, this->sortOrder );
+  this->facetJob = vtkSmartPointer< Birch::StudyFacetJob >::New();
+  this->facetJob->SetQuery( query );
+  std::vector< int >::iterator it;
+  for( it = missingFacets.begin(); it != missingFacets.end(); ++it ) this->facetJob->AddFacet( *it );
+  scheduler->Submit( this->facetJob );
+}
+
+//-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+void QSelectStudyDialog::finishFacetJob( Birch::Job *job )
+{
+  // jobs counting filters which have since changed were cancelled and are ignored
+  if( job != this->facetJob.GetPointer() ) return;
+  vtkSmartPointer< Birch::StudyFacetJob > finishedJob = this->facetJob;
+  this->facetJob = NULL;
+  if( Birch::Job::FINISHED != finishedJob->GetState() ) return;
+
+  Birch::StudyFacetCache *cache = Birch::Application::GetInstance()->GetStudyFacetCache();
+  const std::vector< int > &facets = finishedJob->GetFacets();
+  std::vector< int >::const_iterator it;
+  for( it = facets.begin(); it != facets.end(); ++it )
+  {
+    Birch::StudyQuery::FacetCounts counts;
+    if( finishedJob->GetFacetCounts( *it, counts ) )
+    {
+      cache->SetCounts( finishedJob->GetQuery(), *it, counts );
+      this->showFacet( *it, counts );
+    }
+  }
+}
+
+//-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+void QSelectStudyDialog::showFacet( int facet, const Birch::StudyQuery::FacetCounts &counts )
+{
+  QComboBox *comboBox = this->getFacetComboBox( facet );
+  if( NULL == comboBox ) return;
+
+  int total = 0;
+  Birch::StudyQuery::FacetCounts::const_iterator it;
+  for( it = counts.begin(); it != counts.end(); ++it ) total += it->second;
+
+  // repopulating the box mustn't change the filter
+  comboBox->blockSignals( true );
+  if( Birch::StudyQuery::RatingFacet == facet )
+  {
+    // the rating status values are fixed, only their counts change
+    int rated = 0, unrated = 0;
+    for( it = counts.begin(); it != counts.end(); ++it )
+    {
+      if( "rated" == it->first ) rated = it->second;
+      else if( "unrated" == it->first ) unrated = it->second;
+    }
+    comboBox->setItemText( 0, tr( "Any (%1)" ).arg( total ) );
+    comboBox->setItemText( 1, tr( "Rated (%1)" ).arg( rated ) );
+    comboBox->setItemText( 2, tr( "Unrated (%1)" ).arg( unrated ) );
+  }
+  else
+  {
+    QString selected = comboBox->itemData( comboBox->currentIndex() ).toString();
+    bool found = selected.isEmpty();
+    comboBox->clear();
+    comboBox->addItem( tr( "All (%1)" ).arg( total ), QString( "" ) );
+    for( it = counts.begin(); it != counts.end(); ++it )
+    {
+      QString value = QString::fromStdString( it->first );
+      comboBox->addItem( QString( "%1 (%2)" ).arg( value ).arg( it->second ), value );
+      if( value == selected ) found = true;
+    }
+
+    // a chosen value which no longer matches any studies stays chosen
+    if( !found ) comboBox->addItem( QString( "%1 (0)" ).arg( selected ), selected );
+    comboBox->setCurrentIndex( comboBox->findData( selected ) );
+  }
+  comboBox->blockSignals( false );
+}
+
+//-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+QComboBox* QSelectStudyDialog::getFacetComboBox( int facet )
+{
+  if( Birch::StudyQuery::SiteFacet == facet ) return this->ui->siteComboBox;
+  else if( Birch::StudyQuery::InterviewerFacet == facet ) return this->ui->interviewerComboBox;
+  else if( Birch::StudyQuery::RatingFacet == facet ) return this->ui->ratingComboBox;
+  return NULL;
+}
+
+//-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+void QSelectStudyDialog::Command::Execute(
+  vtkObject *caller, unsigned long eventId, void *callData )
+{
+  if( NULL == this->dialog ) return;
+
+  if( Birch::JobScheduler::JobFinishedEvent == eventId )
+  {
+    this->dialog->finishFacetJob( static_cast<Birch::Job*>( callData ) );
+  }
+  else if( Birch::StudySyncJob::SafeDownCast( static_cast<vtkObject*>( callData ) ) )
+  {
+    // only study updates affect the list, the cache may not have been cleared yet
+    Birch::Application::GetInstance()->GetStudyFacetCache()->Clear();
+    this->dialog->model->invalidate();
+    this->dialog->updateFacets();
+  }
 }
@@ -14,13 +14,33 @@
 
 #include <QDialog>
 
+#include "StudyQuery.h"
 #include "Utilities.h"
 
+#include "vtkCommand.h"
+#include "vtkSmartPointer.h"
+
+class QComboBox;
+class QStudyTableModel;
+class QTimer;
 class Ui_QSelectStudyDialog;
 
+namespace Birch { class Job; class StudyFacetJob; };
+
 class QSelectStudyDialog : public QDialog
 {
   Q_OBJECT
+private:
+  class Command : public vtkCommand
+  {
+  public:
+    static Command *New() { return new Command; }
+    void Execute( vtkObject *caller, unsigned long eventId, void *callData );
+    QSelectStudyDialog *dialog;
+
+  protected:
+    Command() { this->dialog = NULL; }
+  };
 
 public:
   //constructor
@@ -30,15 +50,30 @@ public:
   
 public slots:
   virtual void slotSearch();
+  virtual void slotSearchTextChanged();
   virtual void slotAccepted();
   virtual void slotSelectionChanged();
-  virtual void slotHeaderClicked( int index );
+  virtual void slotFilterChanged();
+  virtual void slotClearFilters();
 
 protected:
-  void updateInterface();
-  QString searchText;
-  int sortColumn;
-  Qt::SortOrder sortOrder;
+  // counts the listed studies by each filter's values, using cached counts if possible
+  void updateFacets();
+  void finishFacetJob( Birch::Job *job );
+  void showFacet( int facet, const Birch::StudyQuery::FacetCounts &counts );
+  QComboBox* getFacetComboBox( int facet );
+
+  // the studies are read from the database a page at a time as they are displayed
+  QStudyTableModel *model;
+
+  // the list is searched once the user pauses typing
+  QTimer *searchTimer;
+
+  // counts the facets which weren't cached when the filters last changed
+  vtkSmartPointer< Birch::StudyFacetJob > facetJob;
+
+  // refreshes the list whenever a background job adds studies and shows facet counts
+  vtkSmartPointer< Command > observer;
 
 protected slots:
 
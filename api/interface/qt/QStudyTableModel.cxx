@@ -0,0 +1,362 @@
+/*=========================================================================
+
+  Program:  Birch (CLSA Retinal Image Viewer)
+  Module:   QStudyTableModel.cxx
+  Language: C++
+
+  Author: Patrick Emond <emondpd@mcmaster.ca>
+  Author: Dean Inglis <inglisd@mcmaster.ca>
+
+=========================================================================*/
+#include "QStudyTableModel.h"
+
+#include "Application.h"
+#include "JobScheduler.h"
+#include "StudyCountJob.h"
+#include "StudyPageJob.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <stdexcept>
+
+//-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+QStudyTableModel::QStudyTableModel( QObject* parent )
+  : QAbstractTableModel( parent )
+{
+  this->query = vtkSmartPointer< Birch::StudyQuery >::New();
+  this->count = 0;
+  this->countKnown = false;
+  this->queryTime = 0;
+  this->pageSize = 100;
+  this->maximumNumberOfPages = 20;
+  this->numberOfPrefetchPages = 1;
+  this->currentPage = -1;
+
+  this->jobObserver = vtkSmartPointer< Command >::New();
+  this->jobObserver->model = this;
+  Birch::Application::GetInstance()->GetScheduler()->AddObserver(
+    Birch::JobScheduler::JobFinishedEvent, this->jobObserver );
+}
+
+//-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+QStudyTableModel::~QStudyTableModel()
+{
+  Birch::Application::GetInstance()->GetScheduler()->RemoveObserver( this->jobObserver );
+  if( this->countJob ) this->countJob->Cancel();
+  this->clearPages();
+}
+
+//-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+int QStudyTableModel::rowCount( const QModelIndex &parent ) const
+{
+  return parent.isValid() ? 0 : this->count;
+}
+
+//-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+int QStudyTableModel::columnCount( const QModelIndex &parent ) const
+{
+  return parent.isValid() ? 0 : Birch::StudyQuery::NumberOfColumns;
+}
+
+//-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+QVariant QStudyTableModel::data( const QModelIndex &index, int role ) const
+{
+  if( !index.isValid() || Qt::DisplayRole != role ) return QVariant();
+
+  int page = index.row() / this->pageSize;
+  if( page != this->currentPage )
+  {
+    this->currentPage = page;
+
+    // read the pages around the one being displayed and stop reading pages which
+    // have been scrolled past
+    for( int offset = 1; offset <= this->numberOfPrefetchPages; ++offset )
+    {
+      this->requestPage( page + offset );
+      this->requestPage( page - offset );
+    }
+
+    std::map< int, vtkSmartPointer< Birch::StudyPageJob > >::iterator jobIt = this->pageJobs.begin();
+    while( jobIt != this->pageJobs.end() )
+    {
+      if( this->numberOfPrefetchPages + 1 < abs( jobIt->first - page ) )
+      {
+        jobIt->second->Cancel();
+        this->pageJobs.erase( jobIt++ );
+      }
+      else ++jobIt;
+    }
+  }
+
+  // pages read without the scheduler's worker threads are available right away
+  std::map< int, std::vector< Birch::StudyQuery::Row > >::iterator it = this->pages.find( page );
+  if( this->pages.end() == it )
+  {
+    this->requestPage( page );
+    it = this->pages.find( page );
+  }
+
+  if( this->pages.end() != it )
+  {
+    if( this->pageUsage.front() != page )
+    {
+      this->pageUsage.remove( page );
+      this->pageUsage.push_front( page );
+    }
+
+    unsigned int row = index.row() % this->pageSize;
+    if( row < it->second.size() )
+      return QString( it->second[row].Values[index.column()].c_str() );
+  }
+  else if( Birch::StudyQuery::UIDColumn == index.column() )
+  {
+    return this->failedPages.end() == this->failedPages.find( page ) ?
+      tr( "Loading..." ) : tr( "(unavailable)" );
+  }
+
+  return QVariant();
+}
+
+//-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+QVariant QStudyTableModel::headerData( int section, Qt::Orientation orientation, int role ) const
+{
+  if( Qt::Horizontal != orientation || Qt::DisplayRole != role ) return QVariant();
+
+  if( Birch::StudyQuery::UIDColumn == section ) return tr( "UID" );
+  else if( Birch::StudyQuery::SiteColumn == section ) return tr( "Site" );
+  else if( Birch::StudyQuery::InterviewerColumn == section ) return tr( "Interviewer" );
+  else if( Birch::StudyQuery::DatetimeAcquiredColumn == section ) return tr( "Date" );
+  return QVariant();
+}
+
+//-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+void QStudyTableModel::sort( int column, Qt::SortOrder order )
+{
+  // the database does the sorting, so the list is simply read again (the number of
+  // studies doesn't change)
+  this->query->SetSortColumn( column );
+  this->query->SetSortAscending( Qt::AscendingOrder == order );
+  this->reset( false );
+}
+
+//-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+void QStudyTableModel::setSearchText( const QString &text )
+{
+  this->query->SetSearchText( text.trimmed().toStdString() );
+  this->update();
+}
+
+//-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+void QStudyTableModel::update()
+{
+  // the query's setters only modify it when a value actually changes
+  if( this->query->GetMTime() > this->queryTime ) this->reset( true );
+}
+
+//-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+void QStudyTableModel::reset( bool recount )
+{
+  this->queryTime = this->query->GetMTime();
+  this->beginResetModel();
+  this->clearPages();
+  if( recount )
+  {
+    this->count = 0;
+    this->countKnown = false;
+  }
+  this->endResetModel();
+
+  // the first page is read alongside the count so that rows appear as soon as possible
+  if( recount ) this->requestCount();
+  this->requestPage( 0 );
+}
+
+//-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+void QStudyTableModel::invalidate()
+{
+  // the rows are kept until the studies have been counted again
+  this->clearPages();
+  this->requestCount();
+
+  // the view reads whichever rows it is displaying again
+  if( 0 < this->count )
+    emit dataChanged(
+      this->index( 0, 0 ),
+      this->index( this->count - 1, Birch::StudyQuery::NumberOfColumns - 1 ) );
+}
+
+//-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+void QStudyTableModel::requestCount()
+{
+  if( this->countJob )
+  {
+    this->countJob->Cancel();
+    this->countJob = NULL;
+  }
+
+  // without worker threads the studies are counted right away
+  Birch::JobScheduler *scheduler = Birch::Application::GetInstance()->GetScheduler();
+  if( !scheduler->IsRunning() )
+  {
+    try
+    {
+      this->setCount( this->query->GetCount() );
+    }
+    catch( std::exception& )
+    {
+      // the rows which have been read are all that can be shown
+    }
+    return;
+  }
+
+  this->countJob = vtkSmartPointer< Birch::StudyCountJob >::New();
+  this->countJob->SetQuery( this->query );
+  scheduler->Submit( this->countJob );
+}
+
+//-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+void QStudyTableModel::setCount( int newCount )
+{
+  this->countKnown = true;
+  if( newCount > this->count )
+  {
+    this->beginInsertRows( QModelIndex(), this->count, newCount - 1 );
+    this->count = newCount;
+    this->endInsertRows();
+  }
+  else if( newCount < this->count )
+  {
+    this->beginRemoveRows( QModelIndex(), newCount, this->count - 1 );
+    this->count = newCount;
+    this->endRemoveRows();
+  }
+}
+
+//-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+int QStudyTableModel::studyId( int row ) const
+{
+  std::map< int, std::vector< Birch::StudyQuery::Row > >::const_iterator it =
+    this->pages.find( row / this->pageSize );
+  if( this->pages.end() == it ) return 0;
+
+  unsigned int pageRow = row % this->pageSize;
+  return pageRow < it->second.size() ? it->second[pageRow].Id : 0;
+}
+
+//-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+void QStudyTableModel::requestPage( int page ) const
+{
+  // until the studies have been counted only the first page is read
+  if( 0 > page || ( this->countKnown ? page * this->pageSize >= this->count : 0 < page ) ) return;
+  if( this->pages.end() != this->pages.find( page ) ||
+      this->pageJobs.end() != this->pageJobs.find( page ) ||
+      this->failedPages.end() != this->failedPages.find( page ) ) return;
+
+  // without worker threads the page is read right away
+  Birch::JobScheduler *scheduler = Birch::Application::GetInstance()->GetScheduler();
+  if( !scheduler->IsRunning() )
+  {
+    try
+    {
+      std::vector< Birch::StudyQuery::Row > rows;
+      this->query->GetRows( page * this->pageSize, this->pageSize, rows );
+      this->addPage( page, rows );
+    }
+    catch( std::exception& )
+    {
+      this->failedPages.insert( page );
+    }
+    return;
+  }
+
+  vtkSmartPointer< Birch::StudyPageJob > job = vtkSmartPointer< Birch::StudyPageJob >::New();
+  job->SetQuery( this->query );
+  job->SetPage( page );
+  job->SetPageSize( this->pageSize );
+  this->pageJobs[page] = job;
+  scheduler->Submit( job );
+}
+
+//-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+void QStudyTableModel::addPage( int page, const std::vector< Birch::StudyQuery::Row > &rows ) const
+{
+  this->pages[page] = rows;
+  this->pageUsage.remove( page );
+  this->pageUsage.push_front( page );
+
+  while( (int) this->pages.size() > this->maximumNumberOfPages )
+  {
+    this->pages.erase( this->pageUsage.back() );
+    this->pageUsage.pop_back();
+  }
+}
+
+//-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+void QStudyTableModel::finishJob( Birch::Job *job )
+{
+  if( job == this->countJob.GetPointer() )
+  {
+    vtkSmartPointer< Birch::StudyCountJob > finishedJob = this->countJob;
+    this->countJob = NULL;
+    if( Birch::Job::FINISHED == finishedJob->GetState() ) this->setCount( finishedJob->GetCount() );
+    return;
+  }
+
+  // jobs of a previous query, or which were cancelled, are no longer in the list
+  std::map< int, vtkSmartPointer< Birch::StudyPageJob > >::iterator it;
+  for( it = this->pageJobs.begin(); it != this->pageJobs.end(); ++it )
+    if( it->second.GetPointer() == job ) break;
+  if( this->pageJobs.end() == it ) return;
+
+  int page = it->first;
+  vtkSmartPointer< Birch::StudyPageJob > pageJob = it->second;
+  this->pageJobs.erase( it );
+
+  if( Birch::Job::FINISHED == pageJob->GetState() )
+  {
+    std::vector< Birch::StudyQuery::Row > rows;
+    pageJob->TakeRows( rows );
+    this->addPage( page, rows );
+
+    // rows arriving before the count are shown right away
+    int end = page * this->pageSize + rows.size();
+    if( !this->countKnown && end > this->count )
+    {
+      this->beginInsertRows( QModelIndex(), this->count, end - 1 );
+      this->count = end;
+      this->endInsertRows();
+    }
+  }
+  else if( Birch::Job::FAILED == pageJob->GetState() )
+  {
+    // failed pages aren't read again until the list is refreshed
+    this->failedPages.insert( page );
+  }
+  else return;
+
+  int first = page * this->pageSize;
+  int last = std::min( this->count, first + this->pageSize ) - 1;
+  if( first <= last )
+    emit dataChanged(
+      this->index( first, 0 ),
+      this->index( last, Birch::StudyQuery::NumberOfColumns - 1 ) );
+}
+
+//-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+void QStudyTableModel::clearPages()
+{
+  std::map< int, vtkSmartPointer< Birch::StudyPageJob > >::iterator it;
+  for( it = this->pageJobs.begin(); it != this->pageJobs.end(); ++it ) it->second->Cancel();
+  this->pageJobs.clear();
+  this->pages.clear();
+  this->pageUsage.clear();
+  this->failedPages.clear();
+  this->currentPage = -1;
+}
+
+//-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+void QStudyTableModel::Command::Execute(
+  vtkObject *caller, unsigned long eventId, void *callData )
+{
+  if( this->model ) this->model->finishJob( static_cast<Birch::Job*>( callData ) );
+}
@@ -0,0 +1,110 @@
+/*=========================================================================
+
+  Program:  Birch (CLSA Retinal Image Viewer)
+  Module:   QStudyTableModel.h
+  Language: C++
+
+  Author: Patrick Emond <emondpd@mcmaster.ca>
+  Author: Dean Inglis <inglisd@mcmaster.ca>
+
+=========================================================================*/
+
+#ifndef __QStudyTableModel_h
+#define __QStudyTableModel_h
+
+#include <QAbstractTableModel>
+
+#include "StudyQuery.h"
+
+#include "vtkCommand.h"
+#include "vtkSmartPointer.h"
+
+#include <list>
+#include <map>
+#include <set>
+#include <vector>
+
+namespace Birch { class Job; class StudyCountJob; class StudyPageJob; };
+
+// Lists the studies matching a Birch::StudyQuery one page at a time.  The number of
+// matching studies and the pages of rows are read by background jobs, pages as the
+// view asks for their rows (along with the pages on either side of them), and the
+// least recently used pages are dropped once too many have been read.  Rows of the
+// first page are shown as soon as they arrive, even before the studies have been
+// counted, and jobs reading a list which has since changed are cancelled (which
+// interrupts their queries).
+class QStudyTableModel : public QAbstractTableModel
+{
+  Q_OBJECT
+private:
+  class Command : public vtkCommand
+  {
+  public:
+    static Command *New() { return new Command; }
+    void Execute( vtkObject *caller, unsigned long eventId, void *callData );
+    QStudyTableModel *model;
+
+  protected:
+    Command() { this->model = NULL; }
+  };
+
+public:
+  //constructor
+  QStudyTableModel( QObject* parent = 0 );
+  //destructor
+  ~QStudyTableModel();
+
+  int rowCount( const QModelIndex &parent = QModelIndex() ) const;
+  int columnCount( const QModelIndex &parent = QModelIndex() ) const;
+  QVariant data( const QModelIndex &index, int role = Qt::DisplayRole ) const;
+  QVariant headerData( int section, Qt::Orientation orientation, int role = Qt::DisplayRole ) const;
+  void sort( int column, Qt::SortOrder order = Qt::AscendingOrder );
+
+  // lists only studies matching the search text (see Birch::StudyQuery)
+  void setSearchText( const QString &text );
+
+  // the query listing the studies, update() must be called once it has been changed
+  Birch::StudyQuery* getQuery() { return this->query; }
+
+  // re-reads the list if the query has been changed since it was last read
+  void update();
+
+  // re-reads the list (the view is reset)
+  void refresh() { this->reset( true ); }
+
+  // re-reads the list after studies have been added or changed, keeping the view's
+  // position in the list
+  void invalidate();
+
+  // returns the id of the study in a row, or 0 if the row hasn't been read yet
+  int studyId( int row ) const;
+
+protected:
+  void reset( bool recount );
+  void requestCount();
+  void setCount( int newCount );
+  void requestPage( int page ) const;
+  void addPage( int page, const std::vector< Birch::StudyQuery::Row > &rows ) const;
+  void finishJob( Birch::Job *job );
+  void clearPages();
+
+  vtkSmartPointer< Birch::StudyQuery > query;
+  vtkSmartPointer< Birch::StudyCountJob > countJob;
+  int count;
+  bool countKnown; // false until the list's studies have been counted
+  unsigned long queryTime; // the query's modified time when the list was last read
+  int pageSize;
+  int maximumNumberOfPages;
+  int numberOfPrefetchPages;
+
+  // pages are read on demand, so the cache is changed by the (const) view accessors
+  mutable std::map< int, std::vector< Birch::StudyQuery::Row > > pages;
+  mutable std::list< int > pageUsage; // most recently used first
+  mutable std::map< int, vtkSmartPointer< Birch::StudyPageJob > > pageJobs;
+  mutable std::set< int > failedPages;
+  mutable int currentPage;
+
+  vtkSmartPointer< Command > jobObserver;
+};
+
+#endif
@@ -0,0 +1,260 @@
+/*=========================================================================
+
+  Program:  Birch (CLSA Retinal Image Viewer)
+  Module:   QStudyTreeModel.cxx
+  Language: C++
+
+  Author: Patrick Emond <emondpd@mcmaster.ca>
+  Author: Dean Inglis <inglisd@mcmaster.ca>
+
+=========================================================================*/
+#include "QStudyTreeModel.h"
+
+#include "Application.h"
+#include "Image.h"
+#include "Rating.h"
+#include "RatingWriter.h"
+#include "Study.h"
+
+#include <QApplication>
+#include <QStyle>
+
+#include <map>
+#include <stdexcept>
+
+// the study is the only top level row, its images are its children
+static const quint32 StudyItem = 0;
+static const quint32 ImageItem = 1;
+
+//-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+QStudyTreeModel::QStudyTreeModel( QObject* parent )
+  : QAbstractItemModel( parent )
+{
+  this->studyId = 0;
+  this->userId = 0;
+  this->fetched = false;
+}
+
+//-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+QStudyTreeModel::~QStudyTreeModel()
+{
+}
+
+//-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+QModelIndex QStudyTreeModel::index( int row, int column, const QModelIndex &parent ) const
+{
+  if( !this->hasIndex( row, column, parent ) ) return QModelIndex();
+  return parent.isValid() ?
+    this->createIndex( row, column, ImageItem ) :
+    this->createIndex( row, column, StudyItem );
+}
+
+//-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+QModelIndex QStudyTreeModel::parent( const QModelIndex &index ) const
+{
+  if( !index.isValid() || StudyItem == index.internalId() ) return QModelIndex();
+  return this->createIndex( 0, 0, StudyItem );
+}
+
+//-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+int QStudyTreeModel::rowCount( const QModelIndex &parent ) const
+{
+  if( !parent.isValid() ) return this->study ? 1 : 0;
+  return StudyItem == parent.internalId() && 0 == parent.column() ? this->images.size() : 0;
+}
+
+//-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+int QStudyTreeModel::columnCount( const QModelIndex &parent ) const
+{
+  return 1;
+}
+
+//-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+QVariant QStudyTreeModel::data( const QModelIndex &index, int role ) const
+{
+  if( !index.isValid() ) return QVariant();
+
+  if( StudyItem == index.internalId() )
+  {
+    if( Qt::DisplayRole == role ) return tr( "Study: %1" ).arg( this->studyUID );
+    return QVariant();
+  }
+
+  const Entry &entry = this->images[index.row()];
+  if( Qt::DisplayRole == role )
+  {
+    return tr( "Laterality: %1" ).arg( entry.laterality );
+  }
+  else if( Qt::DecorationRole == role )
+  {
+    // rated images are badged so that the ones left to rate stand out
+    if( 0 < entry.rating ) return QApplication::style()->standardIcon( QStyle::SP_DialogApplyButton );
+  }
+  else if( Qt::ToolTipRole == role )
+  {
+    return 0 < entry.rating ? tr( "Rated %1" ).arg( entry.rating ) : tr( "Not rated" );
+  }
+
+  return QVariant();
+}
+
+//-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+Qt::ItemFlags QStudyTreeModel::flags( const QModelIndex &index ) const
+{
+  if( !index.isValid() ) return 0;
+  return StudyItem == index.internalId() ?
+    Qt::ItemIsEnabled : Qt::ItemIsSelectable | Qt::ItemIsEnabled;
+}
+
+//-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+bool QStudyTreeModel::hasChildren( const QModelIndex &parent ) const
+{
+  // the study is expandable until its images have been read and found to be empty
+  if( !parent.isValid() ) return this->study;
+  if( StudyItem != parent.internalId() ) return false;
+  return !this->fetched || !this->images.empty();
+}
+
+//-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+bool QStudyTreeModel::canFetchMore( const QModelIndex &parent ) const
+{
+  return parent.isValid() && StudyItem == parent.internalId() && !this->fetched;
+}
+
+//-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+void QStudyTreeModel::fetchMore( const QModelIndex &parent )
+{
+  if( !this->canFetchMore( parent ) ) return;
+  this->fetched = true;
+
+  std::vector< vtkSmartPointer< Birch::Image > > imageList;
+  std::vector< vtkSmartPointer< Birch::Image > >::iterator it;
+  this->study->GetList( &imageList );
+  if( imageList.empty() ) return;
+
+  this->beginInsertRows( parent, 0, imageList.size() - 1 );
+  for( it = imageList.begin(); it != imageList.end(); ++it )
+  {
+    Entry entry;
+    entry.image = *it;
+    entry.id = ( *it )->Get( "id" ).ToInt();
+    entry.laterality = ( *it )->Get( "laterality" ).ToString().c_str();
+    entry.rating = 0;
+    this->images.push_back( entry );
+  }
+  this->endInsertRows();
+
+  this->readRatings();
+}
+
+//-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+void QStudyTreeModel::setStudy( Birch::Study *study )
+{
+  int id = study ? study->Get( "id" ).ToInt() : 0;
+  if( id == this->studyId ) return;
+
+  this->beginResetModel();
+  this->study = study;
+  this->studyId = id;
+  this->studyUID = study ? study->Get( "uid" ).ToString().c_str() : "";
+  this->fetched = false;
+  this->images.clear();
+  this->endResetModel();
+}
+
+//-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+void QStudyTreeModel::setUserId( int userId )
+{
+  if( userId == this->userId ) return;
+  this->userId = userId;
+  this->readRatings();
+}
+
+//-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+void QStudyTreeModel::setRating( int imageId, int value )
+{
+  for( unsigned int row = 0; row < this->images.size(); ++row )
+  {
+    if( imageId == this->images[row].id )
+    {
+      this->images[row].rating = value;
+      QModelIndex index = this->index( row, 0, this->index( 0, 0 ) );
+      emit dataChanged( index, index );
+      return;
+    }
+  }
+}
+
+//-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+Birch::Image* QStudyTreeModel::image( const QModelIndex &index ) const
+{
+  if( !index.isValid() || ImageItem != index.internalId() ) return NULL;
+  return this->images[index.row()].image;
+}
+
+//-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+QModelIndex QStudyTreeModel::imageIndex( int imageId )
+{
+  if( !this->study ) return QModelIndex();
+
+  QModelIndex studyIndex = this->index( 0, 0 );
+  this->fetchMore( studyIndex );
+  for( unsigned int row = 0; row < this->images.size(); ++row )
+    if( imageId == this->images[row].id ) return this->index( row, 0, studyIndex );
+
+  return QModelIndex();
+}
+
+//-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+QModelIndex QStudyTreeModel::nextUnratedIndex( const QModelIndex &index )
+{
+  if( !this->study ) return QModelIndex();
+
+  QModelIndex studyIndex = this->index( 0, 0 );
+  this->fetchMore( studyIndex );
+
+  // an invalid index (or the study's row) starts the search at the first image
+  int size = this->images.size();
+  int current = index.isValid() && ImageItem == index.internalId() ? index.row() : -1;
+  for( int offset = 1; offset <= size; ++offset )
+  {
+    int row = ( current + offset ) % size;
+    if( row != current && 0 == this->images[row].rating ) return this->index( row, 0, studyIndex );
+  }
+
+  return QModelIndex();
+}
+
+//-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+void QStudyTreeModel::readRatings()
+{
+  if( this->images.empty() ) return;
+
+  std::map< int, int > ratings;
+  if( 0 != this->userId )
+  {
+    try
+    {
+      Birch::Rating::GetStudyRatings( this->userId, this->studyId, ratings );
+    }
+    catch( std::exception& )
+    {
+      // images are shown unrated rather than not at all
+    }
+  }
+
+  // ratings which haven't been written yet are newer than the database's
+  Birch::RatingWriter *writer = Birch::Application::GetInstance()->GetRatingWriter();
+  std::vector< Entry >::iterator it;
+  for( it = this->images.begin(); it != this->images.end(); ++it )
+  {
+    std::map< int, int >::iterator ratingIt = ratings.find( it->id );
+    it->rating = ratings.end() == ratingIt ? 0 : ratingIt->second;
+    if( 0 != this->userId ) writer->GetRating( this->userId, it->id, it->rating );
+  }
+
+  QModelIndex studyIndex = this->index( 0, 0 );
+  emit dataChanged(
+    this->index( 0, 0, studyIndex ),
+    this->index( this->images.size() - 1, 0, studyIndex ) );
+}
@@ -0,0 +1,84 @@
+/*=========================================================================
+
+  Program:  Birch (CLSA Retinal Image Viewer)
+  Module:   QStudyTreeModel.h
+  Language: C++
+
+  Author: Patrick Emond <emondpd@mcmaster.ca>
+  Author: Dean Inglis <inglisd@mcmaster.ca>
+
+=========================================================================*/
+
+#ifndef __QStudyTreeModel_h
+#define __QStudyTreeModel_h
+
+#include <QAbstractItemModel>
+
+#include "vtkSmartPointer.h"
+
+#include <vector>
+
+namespace Birch { class Image; class Study; };
+
+// Shows a study and its images as a tree.  The study's images are only read once the
+// study's row is expanded, and the user's ratings of all of them are read by a single
+// query so that rated images can be marked.  Changing the study resets the tree, while
+// a rating change only updates the rated image's row.
+class QStudyTreeModel : public QAbstractItemModel
+{
+  Q_OBJECT
+public:
+  //constructor
+  QStudyTreeModel( QObject* parent = 0 );
+  //destructor
+  ~QStudyTreeModel();
+
+  QModelIndex index( int row, int column, const QModelIndex &parent = QModelIndex() ) const;
+  QModelIndex parent( const QModelIndex &index ) const;
+  int rowCount( const QModelIndex &parent = QModelIndex() ) const;
+  int columnCount( const QModelIndex &parent = QModelIndex() ) const;
+  QVariant data( const QModelIndex &index, int role = Qt::DisplayRole ) const;
+  Qt::ItemFlags flags( const QModelIndex &index ) const;
+  bool hasChildren( const QModelIndex &parent = QModelIndex() ) const;
+  bool canFetchMore( const QModelIndex &parent ) const;
+  void fetchMore( const QModelIndex &parent );
+
+  // shows a study (or nothing if null), the tree is only reset if the study changes
+  void setStudy( Birch::Study *study );
+
+  // marks the images rated by a user (none if 0)
+  void setUserId( int userId );
+
+  // updates the row of a single image after it has been rated (0 removes the rating)
+  void setRating( int imageId, int value );
+
+  // returns the image in a row, or null if the row isn't an image
+  Birch::Image* image( const QModelIndex &index ) const;
+
+  // returns the row of an image, reading the study's images if necessary
+  QModelIndex imageIndex( int imageId );
+
+  // returns the first unrated image after an image's row (wrapping around to the first
+  // image), or an invalid index if every other image has been rated
+  QModelIndex nextUnratedIndex( const QModelIndex &index );
+
+protected:
+  void readRatings();
+
+  struct Entry
+  {
+    vtkSmartPointer< Birch::Image > image;
+    int id;
+    QString laterality;
+    int rating;
+  };
+
+  vtkSmartPointer< Birch::Study > study;
+  int studyId;
+  QString studyUID;
+  int userId;
+  bool fetched; // whether the study's images have been read
+  std::vector< Entry > images;
+};
+
+#endif
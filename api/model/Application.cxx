@@ -14,14 +14,23 @@
 #include "Configuration.h"
 #include "Database.h"
 #include "Image.h"
+#include "ImageCache.h"
+#include "JobScheduler.h"
 #include "OpalService.h"
 #include "Rating.h"
+#include "RatingWriter.h"
+#include "StudyFacetCache.h"
 #include "Study.h"
+#include "StudyLease.h"
 #include "User.h"
 
+#include "vtkBirchMySQLDatabase.h"
+#include "vtkMutexLock.h"
 #include "vtkObjectFactory.h"
+#include "vtkSmartPointer.h"
 #include "vtkVariant.h"
 
+#include <map>
 #include <stdexcept>
 
 namespace Birch
@@ -34,6 +43,18 @@ namespace Birch
     this->Config = Configuration::New();
     this->DB = Database::New();
     this->Opal = OpalService::New();
+    this->Scheduler = JobScheduler::New();
+    this->Cache = ImageCache::New();
+    this->Cache->SetScheduler( this->Scheduler );
+    this->Writer = RatingWriter::New();
+    this->Writer->SetScheduler( this->Scheduler );
+    this->FacetCache = StudyFacetCache::New();
+    this->FacetCache->SetScheduler( this->Scheduler );
+    this->FacetCache->SetRatingWriter( this->Writer );
+    this->ThreadDBLock = vtkSimpleMutexLock::New();
+    this->ActiveUser = NULL;
+    this->ActiveStudy = NULL;
+    this->ActiveImage = NULL;
     this->ResetApplication();
 
     // populate the constructor and class name registries with all active record classes
@@ -43,6 +64,8 @@ namespace Birch
     this->ClassNameRegistry["Rating"] = typeid(Rating).name();
     this->ConstructorRegistry["Study"] = &createInstance<Study>;
     this->ClassNameRegistry["Study"] = typeid(Study).name();
+    this->ConstructorRegistry["StudyLease"] = &createInstance<StudyLease>;
+    this->ClassNameRegistry["StudyLease"] = typeid(StudyLease).name();
     this->ConstructorRegistry["User"] = &createInstance<User>;
     this->ClassNameRegistry["User"] = typeid(User).name();
   }
@@ -50,6 +73,49 @@ namespace Birch
   //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
   Application::~Application()
   {
+    // the caches observe the scheduler so they must be removed first
+    if( NULL != this->Cache )
+    {
+      this->Cache->Delete();
+      this->Cache = NULL;
+    }
+
+    if( NULL != this->FacetCache )
+    {
+      this->FacetCache->Delete();
+      this->FacetCache = NULL;
+    }
+
+    // the scheduler's threads must end before the objects they use are removed
+    if( NULL != this->Scheduler ) this->Scheduler->Stop();
+
+    // ratings which haven't been written yet are written before exiting
+    if( NULL != this->Writer )
+    {
+      try
+      {
+        this->Writer->FlushNow();
+      }
+      catch( std::exception &e )
+      {
+        cerr << "ERROR: unable to write ratings: " << e.what() << endl;
+      }
+      this->Writer->Delete();
+      this->Writer = NULL;
+    }
+
+    if( NULL != this->Scheduler )
+    {
+      this->Scheduler->Delete();
+      this->Scheduler = NULL;
+    }
+
+    if( NULL != this->ThreadDBLock )
+    {
+      this->ThreadDBLock->Delete();
+      this->ThreadDBLock = NULL;
+    }
+
     if( NULL != this->Config )
     {
       this->Config->Delete();
@@ -165,7 +231,107 @@ namespace Birch
     std::string pass = this->Config->GetValue( "Opal", "Password" );
     std::string host = this->Config->GetValue( "Opal", "Host" );
     std::string port = this->Config->GetValue( "Opal", "Port" );
-    this->Opal->Setup( user, pass, host, vtkVariant( port ).ToInt() );
+    std::string protocol = this->Config->GetValue( "Opal", "Protocol" );
+    this->Opal->Setup(
+      user, pass, host, vtkVariant( port ).ToInt(), 0 == protocol.length() ? "https" : protocol );
+
+    // memoized values are bounded in number and age (in seconds)
+    std::string cacheSize = this->Config->GetValue( "Opal", "CacheSize" );
+    if( 0 < cacheSize.length() ) this->Opal->SetCacheSize( vtkVariant( cacheSize ).ToInt() );
+    std::string cacheExpiry = this->Config->GetValue( "Opal", "CacheExpiry" );
+    if( 0 < cacheExpiry.length() ) this->Opal->SetCacheExpiry( vtkVariant( cacheExpiry ).ToDouble() );
+  }
+
+  //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+  void Application::SetupScheduler()
+  {
+    // default to two worker threads
+    std::string threads = this->Config->GetValue( "Scheduler", "Threads" );
+    this->Scheduler->Start( 0 == threads.length() ? 2 : vtkVariant( threads ).ToInt() );
+  }
+
+  //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+  void Application::SetupImageCache()
+  {
+    // the memory limit is in megabytes
+    std::string limit = this->Config->GetValue( "ImageCache", "MemoryLimit" );
+    if( 0 < limit.length() ) this->Cache->SetMemoryLimit( vtkVariant( limit ).ToInt() );
+    std::string studies = this->Config->GetValue( "ImageCache", "PrefetchStudies" );
+    if( 0 < studies.length() ) this->Cache->SetNumberOfPrefetchStudies( vtkVariant( studies ).ToInt() );
+  }
+
+  //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+  void Application::SetupRatingWriter()
+  {
+    // the delays are in seconds
+    std::string delay = this->Config->GetValue( "Ratings", "FlushDelay" );
+    if( 0 < delay.length() ) this->Writer->SetFlushDelay( vtkVariant( delay ).ToDouble() );
+    std::string retry = this->Config->GetValue( "Ratings", "MaximumRetryDelay" );
+    if( 0 < retry.length() ) this->Writer->SetMaximumRetryDelay( vtkVariant( retry ).ToDouble() );
+  }
+
+  //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+  void Application::SetupStudyFacetCache()
+  {
+    // the expiry is in seconds
+    std::string expiry = this->Config->GetValue( "StudyBrowser", "FacetCacheExpiry" );
+    if( 0 < expiry.length() ) this->FacetCache->SetExpiry( vtkVariant( expiry ).ToDouble() );
+  }
+
+  //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+  void Application::InitializeThread()
+  {
+    vtkBirchMySQLDatabase::ThreadInitialize();
+    Database *db = this->DB->NewConnection();
+
+    this->ThreadDBLock->Lock();
+    this->ThreadDBList.push_back( std::pair< vtkMultiThreaderIDType, Database* >(
+      vtkMultiThreader::GetCurrentThreadID(), db ) );
+    this->ThreadDBLock->Unlock();
+  }
+
+  //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+  void Application::FinalizeThread()
+  {
+    Database *db = NULL;
+    vtkMultiThreaderIDType id = vtkMultiThreader::GetCurrentThreadID();
+
+    this->ThreadDBLock->Lock();
+    std::vector< std::pair< vtkMultiThreaderIDType, Database* > >::iterator it;
+    for( it = this->ThreadDBList.begin(); it != this->ThreadDBList.end(); ++it )
+    {
+      if( vtkMultiThreader::ThreadsEqual( id, it->first ) )
+      {
+        db = it->second;
+        this->ThreadDBList.erase( it );
+        break;
+      }
+    }
+    this->ThreadDBLock->Unlock();
+
+    if( db ) db->Delete();
+    vtkBirchMySQLDatabase::ThreadFinalize();
+  }
+
+  //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+  Database* Application::GetDB()
+  {
+    Database *db = this->DB;
+    vtkMultiThreaderIDType id = vtkMultiThreader::GetCurrentThreadID();
+
+    this->ThreadDBLock->Lock();
+    std::vector< std::pair< vtkMultiThreaderIDType, Database* > >::iterator it;
+    for( it = this->ThreadDBList.begin(); it != this->ThreadDBList.end(); ++it )
+    {
+      if( vtkMultiThreader::ThreadsEqual( id, it->first ) )
+      {
+        db = it->second;
+        break;
+      }
+    }
+    this->ThreadDBLock->Unlock();
+
+    return db;
   }
 
   //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
@@ -181,9 +347,22 @@ namespace Birch
   {
     if( user != this->ActiveUser )
     {
-      if( this->ActiveUser ) this->ActiveUser->UnRegister( this );
+      this->Writer->Flush();
+      if( this->ActiveUser )
+      {
+        // the user's study goes back to the other raters (or expires if this fails)
+        try
+        {
+          StudyLease::Release( this->ActiveUser );
+        }
+        catch( std::exception& )
+        {
+        }
+        this->ActiveUser->UnRegister( this );
+      }
       this->ActiveUser = user;
       if( this->ActiveUser ) this->ActiveUser->Register( this );
+      this->InvokeEvent( Application::ActiveUserChangedEvent, user );
 
       if( this->ActiveUser )
       {
@@ -201,6 +380,10 @@ namespace Birch
   {
     if( study != this->ActiveStudy )
     {
+      // the same study may be loaded into a different record object
+      if( study && this->ActiveStudy &&
+          study->Get( "id" ).ToInt() == this->ActiveStudy->Get( "id" ).ToInt() ) return;
+
       if( this->ActiveStudy ) this->ActiveStudy->UnRegister( this );
       this->ActiveStudy = study;
       if( this->ActiveStudy ) this->ActiveStudy->Register( this );
@@ -214,6 +397,7 @@ namespace Birch
         this->ActiveUser->Save();
       }
       this->Modified();
+      this->InvokeEvent( Application::ActiveStudyChangedEvent, study );
     }
   }
 
@@ -222,10 +406,50 @@ namespace Birch
   {
     if( image != this->ActiveImage )
     {
+      if( image && this->ActiveImage &&
+          image->Get( "id" ).ToInt() == this->ActiveImage->Get( "id" ).ToInt() ) return;
+
+      // the rating of the image being left is written right away
+      this->Writer->Flush();
       if( this->ActiveImage ) this->ActiveImage->UnRegister( this );
       this->ActiveImage = image;
       if( this->ActiveImage ) this->ActiveImage->Register( this );
       this->Modified();
+      this->InvokeEvent( Application::ActiveImageChangedEvent, image );
+    }
+  }
+
+  //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+  void Application::RateActiveImage( int value )
+  {
+    if( !this->ActiveUser ) throw std::runtime_error( "Tried to rate an image without an active user" );
+    if( !this->ActiveImage ) throw std::runtime_error( "Tried to rate an image without an active image" );
+
+    this->Writer->SetRating(
+      this->ActiveUser->Get( "id" ).ToInt(), this->ActiveImage->Get( "id" ).ToInt(), value );
+    this->InvokeEvent( Application::RatingChangedEvent, &value );
+  }
+
+  //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+  int Application::GetActiveImageRating()
+  {
+    if( !this->ActiveUser || !this->ActiveImage ) return 0;
+
+    // ratings which haven't been written yet are newer than the database's
+    int value = 0;
+    if( this->Writer->GetRating(
+          this->ActiveUser->Get( "id" ).ToInt(), this->ActiveImage->Get( "id" ).ToInt(), value ) )
+      return value;
+
+    std::map< std::string, std::string > map;
+    map["user_id"] = this->ActiveUser->Get( "id" ).ToString();
+    map["image_id"] = this->ActiveImage->Get( "id" ).ToString();
+    vtkSmartPointer< Rating > rating = vtkSmartPointer< Rating >::New();
+    if( rating->Load( map ) )
+    {
+      vtkVariant v = rating->Get( "rating" );
+      if( v.IsValid() ) value = v.ToInt();
     }
+    return value;
   }
 }
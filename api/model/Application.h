@@ -23,6 +23,10 @@
  * It includes links to the image viewer, configuration, database, connection
  * to Opal and tracks the state of the application such as active user and
  * study.
+ *
+ * Changes to the application's state are announced by typed events (see
+ * ActiveUserChangedEvent and friends) so that each part of the interface only
+ * refreshes what has changed.
  */
 
 #ifndef __Application_h
@@ -32,8 +36,14 @@
 
 #include "Utilities.h"
 
+#include "vtkCommand.h"
+#include "vtkMultiThreader.h"
+
 #include <iostream>
 #include <stdexcept>
+#include <vector>
+
+class vtkSimpleMutexLock;
 
 /**
  * @addtogroup Birch
@@ -45,8 +55,12 @@ namespace Birch
   class Configuration;
   class Database;
   class Image;
+  class ImageCache;
+  class JobScheduler;
   class OpalService;
+  class RatingWriter;
   class Study;
+  class StudyFacetCache;
   class User;
   class Application : public ModelObject
   {
@@ -54,6 +68,19 @@ namespace Birch
     vtkTypeMacro( Application, ModelObject );
     static Application *GetInstance();
     static void DeleteInstance();
+
+    /**
+     * Events invoked when the state of the application changes, call data is the
+     * new active user, study or image (NULL when it is removed) or, for
+     * RatingChangedEvent, a pointer to the new rating value (an int)
+     */
+    enum Events
+    {
+      ActiveUserChangedEvent = vtkCommand::UserEvent + 300,
+      ActiveStudyChangedEvent,
+      ActiveImageChangedEvent,
+      RatingChangedEvent
+    };
     
     /**
      * Reads configuration variables from a given file
@@ -70,6 +97,39 @@ namespace Birch
      * Uses opal values in the configuration to set up a connection to Opal
      */
     void SetupOpalService();
+
+    /**
+     * Uses scheduler values in the configuration to start the job scheduler's threads
+     */
+    void SetupScheduler();
+
+    /**
+     * Uses image cache values in the configuration to set up the decoded image cache
+     */
+    void SetupImageCache();
+
+    /**
+     * Uses rating values in the configuration to set up the rating write-behind queue
+     */
+    void SetupRatingWriter();
+
+    /**
+     * Uses study browser values in the configuration to set up the facet count cache
+     */
+    void SetupStudyFacetCache();
+
+    /**
+     * Must be called by any thread other than the GUI thread before using active records.
+     * A new database connection is opened and GetDB() will return it when called from
+     * the calling thread.
+     * @throws runtime_error
+     */
+    void InitializeThread();
+
+    /**
+     * Closes the calling thread's database connection (see InitializeThread())
+     */
+    void FinalizeThread();
     
     /**
      * Resets the state of the application to its initial state
@@ -77,8 +137,11 @@ namespace Birch
     void ResetApplication();
 
     vtkGetObjectMacro( Config, Configuration );
-    vtkGetObjectMacro( DB, Database );
     vtkGetObjectMacro( Opal, OpalService );
+    vtkGetObjectMacro( Scheduler, JobScheduler );
+    ImageCache* GetImageCache() { return this->Cache; }
+    RatingWriter* GetRatingWriter() { return this->Writer; }
+    StudyFacetCache* GetStudyFacetCache() { return this->FacetCache; }
     vtkGetObjectMacro( ActiveUser, User );
     vtkGetObjectMacro( ActiveStudy, Study );
     vtkGetObjectMacro( ActiveImage, Image );
@@ -95,7 +158,32 @@ namespace Birch
      */
     virtual void SetActiveStudy( Study* );
 
+    /**
+     * Setting an image with the same id as the active image changes nothing (the same
+     * goes for studies in SetActiveStudy()), so no events are invoked
+     */
     virtual void SetActiveImage( Image* );
+
+    /**
+     * Queues the active user's rating of the active image (0 removes the rating) to be
+     * written by the rating writer and invokes the RatingChangedEvent.  Queued ratings
+     * are written once the rating stops changing or when the active image changes.
+     * @throws runtime_error
+     */
+    void RateActiveImage( int value );
+
+    /**
+     * Returns the active user's rating of the active image (0 if it isn't rated),
+     * including ratings which haven't been written yet
+     */
+    int GetActiveImageRating();
+
+    /**
+     * Returns the database connection belonging to the calling thread.
+     * This is the main connection unless the calling thread has been initialized
+     * using InitializeThread()
+     */
+    Database* GetDB();
     
     /**
      * Creates a new instance of a model object given its class name
@@ -135,6 +223,10 @@ namespace Birch
     Configuration *Config;
     Database *DB;
     OpalService *Opal;
+    JobScheduler *Scheduler;
+    ImageCache *Cache;
+    RatingWriter *Writer;
+    StudyFacetCache *FacetCache;
     User *ActiveUser;
     Study *ActiveStudy;
     Image *ActiveImage;
@@ -145,6 +237,9 @@ namespace Birch
 
     std::map< std::string, ModelObject*(*)() > ConstructorRegistry;
     std::map< std::string, std::string > ClassNameRegistry;
+
+    vtkSimpleMutexLock *ThreadDBLock;
+    std::vector< std::pair< vtkMultiThreaderIDType, Database* > > ThreadDBList;
   };
 
   template <class T> ModelObject* createInstance() { return T::New(); }
@@ -49,11 +49,57 @@ namespace Birch
     this->MySQLDatabase->SetHostName( host.c_str() );
     this->MySQLDatabase->SetServerPort( port );
     bool success = this->MySQLDatabase->Open( pass.c_str() );
+    this->Password = pass;
     this->ReadInformationSchema();
 
     return success;
   }
 
+  //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+  Database* Database::NewConnection()
+  {
+    Database *db = Database::New();
+    db->MySQLDatabase->SetDatabaseName( this->MySQLDatabase->GetDatabaseName() );
+    db->MySQLDatabase->SetUser( this->MySQLDatabase->GetUser() );
+    db->MySQLDatabase->SetHostName( this->MySQLDatabase->GetHostName() );
+    db->MySQLDatabase->SetServerPort( this->MySQLDatabase->GetServerPort() );
+    if( !db->MySQLDatabase->Open( this->Password.c_str() ) )
+    {
+      db->Delete();
+      throw std::runtime_error( "Unable to open a new connection to the database" );
+    }
+    db->Password = this->Password;
+    db->Columns = this->Columns;
+
+    return db;
+  }
+
+  //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+  int Database::GetConnectionId()
+  {
+    // the client library keeps the id of the connection, so the server isn't asked
+    unsigned long id = this->MySQLDatabase->GetConnectionId();
+    if( 0 == id ) throw std::runtime_error( "Unable to get connection id: the database is not open" );
+
+    return static_cast<int>( id );
+  }
+
+  //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+  void Database::KillQuery( int connectionId )
+  {
+    std::stringstream stream;
+    stream << "KILL QUERY " << connectionId;
+
+    vtkSmartPointer<vtkBirchMySQLQuery> query = this->GetQuery();
+    query->SetQuery( stream.str().c_str() );
+    if( !query->Execute() )
+    {
+      std::stringstream error;
+      error << "Unable to interrupt query: " << query->GetLastErrorText();
+      throw std::runtime_error( error.str() );
+    }
+  }
+
   //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
   void Database::ReadInformationSchema()
   {
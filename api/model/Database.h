@@ -68,12 +68,36 @@ namespace Birch
       std::string host,
       int port );
 
+    /**
+     * Opens a second connection to the same database using the parameters of this
+     * connection.  The table metadata is copied rather than re-read.
+     * Note: the database returned must be deleted by the recipient
+     * @throws runtime_error
+     */
+    Database* NewConnection();
+
     /**
      * Returns a vtkBirchMySQLQuery object for performing queries
      * This method should only be used by Model objects.
      */
     vtkSmartPointer<vtkBirchMySQLQuery> GetQuery();
 
+    /**
+     * Returns the server's id of this connection (which may change if the connection
+     * is re-opened, so it should be read right before it is needed).  The id is kept
+     * by the client library so reading it doesn't run a statement.
+     * @throws runtime_error
+     */
+    int GetConnectionId();
+
+    /**
+     * Interrupts the statement being run by another connection (the connection itself
+     * is left open and its statement fails)
+     * @param connectionId int The server's id of the connection (see GetConnectionId())
+     * @throws runtime_error
+     */
+    void KillQuery( int connectionId );
+
     /**
      * Returns a list of column names for a given table
      * @param table string
@@ -116,7 +140,9 @@ namespace Birch
      * information_schema database.
      */
     void ReadInformationSchema();
-    vtkSmartPointer<vtkBirchMySQLDatabase> MySQLDatabase; std::map< std::string,std::map< std::string,std::map< std::string, vtkVariant > > > Columns;
+    vtkSmartPointer<vtkBirchMySQLDatabase> MySQLDatabase;
+    std::string Password;
+    std::map< std::string,std::map< std::string,std::map< std::string, vtkVariant > > > Columns;
 
   private:
     Database( const Database& ); // Not implemented
@@ -16,6 +16,8 @@
 #include "User.h"
 #include "Utilities.h"
 
+#include "vtkBirchDefaultWindowLevel.h"
+#include "vtkImageData.h"
 #include "vtkObjectFactory.h"
 
 #include <stdexcept>
@@ -60,4 +62,31 @@ namespace Birch
     // we have found a rating, make sure it is not null
     return rating->Get( "rating" ).IsValid();
   }
+
+  //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+  void Image::SetupDefaultWindowLevel( vtkImageData *image )
+  {
+    if( !image ) return;
+
+    bool hasColumns = this->ColumnNameExists( "default_window" ) && this->ColumnNameExists( "default_level" );
+    if( hasColumns )
+    {
+      vtkVariant window = this->Get( "default_window" );
+      vtkVariant level = this->Get( "default_level" );
+      if( window.IsValid() && level.IsValid() )
+      {
+        vtkBirchDefaultWindowLevel::Set( image, window.ToDouble(), level.ToDouble() );
+        return;
+      }
+    }
+
+    double window, level;
+    if( vtkBirchDefaultWindowLevel::Compute( image ) && hasColumns &&
+        vtkBirchDefaultWindowLevel::Get( image, window, level ) )
+    {
+      this->Set( "default_window", window );
+      this->Set( "default_level", level );
+      this->Save();
+    }
+  }
 }
@@ -26,6 +26,8 @@
 
 #include <iostream>
 
+class vtkImageData;
+
 /**
  * @addtogroup Birch
  * @{
@@ -51,6 +53,16 @@ namespace Birch
      */
     bool IsRatedBy( User* user );
 
+    /**
+     * Sets the default window/level of this record's decoded image.  The values
+     * saved in the record are used if there are any, otherwise they are computed
+     * from the image's histogram and saved for next time.  The default_window and
+     * default_level columns are optional, without them the values are always
+     * computed.
+     * @param image vtkImageData The decoded image
+     */
+    void SetupDefaultWindowLevel( vtkImageData *image );
+
   protected:
     Image() {}
     ~Image() {}
@@ -0,0 +1,222 @@
+/*=========================================================================
+
+  Program:  Birch (CLSA Retinal Image Viewer)
+  Module:   ImageCache.cxx
+  Language: C++
+
+  Author: Patrick Emond <emondpd@mcmaster.ca>
+  Author: Dean Inglis <inglisd@mcmaster.ca>
+
+=========================================================================*/
+
+#include "ImageCache.h"
+
+#include "ImagePrefetchJob.h"
+#include "JobScheduler.h"
+#include "Study.h"
+
+#include "vtkImageData.h"
+#include "vtkObjectFactory.h"
+
+#include <set>
+#include <vector>
+
+namespace Birch
+{
+  vtkStandardNewMacro( ImageCache );
+
+  //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+  ImageCache::ImageCache()
+  {
+    this->MemorySize = 0;
+    this->MemoryLimit = 512;
+    this->NumberOfPrefetchStudies = 2;
+    this->PyramidTileSize = 512;
+    this->Scheduler = NULL;
+    this->Observer = vtkSmartPointer< Command >::New();
+    this->Observer->cache = this;
+  }
+
+  //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+  ImageCache::~ImageCache()
+  {
+    this->SetScheduler( NULL );
+    this->Clear();
+  }
+
+  //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+  void ImageCache::SetScheduler( JobScheduler *scheduler )
+  {
+    if( scheduler == this->Scheduler ) return;
+
+    if( this->Scheduler )
+    {
+      this->Scheduler->RemoveObserver( this->Observer );
+      if( this->PrefetchJob ) this->PrefetchJob->Cancel();
+    }
+
+    this->Scheduler = scheduler;
+
+    if( this->Scheduler )
+    {
+      this->Scheduler->AddObserver( JobScheduler::JobDataEvent, this->Observer );
+      this->Scheduler->AddObserver( JobScheduler::JobFinishedEvent, this->Observer );
+    }
+  }
+
+  //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+  vtkImageData* ImageCache::GetImage( int id )
+  {
+    std::map< int, CacheEntry >::iterator it = this->ImageMap.find( id );
+    if( this->ImageMap.end() == it ) return NULL;
+
+    // move the image to the front of the usage list
+    this->UsageList.splice( this->UsageList.begin(), this->UsageList, it->second.Usage );
+    return it->second.Image;
+  }
+
+  //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+  std::vector< vtkImageData* > ImageCache::GetPyramid( int id )
+  {
+    std::map< int, CacheEntry >::iterator it = this->ImageMap.find( id );
+    return this->ImageMap.end() == it ? std::vector< vtkImageData* >() : it->second.Pyramid;
+  }
+
+  //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+  void ImageCache::AddImage( int id, vtkImageData *image, const std::vector< vtkImageData* > &pyramid )
+  {
+    if( !image ) return;
+
+    std::map< int, CacheEntry >::iterator it = this->ImageMap.find( id );
+    if( this->ImageMap.end() != it )
+    {
+      if( image == it->second.Image )
+      {
+        this->GetImage( id );
+        return;
+      }
+
+      this->MemorySize -= it->second.Size;
+      this->ReleaseEntry( it->second );
+      this->UsageList.erase( it->second.Usage );
+      this->ImageMap.erase( it );
+    }
+
+    CacheEntry entry;
+    entry.Image = image;
+    entry.Pyramid = pyramid;
+    entry.Size = image->GetActualMemorySize();
+    entry.Usage = this->UsageList.insert( this->UsageList.begin(), id );
+    image->Register( this );
+    std::vector< vtkImageData* >::const_iterator level;
+    for( level = pyramid.begin(); level != pyramid.end(); ++level )
+    {
+      ( *level )->Register( this );
+      entry.Size += ( *level )->GetActualMemorySize();
+    }
+    this->ImageMap[id] = entry;
+    this->MemorySize += entry.Size;
+
+    this->Trim();
+  }
+
+  //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+  void ImageCache::ReleaseEntry( CacheEntry &entry )
+  {
+    entry.Image->UnRegister( this );
+    std::vector< vtkImageData* >::iterator level;
+    for( level = entry.Pyramid.begin(); level != entry.Pyramid.end(); ++level )
+      ( *level )->UnRegister( this );
+  }
+
+  //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+  void ImageCache::Clear()
+  {
+    std::map< int, CacheEntry >::iterator it;
+    for( it = this->ImageMap.begin(); it != this->ImageMap.end(); ++it )
+      this->ReleaseEntry( it->second );
+    this->ImageMap.clear();
+    this->UsageList.clear();
+    this->MemorySize = 0;
+  }
+
+  //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+  void ImageCache::Trim()
+  {
+    unsigned long limit = 1024 * (unsigned long) ( 0 > this->MemoryLimit ? 0 : this->MemoryLimit );
+    while( this->MemorySize > limit && 1 < this->UsageList.size() )
+    {
+      std::map< int, CacheEntry >::iterator it = this->ImageMap.find( this->UsageList.back() );
+      this->MemorySize -= it->second.Size;
+      this->ReleaseEntry( it->second );
+      this->ImageMap.erase( it );
+      this->UsageList.pop_back();
+    }
+  }
+
+  //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+  void ImageCache::Prefetch( Study *study, int userId, int ratingsPerImage )
+  {
+    if( !this->Scheduler || !study || 0 > this->NumberOfPrefetchStudies ) return;
+
+    int studyId = study->Get( "id" ).ToInt();
+    if( this->PrefetchJob )
+    {
+      // nothing to do if the study has already been prefetched (or is being prefetched)
+      int state = this->PrefetchJob->GetState();
+      if( studyId == this->PrefetchJob->GetStudyId() && userId == this->PrefetchJob->GetUserId() &&
+          ( this->Scheduler->IsPending( this->PrefetchJob ) || Job::FINISHED == state ) ) return;
+
+      // images decoded by the cancelled job are still added to the cache
+      this->PrefetchJob->Cancel();
+    }
+
+    std::set< int > skipList;
+    std::map< int, CacheEntry >::iterator it;
+    for( it = this->ImageMap.begin(); it != this->ImageMap.end(); ++it ) skipList.insert( it->first );
+
+    this->PrefetchJob = vtkSmartPointer< ImagePrefetchJob >::New();
+    this->PrefetchJob->SetStudyId( studyId );
+    this->PrefetchJob->SetNumberOfStudies( this->NumberOfPrefetchStudies );
+    this->PrefetchJob->SetUserId( userId );
+    this->PrefetchJob->SetRatingsPerImage( ratingsPerImage );
+    this->PrefetchJob->SetSkipList( skipList );
+    this->PrefetchJob->SetPyramidTileSize( this->PyramidTileSize );
+    this->Scheduler->Submit( this->PrefetchJob );
+  }
+
+  //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+  void ImageCache::AddPrefetchedImages( Job *job )
+  {
+    ImagePrefetchJob *prefetchJob = ImagePrefetchJob::SafeDownCast( job );
+    if( !prefetchJob ) return;
+
+    std::vector< ImagePrefetchJob::DecodedImage > list;
+    std::vector< ImagePrefetchJob::DecodedImage >::iterator it;
+    prefetchJob->TakeImages( list );
+    if( list.empty() ) return;
+
+    std::set< int > studyImageIds = prefetchJob->GetStudyImageIds();
+    std::set< int >::iterator id;
+    for( it = list.begin(); it != list.end(); ++it )
+    {
+      // don't replace an image which is already cached (it may be on display)
+      if( !this->HasImage( it->Id ) ) this->AddImage( it->Id, it->Image, it->Pyramid );
+      it->Image->Delete();
+      std::vector< vtkImageData* >::iterator level;
+      for( level = it->Pyramid.begin(); level != it->Pyramid.end(); ++level ) ( *level )->Delete();
+
+      // the study's own images are decoded first but are the most likely to be shown,
+      // so they are kept ahead of its neighbours' images in the usage list
+      for( id = studyImageIds.begin(); id != studyImageIds.end(); ++id )
+        if( this->HasImage( *id ) ) this->GetImage( *id );
+    }
+  }
+
+  //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+  void ImageCache::Command::Execute(
+    vtkObject *caller, unsigned long eventId, void *callData )
+  {
+    if( this->cache ) this->cache->AddPrefetchedImages( static_cast<Job*>( callData ) );
+  }
+}
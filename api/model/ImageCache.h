@@ -0,0 +1,207 @@
+/*=========================================================================
+
+  Program:  Birch (CLSA Retinal Image Viewer)
+  Module:   ImageCache.h
+  Language: C++
+
+  Author: Patrick Emond <emondpd@mcmaster.ca>
+  Author: Dean Inglis <inglisd@mcmaster.ca>
+
+=========================================================================*/
+
+/**
+ * @class ImageCache
+ * @namespace Birch
+ *
+ * @author Patrick Emond <emondpd@mcmaster.ca>
+ * @author Dean Inglis <inglisd@mcmaster.ca>
+ *
+ * @brief Memory bounded cache of decoded images
+ *
+ * A single instance of this class is created and managed by the Application
+ * singleton.  Decoded images are indexed by Image record id and the least recently
+ * used images are removed once the cache's memory limit is exceeded.
+ *
+ * Prefetch() decodes the images of the studies surrounding a study (or of those
+ * the rater will claim next) on the job scheduler's worker threads.  The study's own images are kept more recently used
+ * than its neighbours' so that they are the last to be removed.  Decoded images
+ * are added to the cache as the scheduler's events are processed, so this class
+ * must only be used from the GUI thread.
+ *
+ * The display pyramid of a large image is built along with the decoded image and
+ * cached with it, so it is built once per image and never on the GUI thread.
+ */
+
+#ifndef __ImageCache_h
+#define __ImageCache_h
+
+#include "ModelObject.h"
+
+#include "vtkCommand.h"
+#include "vtkSmartPointer.h"
+
+#include <iostream>
+#include <list>
+#include <map>
+#include <vector>
+
+class vtkImageData;
+
+/**
+ * @addtogroup Birch
+ * @{
+ */
+
+namespace Birch
+{
+  class ImagePrefetchJob;
+  class Job;
+  class JobScheduler;
+  class Study;
+  class ImageCache : public ModelObject
+  {
+  public:
+    static ImageCache *New();
+    vtkTypeMacro( ImageCache, ModelObject );
+
+    /**
+     * Returns the decoded image of an Image record, or NULL if it isn't cached.
+     * The image becomes the most recently used image in the cache.
+     * @param id int The Image record's id
+     */
+    vtkImageData* GetImage( int id );
+
+    /**
+     * Returns whether the decoded image of an Image record is cached
+     * @param id int The Image record's id
+     */
+    bool HasImage( int id ) { return this->ImageMap.end() != this->ImageMap.find( id ); }
+
+    /**
+     * Returns the display pyramid of a cached image (see
+     * vtkMedicalImageViewer::BuildPyramid), empty if it isn't cached or has none.
+     * The image's usage isn't changed.
+     * @param id int The Image record's id
+     */
+    std::vector< vtkImageData* > GetPyramid( int id );
+
+    /**
+     * Adds (or replaces) a decoded image and its display pyramid as the most recently
+     * used image in the cache
+     * @param id int The Image record's id
+     * @param image vtkImageData
+     * @param pyramid vector The image's pyramid levels, starting at level 1
+     */
+    void AddImage( int id, vtkImageData *image,
+                   const std::vector< vtkImageData* > &pyramid = std::vector< vtkImageData* >() );
+
+    /**
+     * Removes all images from the cache
+     */
+    void Clear();
+
+    /**
+     * Decodes the images of a study and the studies which follow it in the background.
+     * Any prefetch already in progress for a different study is cancelled.
+     * @param study Study
+     * @param userId int If not 0, the studies this user would claim next are prefetched
+     *        instead of the study's neighbours in review queue order
+     * @param ratingsPerImage int The number of ratings each image should get
+     */
+    void Prefetch( Study *study, int userId = 0, int ratingsPerImage = 1 );
+
+    /**
+     * Sets the scheduler used to prefetch images
+     */
+    void SetScheduler( JobScheduler *scheduler );
+
+    //@{
+    /**
+     * The maximum amount of memory used by cached images (in megabytes)
+     */
+    vtkSetMacro( MemoryLimit, int );
+    vtkGetMacro( MemoryLimit, int );
+    //@}
+
+    //@{
+    /**
+     * The tile size of the display pyramids built for prefetched images (see
+     * vtkMedicalImageViewer::SetTileSize), 0 to build none
+     */
+    vtkSetMacro( PyramidTileSize, int );
+    vtkGetMacro( PyramidTileSize, int );
+    //@}
+
+    //@{
+    /**
+     * The number of studies to prefetch in each direction (0 prefetches only the
+     * images of the study itself, negative values turn prefetching off)
+     */
+    vtkSetMacro( NumberOfPrefetchStudies, int );
+    vtkGetMacro( NumberOfPrefetchStudies, int );
+    //@}
+
+    /**
+     * Returns the amount of memory used by cached images (in kilobytes)
+     */
+    unsigned long GetMemorySize() { return this->MemorySize; }
+
+  protected:
+    ImageCache();
+    ~ImageCache();
+
+    class Command : public vtkCommand
+    {
+    public:
+      static Command *New() { return new Command; }
+      void Execute( vtkObject *caller, unsigned long eventId, void *callData );
+      ImageCache *cache;
+
+    protected:
+      Command() { this->cache = NULL; }
+    };
+
+    /**
+     * Adds the images decoded by a prefetch job to the cache
+     */
+    void AddPrefetchedImages( Job *job );
+
+    /**
+     * Removes least recently used images until the memory limit is respected
+     * (the most recently used image is never removed)
+     */
+    void Trim();
+
+    struct CacheEntry
+    {
+      vtkImageData *Image;
+      std::vector< vtkImageData* > Pyramid;
+      unsigned long Size;
+      std::list< int >::iterator Usage;
+    };
+
+    /**
+     * Releases an entry's image and pyramid
+     */
+    void ReleaseEntry( CacheEntry &entry );
+
+    std::map< int, CacheEntry > ImageMap;
+    std::list< int > UsageList; // most recently used first
+    unsigned long MemorySize;
+    int MemoryLimit;
+    int NumberOfPrefetchStudies;
+    int PyramidTileSize;
+
+    JobScheduler *Scheduler;
+    vtkSmartPointer< Command > Observer;
+    vtkSmartPointer< ImagePrefetchJob > PrefetchJob;
+
+  private:
+    ImageCache( const ImageCache& ); // Not implemented
+    void operator=( const ImageCache& ); // Not implemented
+  };
+}
+
+/** @} end of doxygen group */
+
+#endif
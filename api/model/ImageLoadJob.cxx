@@ -0,0 +1,130 @@
+/*=========================================================================
+
+  Program:  Birch (CLSA Retinal Image Viewer)
+  Module:   ImageLoadJob.cxx
+  Language: C++
+
+  Author: Patrick Emond <emondpd@mcmaster.ca>
+  Author: Dean Inglis <inglisd@mcmaster.ca>
+
+=========================================================================*/
+
+#include "ImageLoadJob.h"
+
+#include "Image.h"
+#include "JobScheduler.h"
+
+#include "vtkBirchDefaultWindowLevel.h"
+#include "vtkImageData.h"
+#include "vtkMedicalImageViewer.h"
+#include "vtkMutexLock.h"
+#include "vtkObjectFactory.h"
+#include "vtkSmartPointer.h"
+#include "vtkVariant.h"
+
+#include <sstream>
+#include <stdexcept>
+
+namespace Birch
+{
+  vtkStandardNewMacro( ImageLoadJob );
+
+  //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+  ImageLoadJob::ImageLoadJob()
+  {
+    this->Priority = Job::INTERACTIVE;
+    this->ImageId = 0;
+    this->PreviewShrinkFactor = 0;
+    this->PyramidTileSize = 0;
+    this->Image = NULL;
+    this->Preview = NULL;
+  }
+
+  //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+  ImageLoadJob::~ImageLoadJob()
+  {
+    if( this->Image ) this->Image->Delete();
+    if( this->Preview ) this->Preview->Delete();
+    std::vector< vtkImageData* >::iterator level;
+    for( level = this->Pyramid.begin(); level != this->Pyramid.end(); ++level ) ( *level )->Delete();
+  }
+
+  //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+  vtkImageData* ImageLoadJob::TakeImage()
+  {
+    this->Lock->Lock();
+    vtkImageData *image = this->Image;
+    this->Image = NULL;
+    this->Lock->Unlock();
+    return image;
+  }
+
+  //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+  vtkImageData* ImageLoadJob::TakePreview()
+  {
+    this->Lock->Lock();
+    vtkImageData *preview = this->Preview;
+    this->Preview = NULL;
+    this->Lock->Unlock();
+    return preview;
+  }
+
+  //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+  void ImageLoadJob::TakePyramid( std::vector< vtkImageData* > &pyramid )
+  {
+    this->Lock->Lock();
+    pyramid.insert( pyramid.end(), this->Pyramid.begin(), this->Pyramid.end() );
+    this->Pyramid.clear();
+    this->Lock->Unlock();
+  }
+
+  //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+  void ImageLoadJob::Execute()
+  {
+    // previews are only available for some formats, so failing to decode one is not an error
+    if( 1 < this->PreviewShrinkFactor )
+    {
+      vtkImageData *preview = vtkImageData::New();
+      if( vtkMedicalImageViewer::ReadPreviewImage( this->FileName, preview, this->PreviewShrinkFactor ) )
+      {
+        this->Lock->Lock();
+        if( this->Preview ) this->Preview->Delete();
+        this->Preview = preview;
+        this->Lock->Unlock();
+        this->PostEvent( JobScheduler::JobDataEvent );
+      }
+      else preview->Delete();
+
+      if( this->IsCancelled() ) return;
+    }
+
+    // the decoder can't be interrupted, so a load cancelled while decoding finishes
+    // and its image is discarded by whoever cancelled it
+    vtkImageData *image = vtkImageData::New();
+    if( !vtkMedicalImageViewer::ReadImage( this->FileName, image ) )
+    {
+      image->Delete();
+      std::stringstream stream;
+      stream << "Unable to load image file \"" << this->FileName << "\"";
+      throw std::runtime_error( stream.str() );
+    }
+
+    // the default window/level is computed here rather than when the image is displayed
+    vtkSmartPointer< Birch::Image > record = vtkSmartPointer< Birch::Image >::New();
+    if( 0 < this->ImageId && record->Load( "id", vtkVariant( this->ImageId ).ToString() ) )
+      record->SetupDefaultWindowLevel( image );
+    else vtkBirchDefaultWindowLevel::Compute( image );
+
+    std::vector< vtkImageData* > pyramid;
+    vtkMedicalImageViewer::BuildPyramid( image, this->PyramidTileSize, pyramid );
+
+    this->Lock->Lock();
+    if( this->Image ) this->Image->Delete();
+    this->Image = image;
+    std::vector< vtkImageData* >::iterator level;
+    for( level = this->Pyramid.begin(); level != this->Pyramid.end(); ++level ) ( *level )->Delete();
+    this->Pyramid = pyramid;
+    this->Lock->Unlock();
+    this->UpdateProgress( 1.0 );
+  }
+}
@@ -0,0 +1,139 @@
+/*=========================================================================
+
+  Program:  Birch (CLSA Retinal Image Viewer)
+  Module:   ImageLoadJob.h
+  Language: C++
+
+  Author: Patrick Emond <emondpd@mcmaster.ca>
+  Author: Dean Inglis <inglisd@mcmaster.ca>
+
+=========================================================================*/
+
+/**
+ * @class ImageLoadJob
+ * @namespace Birch
+ *
+ * @author Patrick Emond <emondpd@mcmaster.ca>
+ * @author Dean Inglis <inglisd@mcmaster.ca>
+ *
+ * @brief Job which decodes a single image file
+ *
+ * Used to decode the image which is about to be displayed without blocking the GUI
+ * thread.  Once the scheduler has posted the job's JobScheduler::JobFinishedEvent the
+ * decoded image may be collected (on the GUI thread) using TakeImage().
+ *
+ * If a preview shrink factor is set a reduced resolution version of the image is
+ * decoded first (see vtkMedicalImageViewer::ReadPreviewImage) and a
+ * JobScheduler::JobDataEvent is posted once it may be collected using TakePreview().
+ * A job which is cancelled after its preview has been decoded doesn't decode the
+ * full image.  The display pyramid of a large image is built along with it (see
+ * TakePyramid()) so that it isn't built on the GUI thread.
+ */
+
+#ifndef __ImageLoadJob_h
+#define __ImageLoadJob_h
+
+#include "Job.h"
+
+#include <iostream>
+#include <vector>
+
+class vtkImageData;
+
+/**
+ * @addtogroup Birch
+ * @{
+ */
+
+namespace Birch
+{
+  class ImageLoadJob : public Job
+  {
+  public:
+    static ImageLoadJob *New();
+    vtkTypeMacro( ImageLoadJob, Job );
+
+    std::string GetDescription() { return "Image load"; }
+
+    //@{
+    /**
+     * The id of the Image record being loaded
+     */
+    vtkSetMacro( ImageId, int );
+    vtkGetMacro( ImageId, int );
+    //@}
+
+    //@{
+    /**
+     * The shrink factor of the preview to decode before the full image (2, 4 or 8,
+     * any other value turns previews off)
+     */
+    vtkSetMacro( PreviewShrinkFactor, int );
+    vtkGetMacro( PreviewShrinkFactor, int );
+    //@}
+
+    //@{
+    /**
+     * The tile size used to build the decoded image's display pyramid (see
+     * vtkMedicalImageViewer::BuildPyramid), 0 to build none
+     */
+    vtkSetMacro( PyramidTileSize, int );
+    vtkGetMacro( PyramidTileSize, int );
+    //@}
+
+    //@{
+    /**
+     * The name of the image file to decode
+     */
+    void SetFileName( const std::string &fileName ) { this->FileName = fileName; }
+    std::string GetFileName() { return this->FileName; }
+    //@}
+
+    /**
+     * Returns the decoded image, or NULL if it hasn't been decoded (or has already
+     * been taken).  The caller takes over the reference to the image.  This
+     * must only be called from the GUI thread.
+     */
+    vtkImageData* TakeImage();
+
+    /**
+     * Returns the decoded preview, or NULL if it hasn't been decoded (or has already
+     * been taken).  The caller takes over the reference to the preview.  This must
+     * only be called from the GUI thread.
+     */
+    vtkImageData* TakePreview();
+
+    /**
+     * Moves the decoded image's display pyramid (levels 1 and up) into the given list.
+     * The caller takes over the references to the levels.  This must only be called
+     * from the GUI thread.
+     */
+    void TakePyramid( std::vector< vtkImageData* > &pyramid );
+
+  protected:
+    ImageLoadJob();
+    ~ImageLoadJob();
+
+    /**
+     * Decodes the image file
+     * @throws runtime_error
+     */
+    void Execute();
+
+    int ImageId;
+    int PreviewShrinkFactor;
+    int PyramidTileSize;
+    std::string FileName;
+    vtkImageData *Image;
+    vtkImageData *Preview;
+    std::vector< vtkImageData* > Pyramid;
+
+  private:
+    ImageLoadJob( const ImageLoadJob& ); // Not implemented
+    void operator=( const ImageLoadJob& ); // Not implemented
+  };
+}
+
+/** @} end of doxygen group */
+
+#endif
@@ -0,0 +1,145 @@
+/*=========================================================================
+
+  Program:  Birch (CLSA Retinal Image Viewer)
+  Module:   ImagePrefetchJob.cxx
+  Language: C++
+
+  Author: Patrick Emond <emondpd@mcmaster.ca>
+  Author: Dean Inglis <inglisd@mcmaster.ca>
+
+=========================================================================*/
+
+#include "ImagePrefetchJob.h"
+
+#include "Image.h"
+#include "JobScheduler.h"
+#include "Study.h"
+#include "StudyLease.h"
+
+#include "vtkImageData.h"
+#include "vtkMedicalImageViewer.h"
+#include "vtkMutexLock.h"
+#include "vtkObjectFactory.h"
+#include "vtkSmartPointer.h"
+
+#include <algorithm>
+
+namespace Birch
+{
+  vtkStandardNewMacro( ImagePrefetchJob );
+
+  //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+  ImagePrefetchJob::ImagePrefetchJob()
+  {
+    this->Priority = Job::BACKGROUND;
+    this->StudyId = 0;
+    this->NumberOfStudies = 2;
+    this->UserId = 0;
+    this->RatingsPerImage = 1;
+    this->PyramidTileSize = 0;
+  }
+
+  //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+  ImagePrefetchJob::~ImagePrefetchJob()
+  {
+    std::vector< DecodedImage >::iterator it;
+    std::vector< vtkImageData* >::iterator level;
+    for( it = this->ImageList.begin(); it != this->ImageList.end(); ++it )
+    {
+      it->Image->Delete();
+      for( level = it->Pyramid.begin(); level != it->Pyramid.end(); ++level ) ( *level )->Delete();
+    }
+  }
+
+  //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+  void ImagePrefetchJob::TakeImages( std::vector< DecodedImage > &list )
+  {
+    this->Lock->Lock();
+    list.insert( list.end(), this->ImageList.begin(), this->ImageList.end() );
+    this->ImageList.clear();
+    this->Lock->Unlock();
+  }
+
+  //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+  std::set< int > ImagePrefetchJob::GetStudyImageIds()
+  {
+    this->Lock->Lock();
+    std::set< int > list = this->StudyImageIds;
+    this->Lock->Unlock();
+    return list;
+  }
+
+  //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+  void ImagePrefetchJob::Execute()
+  {
+    vtkSmartPointer< Study > study = vtkSmartPointer< Study >::New();
+    if( !study->Load( "id", vtkVariant( this->StudyId ).ToString() ) ) return;
+
+    // visit the study first, then the studies which will be claimed after it or else
+    // alternate between the next and previous studies (a single index seek each)
+    std::vector< int > visitList;
+    visitList.push_back( this->StudyId );
+    if( 0 < this->UserId )
+    {
+      std::vector< int > claimList =
+        StudyLease::Peek( this->UserId, study, this->RatingsPerImage, this->NumberOfStudies );
+      visitList.insert( visitList.end(), claimList.begin(), claimList.end() );
+    }
+    else
+    {
+      vtkSmartPointer< Study > next = study, previous = study;
+      for( int i = 1; i <= this->NumberOfStudies && !this->IsCancelled(); ++i )
+      {
+        next = next->GetNext();
+        int id = next->Get( "id" ).ToInt();
+        if( visitList.end() == std::find( visitList.begin(), visitList.end(), id ) )
+          visitList.push_back( id );
+        previous = previous->GetPrevious();
+        id = previous->Get( "id" ).ToInt();
+        if( visitList.end() == std::find( visitList.begin(), visitList.end(), id ) )
+          visitList.push_back( id );
+      }
+    }
+
+    std::vector< int >::iterator studyId;
+    for( studyId = visitList.begin(); studyId != visitList.end() && !this->IsCancelled(); ++studyId )
+    {
+      if( !study->Load( "id", vtkVariant( *studyId ).ToString() ) ) continue;
+
+      std::vector< vtkSmartPointer< Image > > imageList;
+      std::vector< vtkSmartPointer< Image > >::iterator image;
+      study->GetList( &imageList );
+      if( visitList.begin() == studyId )
+      {
+        this->Lock->Lock();
+        for( image = imageList.begin(); image != imageList.end(); ++image )
+          this->StudyImageIds.insert( ( *image )->Get( "id" ).ToInt() );
+        this->Lock->Unlock();
+      }
+
+      for( image = imageList.begin(); image != imageList.end() && !this->IsCancelled(); ++image )
+      {
+        int id = ( *image )->Get( "id" ).ToInt();
+        if( this->SkipList.end() != this->SkipList.find( id ) ) continue;
+
+        // images which can't be read are skipped, they will fail again when displayed
+        vtkImageData *data = vtkImageData::New();
+        if( vtkMedicalImageViewer::ReadImage( ( *image )->GetFileName(), data ) )
+        {
+          ( *image )->SetupDefaultWindowLevel( data );
+          DecodedImage decoded;
+          decoded.Id = id;
+          decoded.Image = data;
+          vtkMedicalImageViewer::BuildPyramid( data, this->PyramidTileSize, decoded.Pyramid );
+          this->Lock->Lock();
+          this->ImageList.push_back( decoded );
+          this->Lock->Unlock();
+          this->PostEvent( JobScheduler::JobDataEvent );
+        }
+        else data->Delete();
+      }
+
+      this->UpdateProgress( (double)( studyId - visitList.begin() + 1 ) / visitList.size() );
+    }
+  }
+}
@@ -0,0 +1,141 @@
+/*=========================================================================
+
+  Program:  Birch (CLSA Retinal Image Viewer)
+  Module:   ImagePrefetchJob.h
+  Language: C++
+
+  Author: Patrick Emond <emondpd@mcmaster.ca>
+  Author: Dean Inglis <inglisd@mcmaster.ca>
+
+=========================================================================*/
+
+/**
+ * @class ImagePrefetchJob
+ * @namespace Birch
+ *
+ * @author Patrick Emond <emondpd@mcmaster.ca>
+ * @author Dean Inglis <inglisd@mcmaster.ca>
+ *
+ * @brief Job which decodes the images of the studies surrounding a study
+ *
+ * Studies are visited in navigation order starting with the study itself.  When a
+ * user is given the studies that user would claim next are visited (see
+ * StudyLease::Peek()), otherwise the job alternates between the next and previous
+ * studies in review queue order.  A JobScheduler::JobDataEvent
+ * is posted every time an image has been decoded, at which point the decoded
+ * images may be collected (on the GUI thread) using TakeImages().
+ */
+
+#ifndef __ImagePrefetchJob_h
+#define __ImagePrefetchJob_h
+
+#include "Job.h"
+
+#include <iostream>
+#include <set>
+#include <vector>
+
+class vtkImageData;
+
+/**
+ * @addtogroup Birch
+ * @{
+ */
+
+namespace Birch
+{
+  class ImagePrefetchJob : public Job
+  {
+  public:
+    static ImagePrefetchJob *New();
+    vtkTypeMacro( ImagePrefetchJob, Job );
+
+    std::string GetDescription() { return "Image prefetch"; }
+
+    //@{
+    /**
+     * The id of the study to prefetch around
+     */
+    vtkSetMacro( StudyId, int );
+    vtkGetMacro( StudyId, int );
+    //@}
+
+    //@{
+    /**
+     * The number of studies to prefetch in each direction (or in claim order)
+     */
+    vtkSetMacro( NumberOfStudies, int );
+    vtkGetMacro( NumberOfStudies, int );
+    //@}
+
+    //@{
+    /**
+     * The id of the user whose claim order is followed (0 to follow queue order) and
+     * the number of ratings each image should get
+     */
+    vtkSetMacro( UserId, int );
+    vtkGetMacro( UserId, int );
+    vtkSetMacro( RatingsPerImage, int );
+    vtkGetMacro( RatingsPerImage, int );
+    //@}
+
+    /**
+     * Sets the ids of images which don't need to be decoded (already cached)
+     */
+    void SetSkipList( const std::set< int > &list ) { this->SkipList = list; }
+
+    //@{
+    /**
+     * The tile size used to build the display pyramid of each decoded image (see
+     * vtkMedicalImageViewer::BuildPyramid), 0 to build none
+     */
+    vtkSetMacro( PyramidTileSize, int );
+    vtkGetMacro( PyramidTileSize, int );
+    //@}
+
+    /** A decoded image and its display pyramid (starting at level 1) */
+    struct DecodedImage
+    {
+      int Id;
+      vtkImageData *Image;
+      std::vector< vtkImageData* > Pyramid;
+    };
+
+    /**
+     * Moves all decoded images into the given list.  The caller takes over the
+     * references to each image and its pyramid levels.  This must only be called
+     * from the GUI thread.
+     */
+    void TakeImages( std::vector< DecodedImage > &list );
+
+    /**
+     * Returns the ids of all images of the study being prefetched around (including
+     * skipped images), known once the study's images have been listed.  This method
+     * is thread safe.
+     */
+    std::set< int > GetStudyImageIds();
+
+  protected:
+    ImagePrefetchJob();
+    ~ImagePrefetchJob();
+
+    void Execute();
+
+    int StudyId;
+    int NumberOfStudies;
+    int UserId;
+    int RatingsPerImage;
+    int PyramidTileSize;
+    std::set< int > SkipList;
+    std::set< int > StudyImageIds;
+    std::vector< DecodedImage > ImageList;
+
+  private:
+    ImagePrefetchJob( const ImagePrefetchJob& ); // Not implemented
+    void operator=( const ImagePrefetchJob& ); // Not implemented
+  };
+}
+
+/** @} end of doxygen group */
+
+#endif
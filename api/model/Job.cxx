@@ -0,0 +1,157 @@
+/*=========================================================================
+
+  Program:  Birch (CLSA Retinal Image Viewer)
+  Module:   Job.cxx
+  Language: C++
+
+  Author: Patrick Emond <emondpd@mcmaster.ca>
+  Author: Dean Inglis <inglisd@mcmaster.ca>
+
+=========================================================================*/
+
+#include "Job.h"
+
+#include "JobScheduler.h"
+
+#include "vtkMutexLock.h"
+
+#include <stdexcept>
+
+namespace Birch
+{
+  //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+  Job::Job()
+  {
+    this->Scheduler = NULL;
+    this->Lock = vtkSimpleMutexLock::New();
+    this->State = Job::QUEUED;
+    this->Priority = Job::NORMAL;
+    this->Cancelled = false;
+    this->Progress = 0.0;
+  }
+
+  //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+  Job::~Job()
+  {
+    if( NULL != this->Lock )
+    {
+      this->Lock->Delete();
+      this->Lock = NULL;
+    }
+  }
+
+  //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+  void Job::Run( JobScheduler *scheduler )
+  {
+    this->Scheduler = scheduler;
+
+    // a job cancelled while still in the queue is never executed
+    if( this->IsCancelled() )
+    {
+      this->SetState( Job::CANCELLED );
+      this->PostEvent( JobScheduler::JobFinishedEvent );
+      return;
+    }
+
+    this->SetState( Job::RUNNING );
+    this->PostEvent( JobScheduler::JobStartedEvent );
+
+    try
+    {
+      this->Execute();
+      this->SetState( this->IsCancelled() ? Job::CANCELLED : Job::FINISHED );
+    }
+    catch( std::exception &e )
+    {
+      this->Lock->Lock();
+      this->ErrorMessage = e.what();
+      this->Lock->Unlock();
+      this->SetState( Job::FAILED );
+    }
+
+    this->PostEvent( JobScheduler::JobFinishedEvent );
+  }
+
+  //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+  void Job::Reset()
+  {
+    this->Lock->Lock();
+    this->State = Job::QUEUED;
+    this->Priority = Job::NORMAL;
+    this->Cancelled = false;
+    this->Progress = 0.0;
+    this->ErrorMessage = "";
+    this->Lock->Unlock();
+  }
+
+  //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+  void Job::Cancel()
+  {
+    this->Lock->Lock();
+    this->Cancelled = true;
+    this->Lock->Unlock();
+  }
+
+  //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+  bool Job::IsCancelled()
+  {
+    this->Lock->Lock();
+    bool cancelled = this->Cancelled;
+    this->Lock->Unlock();
+    return cancelled;
+  }
+
+  //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+  int Job::GetState()
+  {
+    this->Lock->Lock();
+    int state = this->State;
+    this->Lock->Unlock();
+    return state;
+  }
+
+  //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+  void Job::SetState( int state )
+  {
+    this->Lock->Lock();
+    this->State = state;
+    this->Lock->Unlock();
+  }
+
+  //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+  double Job::GetProgress()
+  {
+    this->Lock->Lock();
+    double progress = this->Progress;
+    this->Lock->Unlock();
+    return progress;
+  }
+
+  //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+  std::string Job::GetErrorMessage()
+  {
+    this->Lock->Lock();
+    std::string message = this->ErrorMessage;
+    this->Lock->Unlock();
+    return message;
+  }
+
+  //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+  void Job::UpdateProgress( double progress )
+  {
+    if( progress < 0.0 ) progress = 0.0;
+    else if( progress > 1.0 ) progress = 1.0;
+
+    this->Lock->Lock();
+    this->Progress = progress;
+    this->Lock->Unlock();
+
+    this->PostEvent( JobScheduler::JobProgressEvent );
+  }
+
+  //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+  void Job::PostEvent( unsigned long event )
+  {
+    if( this->Scheduler ) this->Scheduler->PostEvent( this, event );
+  }
+}
@@ -0,0 +1,156 @@
+/*=========================================================================
+
+  Program:  Birch (CLSA Retinal Image Viewer)
+  Module:   Job.h
+  Language: C++
+
+  Author: Patrick Emond <emondpd@mcmaster.ca>
+  Author: Dean Inglis <inglisd@mcmaster.ca>
+
+=========================================================================*/
+
+/**
+ * @class Job
+ * @namespace Birch
+ *
+ * @author Patrick Emond <emondpd@mcmaster.ca>
+ * @author Dean Inglis <inglisd@mcmaster.ca>
+ *
+ * @brief Abstract base class for all work run by the JobScheduler
+ *
+ * A job is a unit of work which is run on one of the scheduler's worker threads.
+ * Child classes implement Execute() and should periodically check IsCancelled()
+ * and report their progress using UpdateProgress().  Since Execute() does not run
+ * on the GUI thread it must never touch the user interface; instead it should post
+ * events through the scheduler which will deliver them on the GUI thread.
+ */
+
+#ifndef __Job_h
+#define __Job_h
+
+#include "ModelObject.h"
+
+#include <iostream>
+
+class vtkSimpleMutexLock;
+
+/**
+ * @addtogroup Birch
+ * @{
+ */
+
+namespace Birch
+{
+  class JobScheduler;
+  class Job : public ModelObject
+  {
+  public:
+    vtkTypeMacro( Job, ModelObject );
+
+    /** The state a job may be in. */
+    enum
+    {
+      QUEUED,
+      RUNNING,
+      FINISHED,
+      CANCELLED,
+      FAILED
+    };
+
+    /** The priority a job may have (jobs of higher priority are run first). */
+    enum
+    {
+      BACKGROUND,
+      NORMAL,
+      INTERACTIVE
+    };
+
+    /**
+     * Runs the job.  This is called by the scheduler from a worker thread and
+     * should not be called directly.  Any exception thrown by Execute() is caught
+     * and the job is marked as having failed.
+     */
+    void Run( JobScheduler *scheduler );
+
+    /**
+     * Requests that the job stop as soon as possible.  A job which has not yet
+     * started will not be run at all.
+     */
+    virtual void Cancel();
+
+    /**
+     * Returns whether the job has been asked to stop.
+     */
+    bool IsCancelled();
+
+    /**
+     * Returns the state of the job (see the enum above)
+     */
+    int GetState();
+
+    /**
+     * Returns the job's priority (see the enum above).  Jobs which the user is
+     * waiting on are INTERACTIVE, jobs which only prepare for later are BACKGROUND.
+     */
+    vtkGetMacro( Priority, int );
+
+    /**
+     * Returns the job's progress, from 0.0 to 1.0
+     */
+    double GetProgress();
+
+    /**
+     * Returns the error message of a failed job (empty if the job didn't fail)
+     */
+    std::string GetErrorMessage();
+
+    /**
+     * A human readable name describing the job (used by the interface)
+     */
+    virtual std::string GetDescription() = 0;
+
+    /**
+     * Resets the job so that it can be run again (used by repeating jobs)
+     */
+    void Reset();
+
+  protected:
+    Job();
+    ~Job();
+
+    /**
+     * Must be extended by every child class, this is where the work is done.
+     * @throws runtime_error
+     */
+    virtual void Execute() = 0;
+
+    /**
+     * Sets the job's progress and posts a progress event to the GUI thread
+     */
+    void UpdateProgress( double progress );
+
+    /**
+     * Posts an event to be invoked by the scheduler on the GUI thread with
+     * this job as the call data.
+     */
+    void PostEvent( unsigned long event );
+
+    void SetState( int state );
+
+    JobScheduler *Scheduler;
+    vtkSimpleMutexLock *Lock;
+    int State;
+    int Priority;
+    bool Cancelled;
+    double Progress;
+    std::string ErrorMessage;
+
+  private:
+    Job( const Job& ); // Not implemented
+    void operator=( const Job& ); // Not implemented
+  };
+}
+
+/** @} end of doxygen group */
+
+#endif
@@ -0,0 +1,343 @@
+/*=========================================================================
+
+  Program:  Birch (CLSA Retinal Image Viewer)
+  Module:   JobScheduler.cxx
+  Language: C++
+
+  Author: Patrick Emond <emondpd@mcmaster.ca>
+  Author: Dean Inglis <inglisd@mcmaster.ca>
+
+=========================================================================*/
+
+#include "JobScheduler.h"
+
+#include "Application.h"
+#include "Job.h"
+
+#include "vtkBirchMySQLDatabase.h"
+#include "vtkConditionVariable.h"
+#include "vtkMutexLock.h"
+#include "vtkObjectFactory.h"
+#include "vtkSmartPointer.h"
+#include "vtkTimerLog.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace Birch
+{
+  vtkStandardNewMacro( JobScheduler );
+
+  //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+  JobScheduler::JobScheduler()
+  {
+    this->Threader = vtkMultiThreader::New();
+    this->QueueLock = vtkSimpleMutexLock::New();
+    this->QueueCondition = vtkConditionVariable::New();
+    this->EventLock = vtkSimpleMutexLock::New();
+    this->Stopping = false;
+    this->NumberOfWorkers = 0;
+    this->NumberOfStartingWorkers = 0;
+  }
+
+  //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+  JobScheduler::~JobScheduler()
+  {
+    this->Stop();
+
+    std::vector< RepeatingJob >::iterator it;
+    for( it = this->RepeatingJobs.begin(); it != this->RepeatingJobs.end(); ++it )
+      it->RepeatJob->UnRegister( this );
+    this->RepeatingJobs.clear();
+
+    this->Threader->Delete();
+    this->QueueLock->Delete();
+    this->QueueCondition->Delete();
+    this->EventLock->Delete();
+  }
+
+  //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+  void JobScheduler::Start( int numberOfThreads )
+  {
+    if( this->IsRunning() ) return;
+    if( 1 > numberOfThreads ) numberOfThreads = 1;
+
+    // collect the threads of workers which failed to connect the last time
+    if( !this->ThreadIds.empty() ) this->Stop();
+
+    this->QueueLock->Lock();
+    this->Stopping = false;
+    this->QueueLock->Unlock();
+
+    for( int i = 0; i < numberOfThreads; ++i )
+    {
+      this->QueueLock->Lock();
+      this->NumberOfStartingWorkers++;
+      this->QueueLock->Unlock();
+
+      int id = this->Threader->SpawnThread( JobScheduler::WorkerThread, this );
+      if( 0 > id )
+      {
+        this->QueueLock->Lock();
+        this->NumberOfStartingWorkers--;
+        this->QueueLock->Unlock();
+        this->Stop();
+        throw std::runtime_error( "Unable to start job scheduler thread" );
+      }
+      this->ThreadIds.push_back( id );
+    }
+
+    // wait until every worker has either connected or given up, otherwise jobs may be
+    // queued for workers which will never run them
+    this->QueueLock->Lock();
+    while( 0 < this->NumberOfStartingWorkers ) this->QueueCondition->Wait( *this->QueueLock );
+    this->QueueLock->Unlock();
+
+    if( !this->IsRunning() )
+      cerr << "ERROR: no job scheduler thread could connect, jobs will run on the GUI thread" << endl;
+  }
+
+  //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+  bool JobScheduler::IsRunning()
+  {
+    this->QueueLock->Lock();
+    bool running = 0 < this->NumberOfWorkers;
+    this->QueueLock->Unlock();
+    return running;
+  }
+
+  //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+  void JobScheduler::Stop()
+  {
+    this->CancelAll();
+
+    this->QueueLock->Lock();
+    this->Stopping = true;
+    this->QueueCondition->Broadcast();
+    this->QueueLock->Unlock();
+
+    // wait for all threads to finish their current job and exit
+    std::vector< int >::iterator it;
+    for( it = this->ThreadIds.begin(); it != this->ThreadIds.end(); ++it )
+      this->Threader->TerminateThread( *it );
+    this->ThreadIds.clear();
+
+    // nothing is left to run or report, so release all pending jobs
+    this->QueueLock->Lock();
+    this->Queue.clear();
+    this->QueueLock->Unlock();
+
+    this->EventLock->Lock();
+    this->Events.clear();
+    this->EventLock->Unlock();
+
+    std::set< Job* >::iterator jobIt;
+    for( jobIt = this->PendingJobs.begin(); jobIt != this->PendingJobs.end(); ++jobIt )
+      ( *jobIt )->UnRegister( this );
+    this->PendingJobs.clear();
+  }
+
+  //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+  void JobScheduler::Submit( Job *job )
+  {
+    if( !job ) throw std::runtime_error( "Tried to submit null job" );
+    if( this->IsPending( job ) ) return;
+
+    // the scheduler holds a reference to the job until its finished event is processed
+    job->Reset();
+    job->Register( this );
+    this->PendingJobs.insert( job );
+
+    // keep the queue sorted by priority
+    this->QueueLock->Lock();
+    std::deque< Job* >::iterator it = this->Queue.begin();
+    while( it != this->Queue.end() && ( *it )->GetPriority() >= job->GetPriority() ) ++it;
+    this->Queue.insert( it, job );
+    this->QueueCondition->Broadcast();
+    this->QueueLock->Unlock();
+  }
+
+  //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+  void JobScheduler::SubmitRepeating( Job *job, double interval )
+  {
+    if( !job ) throw std::runtime_error( "Tried to submit null repeating job" );
+    if( 0.0 >= interval ) throw std::runtime_error( "Repeating job interval must be positive" );
+
+    this->RemoveRepeating( job );
+
+    RepeatingJob repeat;
+    repeat.RepeatJob = job;
+    repeat.Interval = interval;
+    repeat.NextRun = vtkTimerLog::GetUniversalTime() + interval;
+    job->Register( this );
+    this->RepeatingJobs.push_back( repeat );
+  }
+
+  //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+  void JobScheduler::RemoveRepeating( Job *job )
+  {
+    std::vector< RepeatingJob >::iterator it;
+    for( it = this->RepeatingJobs.begin(); it != this->RepeatingJobs.end(); ++it )
+    {
+      if( it->RepeatJob == job )
+      {
+        this->RepeatingJobs.erase( it );
+        job->UnRegister( this );
+        break;
+      }
+    }
+  }
+
+  //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+  bool JobScheduler::IsPending( Job *job )
+  {
+    return this->PendingJobs.end() != this->PendingJobs.find( job );
+  }
+
+  //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+  void JobScheduler::CancelAll()
+  {
+    this->QueueLock->Lock();
+    std::deque< Job* >::iterator it;
+    for( it = this->Queue.begin(); it != this->Queue.end(); ++it ) ( *it )->Cancel();
+    std::vector< Job* >::iterator runIt;
+    for( runIt = this->RunningJobs.begin(); runIt != this->RunningJobs.end(); ++runIt )
+      ( *runIt )->Cancel();
+    this->QueueLock->Unlock();
+  }
+
+  //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+  void JobScheduler::PostEvent( Job *job, unsigned long event )
+  {
+    this->EventLock->Lock();
+    this->Events.push_back( std::pair< Job*, unsigned long >( job, event ) );
+    this->EventLock->Unlock();
+  }
+
+  //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+  void JobScheduler::ProcessEvents()
+  {
+    // submit any repeating jobs which are due
+    double now = vtkTimerLog::GetUniversalTime();
+    std::vector< RepeatingJob >::iterator it;
+    for( it = this->RepeatingJobs.begin(); it != this->RepeatingJobs.end(); ++it )
+    {
+      if( now >= it->NextRun )
+      {
+        it->NextRun = now + it->Interval;
+        if( !this->IsPending( it->RepeatJob ) ) this->Submit( it->RepeatJob );
+      }
+    }
+
+    // invoke events one at a time so that an observer throwing an exception
+    // doesn't cause the remaining events to be lost
+    while( true )
+    {
+      this->EventLock->Lock();
+      if( this->Events.empty() )
+      {
+        this->EventLock->Unlock();
+        break;
+      }
+      std::pair< Job*, unsigned long > pair = this->Events.front();
+      this->Events.pop_front();
+      this->EventLock->Unlock();
+
+      vtkSmartPointer< Job > job = pair.first;
+      if( JobScheduler::JobFinishedEvent == pair.second && this->IsPending( job ) )
+      {
+        this->PendingJobs.erase( job.GetPointer() );
+        job->UnRegister( this );
+      }
+
+      this->InvokeEvent( pair.second, static_cast<void *>( job.GetPointer() ) );
+    }
+  }
+
+  //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+  Job* JobScheduler::WaitForJob()
+  {
+    Job *job = NULL;
+
+    this->QueueLock->Lock();
+    std::deque< Job* >::iterator it;
+    while( !this->Stopping && this->Queue.end() == ( it = this->FindNextJob() ) )
+      this->QueueCondition->Wait( *this->QueueLock );
+    if( !this->Stopping )
+    {
+      job = *it;
+      this->Queue.erase( it );
+      this->RunningJobs.push_back( job );
+    }
+    this->QueueLock->Unlock();
+
+    return job;
+  }
+
+  //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+  std::deque< Job* >::iterator JobScheduler::FindNextJob()
+  {
+    // the queue is sorted by priority so only the first job needs to be considered
+    std::deque< Job* >::iterator it = this->Queue.begin();
+    if( this->Queue.end() == it || Job::BACKGROUND != ( *it )->GetPriority() ) return it;
+
+    // background jobs may not take the last free worker
+    if( 1 >= this->NumberOfWorkers ) return it;
+    int background = 0;
+    std::vector< Job* >::iterator runIt;
+    for( runIt = this->RunningJobs.begin(); runIt != this->RunningJobs.end(); ++runIt )
+      if( Job::BACKGROUND == ( *runIt )->GetPriority() ) background++;
+    return background < this->NumberOfWorkers - 1 ? it : this->Queue.end();
+  }
+
+  //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+  VTK_THREAD_RETURN_TYPE JobScheduler::WorkerThread( void *arg )
+  {
+    vtkMultiThreader::ThreadInfo *info = static_cast< vtkMultiThreader::ThreadInfo* >( arg );
+    JobScheduler *self = static_cast< JobScheduler* >( info->UserData );
+    Application *app = Application::GetInstance();
+
+    // every worker gets its own database connection
+    bool initialized = false;
+    try
+    {
+      app->InitializeThread();
+      initialized = true;
+    }
+    catch( std::exception &e )
+    {
+      cerr << "ERROR: unable to initialize job scheduler thread: " << e.what() << endl;
+      vtkBirchMySQLDatabase::ThreadFinalize();
+    }
+
+    self->QueueLock->Lock();
+    self->NumberOfStartingWorkers--;
+    if( initialized ) self->NumberOfWorkers++;
+    self->QueueCondition->Broadcast();
+    self->QueueLock->Unlock();
+
+    Job *job;
+    while( initialized && NULL != ( job = self->WaitForJob() ) )
+    {
+      // the job may be released by the GUI thread as soon as it has finished
+      int priority = job->GetPriority();
+      job->Run( self );
+
+      // a queued background job may have been waiting for this one to finish
+      self->QueueLock->Lock();
+      self->RunningJobs.erase(
+        std::find( self->RunningJobs.begin(), self->RunningJobs.end(), job ) );
+      if( Job::BACKGROUND == priority ) self->QueueCondition->Broadcast();
+      self->QueueLock->Unlock();
+    }
+
+    if( initialized )
+    {
+      self->QueueLock->Lock();
+      self->NumberOfWorkers--;
+      self->QueueLock->Unlock();
+      app->FinalizeThread();
+    }
+    return VTK_THREAD_RETURN_VALUE;
+  }
+}
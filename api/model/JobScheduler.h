@@ -0,0 +1,194 @@
+/*=========================================================================
+
+  Program:  Birch (CLSA Retinal Image Viewer)
+  Module:   JobScheduler.h
+  Language: C++
+
+  Author: Patrick Emond <emondpd@mcmaster.ca>
+  Author: Dean Inglis <inglisd@mcmaster.ca>
+
+=========================================================================*/
+
+/**
+ * @class JobScheduler
+ * @namespace Birch
+ *
+ * @author Patrick Emond <emondpd@mcmaster.ca>
+ * @author Dean Inglis <inglisd@mcmaster.ca>
+ *
+ * @brief Runs jobs on a pool of worker threads
+ *
+ * A single instance of this class is created and managed by the Application
+ * singleton.  Jobs may be submitted to run once or to repeat at a fixed interval.
+ * Each worker thread has its own database connection (see
+ * Application::InitializeThread()) so that active records may be used from within
+ * a job without interfering with the GUI thread.
+ *
+ * Queued jobs are run in order of priority, then in the order they were submitted.
+ * When there is more than one worker, one is always kept free of BACKGROUND jobs
+ * so that the jobs the user is waiting on never queue behind a prefetch or a sync.
+ *
+ * Events posted by jobs are queued and only invoked (on this object, with the job
+ * as call data) when ProcessEvents() is called.  The interface calls ProcessEvents()
+ * from a timer so that all observers are run on the GUI thread.
+ */
+
+#ifndef __JobScheduler_h
+#define __JobScheduler_h
+
+#include "ModelObject.h"
+
+#include "vtkCommand.h"
+#include "vtkMultiThreader.h"
+
+#include <deque>
+#include <iostream>
+#include <set>
+#include <vector>
+
+class vtkConditionVariable;
+class vtkSimpleMutexLock;
+
+/**
+ * @addtogroup Birch
+ * @{
+ */
+
+namespace Birch
+{
+  class Job;
+  class JobScheduler : public ModelObject
+  {
+  public:
+    static JobScheduler *New();
+    vtkTypeMacro( JobScheduler, ModelObject );
+
+    /** Events invoked by ProcessEvents(), call data is always the job */
+    enum
+    {
+      JobStartedEvent = vtkCommand::UserEvent + 200,
+      JobProgressEvent,
+      JobFinishedEvent,
+      JobDataEvent
+    };
+
+    /**
+     * Starts the worker threads and waits for them to connect to the database.
+     * Workers which can't connect exit straight away, so IsRunning() is false
+     * after this returns if none of them could.
+     * @param numberOfThreads int
+     */
+    void Start( int numberOfThreads );
+
+    /**
+     * Cancels all jobs and waits for the worker threads to end
+     */
+    void Stop();
+
+    /**
+     * Returns whether any worker thread is running and able to run jobs.  This method
+     * is thread safe.
+     */
+    bool IsRunning();
+
+    /**
+     * Adds a job to the queue, after any queued jobs of the same or higher priority.
+     * Submitting a job which is already queued or running does nothing.
+     * @param job Job
+     */
+    void Submit( Job *job );
+
+    /**
+     * Runs a job every interval seconds.  The first run happens after one interval.
+     * A repetition is skipped if the job is still queued or running from the last one.
+     * @param job Job
+     * @param interval double Number of seconds between runs
+     */
+    void SubmitRepeating( Job *job, double interval );
+
+    /**
+     * Stops a job from repeating (this does not cancel the job if it is running)
+     */
+    void RemoveRepeating( Job *job );
+
+    /**
+     * Returns whether a job is queued or running
+     */
+    bool IsPending( Job *job );
+
+    /**
+     * Cancels all queued and running jobs
+     */
+    void CancelAll();
+
+    /**
+     * Queues an event to be invoked on the GUI thread.  This method is thread safe.
+     * @param job Job The job which the event concerns
+     * @param event unsigned long
+     */
+    void PostEvent( Job *job, unsigned long event );
+
+    /**
+     * Invokes all queued events and submits any repeating jobs which are due.
+     * This must only be called from the GUI thread.
+     */
+    void ProcessEvents();
+
+  protected:
+    JobScheduler();
+    ~JobScheduler();
+
+    /**
+     * The function run by every worker thread
+     */
+    static VTK_THREAD_RETURN_TYPE WorkerThread( void *arg );
+
+    /**
+     * Waits for a job to become available, returns NULL when the scheduler is stopping
+     */
+    Job* WaitForJob();
+
+    /**
+     * Returns the queued job which a free worker may run next, or NULL if there is
+     * none (the queue lock must be held)
+     */
+    std::deque< Job* >::iterator FindNextJob();
+
+    vtkMultiThreader *Threader;
+    std::vector< int > ThreadIds;
+
+    vtkSimpleMutexLock *QueueLock;
+    vtkConditionVariable *QueueCondition;
+    std::deque< Job* > Queue;
+    std::vector< Job* > RunningJobs;
+    bool Stopping;
+
+    // workers which are connected and running jobs, and those still connecting
+    // (protected by the queue lock, changes are broadcast on the queue condition)
+    int NumberOfWorkers;
+    int NumberOfStartingWorkers;
+
+    vtkSimpleMutexLock *EventLock;
+    std::deque< std::pair< Job*, unsigned long > > Events;
+
+    // jobs which have been submitted but whose finished event hasn't been processed
+    // (only accessed by the GUI thread)
+    std::set< Job* > PendingJobs;
+
+    struct RepeatingJob
+    {
+      Job *RepeatJob;
+      double Interval;
+      double NextRun;
+    };
+    std::vector< RepeatingJob > RepeatingJobs;
+
+  private:
+    JobScheduler( const JobScheduler& ); // Not implemented
+    void operator=( const JobScheduler& ); // Not implemented
+  };
+}
+
+/** @} end of doxygen group */
+
+#endif
@@ -14,10 +14,14 @@
 #include "Configuration.h"
 #include "Utilities.h"
 
+#include "vtkConditionVariable.h"
+#include "vtkMutexLock.h"
 #include "vtkObjectFactory.h"
+#include "vtkTimerLog.h"
 
 #include <sstream>
 #include <stdexcept>
+#include <vtksys/SystemTools.hxx>
 
 namespace Birch
 {
@@ -30,15 +34,85 @@ namespace Birch
     this->Password = "";
     this->Host = "localhost";
     this->Port = 8843;
+    this->Protocol = "https";
+    this->StatisticsLock = vtkSimpleMutexLock::New();
+    this->ResetStatistics();
+    this->CacheLock = vtkSimpleMutexLock::New();
+    this->CacheCondition = vtkConditionVariable::New();
+    this->BatchDelay = 10;
+    this->MaxBatchSize = 100;
+    this->CacheSize = 100000;
+    this->CacheExpiry = 3600.0;
   }
 
   //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
-  void OpalService::Setup( std::string username, std::string password, std::string host, int port )
+  OpalService::~OpalService()
+  {
+    if( NULL != this->StatisticsLock )
+    {
+      this->StatisticsLock->Delete();
+      this->StatisticsLock = NULL;
+    }
+
+    if( NULL != this->CacheLock )
+    {
+      this->CacheLock->Delete();
+      this->CacheLock = NULL;
+    }
+
+    if( NULL != this->CacheCondition )
+    {
+      this->CacheCondition->Delete();
+      this->CacheCondition = NULL;
+    }
+  }
+
+  //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+  void OpalService::Setup(
+    std::string username, std::string password, std::string host, int port, std::string protocol )
   {
     this->Username = username;
     this->Password = password;
     this->Host = host;
     this->Port = port;
+    this->Protocol = protocol;
+  }
+
+  //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+  void OpalService::ResetStatistics()
+  {
+    this->StatisticsLock->Lock();
+    this->NumberOfRequests = 0;
+    this->NumberOfBytesRead = 0.0;
+    this->RequestTime = 0.0;
+    this->StatisticsLock->Unlock();
+  }
+
+  //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+  int OpalService::GetNumberOfRequests()
+  {
+    this->StatisticsLock->Lock();
+    int requests = this->NumberOfRequests;
+    this->StatisticsLock->Unlock();
+    return requests;
+  }
+
+  //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+  double OpalService::GetNumberOfBytesRead()
+  {
+    this->StatisticsLock->Lock();
+    double bytes = this->NumberOfBytesRead;
+    this->StatisticsLock->Unlock();
+    return bytes;
+  }
+
+  //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+  double OpalService::GetRequestTime()
+  {
+    this->StatisticsLock->Lock();
+    double time = this->RequestTime;
+    this->StatisticsLock->Unlock();
+    return time;
   }
 
   //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
@@ -48,11 +122,19 @@ namespace Birch
     Json::Reader reader;
     
     std::stringstream stream;
-    stream << "./opal.py --opal https://" << this->Host << ":" << this->Port
+    stream << "./opal.py --opal " << this->Protocol << "://" << this->Host << ":" << this->Port
            << " --user " << this->Username 
            << " --password " << this->Password
            << " --ws \"" << servicePath << "\"";
+
+    double startTime = vtkTimerLog::GetUniversalTime();
     std::string result = exec( stream.str().c_str() );
+    this->StatisticsLock->Lock();
+    this->NumberOfRequests++;
+    this->NumberOfBytesRead += result.length();
+    this->RequestTime += vtkTimerLog::GetUniversalTime() - startTime;
+    this->StatisticsLock->Unlock();
+
     if( 0 == result.length() )
       throw std::runtime_error( "Invalid response from Opal service" );
     else if( !reader.parse( result.c_str(), root ) )
@@ -82,27 +164,257 @@ namespace Birch
   
   //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
   std::map< std::string, std::string > OpalService::GetValueList(
-      std::string dataSource, std::string table, std::string variable, int offset, int limit )
+      std::string dataSource, std::string table, std::string variable, int offset, int limit,
+      int *numberOfValueSets )
   {
     std::stringstream stream;
     stream << "/datasource/" << dataSource << "/table/" << table
            << "/valueSets?offset=" << offset << "&limit=" << limit
            << "&select=name().eq('" << variable << "')";
     Json::Value root = this->Read( stream.str() );
-    
+    std::map< std::string, std::string > list = this->ParseValueSets( root );
+    if( NULL != numberOfValueSets ) *numberOfValueSets = root["valueSets"].size();
+
+    // memoize the values while we have them
+    std::stringstream column;
+    column << dataSource << "/" << table << "/" << variable;
+    this->CacheLock->Lock();
+    std::map< std::string, std::string >::iterator it;
+    for( it = list.begin(); it != list.end(); ++it )
+      this->CacheValue( column.str(), it->first, it->second );
+    this->CacheLock->Unlock();
+
+    return list;
+  }
+
+  //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+  std::string OpalService::GetValue(
+    std::string dataSource, std::string table, std::string variable, std::string identifier )
+  {
+    std::stringstream stream;
+    stream << dataSource << "/" << table << "/" << variable;
+    std::string column = stream.str();
+    std::string value;
+
+    this->CacheLock->Lock();
+    while( !this->FindCachedValue( column, identifier, value ) )
+    {
+      if( this->ActiveLookups.end() != this->ActiveLookups.find( column ) )
+      {
+        // another thread is requesting this column, join its next batch
+        this->PendingLookups[column].insert( identifier );
+        this->CacheCondition->Wait( *this->CacheLock );
+        continue;
+      }
+
+      // this thread makes the request, give others a chance to add to the batch first
+      this->ActiveLookups.insert( column );
+      this->PendingLookups[column].insert( identifier );
+      this->CacheLock->Unlock();
+      if( 0 < this->BatchDelay ) vtksys::SystemTools::Delay( this->BatchDelay );
+      this->CacheLock->Lock();
+
+      std::set< std::string > &pending = this->PendingLookups[column];
+      std::set< std::string > batch;
+      batch.insert( identifier );
+      pending.erase( identifier );
+      while( !pending.empty() && (int) batch.size() < this->MaxBatchSize )
+      {
+        batch.insert( *pending.begin() );
+        pending.erase( pending.begin() );
+      }
+      if( pending.empty() ) this->PendingLookups.erase( column );
+      this->CacheLock->Unlock();
+
+      std::map< std::string, std::string > list;
+      try
+      {
+        list = this->ReadValues( dataSource, table, variable, batch );
+      }
+      catch( std::exception &e )
+      {
+        // waiting threads will try again themselves
+        this->CacheLock->Lock();
+        this->ActiveLookups.erase( column );
+        this->CacheCondition->Broadcast();
+        this->CacheLock->Unlock();
+        throw;
+      }
+
+      // entities which Opal doesn't know aren't memoized, their threads will ask again
+      this->CacheLock->Lock();
+      std::map< std::string, std::string >::iterator it;
+      for( it = list.begin(); it != list.end(); ++it )
+        this->CacheValue( column, it->first, it->second );
+      this->ActiveLookups.erase( column );
+      this->CacheCondition->Broadcast();
+
+      // don't rely on the cache since the value may already have been evicted
+      value = list[identifier];
+      break;
+    }
+    this->CacheLock->Unlock();
+
+    return value;
+  }
+
+  //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+  std::map< std::string, std::string > OpalService::GetValues(
+    std::string dataSource, std::string table, std::string variable,
+    const std::vector< std::string > &identifierList )
+  {
+    std::stringstream stream;
+    stream << dataSource << "/" << table << "/" << variable;
+    std::string column = stream.str();
+
+    // find which values are not already memoized
+    std::map< std::string, std::string > list;
+    std::set< std::string > missingList;
+    std::vector< std::string >::const_iterator identifier;
+    this->CacheLock->Lock();
+    for( identifier = identifierList.begin(); identifier != identifierList.end(); ++identifier )
+    {
+      std::string value;
+      if( this->FindCachedValue( column, *identifier, value ) ) list[*identifier] = value;
+      else missingList.insert( *identifier );
+    }
+    this->CacheLock->Unlock();
+
+    // request the missing values in batches
+    std::set< std::string >::iterator it = missingList.begin();
+    while( it != missingList.end() )
+    {
+      std::set< std::string > batch;
+      for( ; it != missingList.end() && (int) batch.size() < this->MaxBatchSize; ++it )
+        batch.insert( *it );
+
+      std::map< std::string, std::string > batchList =
+        this->ReadValues( dataSource, table, variable, batch );
+
+      // entities missing from the response are unknown rather than empty, so they
+      // aren't memoized
+      this->CacheLock->Lock();
+      std::map< std::string, std::string >::iterator batchIt;
+      for( batchIt = batchList.begin(); batchIt != batchList.end(); ++batchIt )
+      {
+        this->CacheValue( column, batchIt->first, batchIt->second );
+        list[batchIt->first] = batchIt->second;
+      }
+      this->CacheLock->Unlock();
+    }
+
+    return list;
+  }
+
+  //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+  void OpalService::ClearCache()
+  {
+    this->CacheLock->Lock();
+    this->Columns.clear();
+    this->CacheOrder.clear();
+    this->CacheLock->Unlock();
+  }
+
+  //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+  std::map< std::string, std::string > OpalService::ParseValueSets( Json::Value &root, bool includeEmpty )
+  {
     std::map< std::string, std::string > list;
     for( int i = 0; i < root["valueSets"].size(); ++i )
     {
       std::string identifier = root["valueSets"][i].get( "identifier", "" ).asString();
       std::string value = root["valueSets"][i]["values"][0].get( "value", "" ).asString();
-      if( 0 < identifier.length() && 0 < value.length() ) list[identifier] = value;
+      if( 0 < identifier.length() && ( includeEmpty || 0 < value.length() ) ) list[identifier] = value;
     }
 
     return list;
   }
 
   //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
-  void OpalService::GetValue( std::string dataSource, std::string table, std::string variable )
+  std::map< std::string, std::string > OpalService::ReadValues(
+    std::string dataSource, std::string table, std::string variable,
+    const std::set< std::string > &identifierList )
   {
+    std::map< std::string, std::string > list;
+    std::string error;
+    std::set< std::string >::const_iterator it;
+    for( it = identifierList.begin(); it != identifierList.end(); ++it )
+    {
+      std::stringstream stream;
+      stream << "/datasource/" << dataSource << "/table/" << table
+             << "/valueSet/" << *it << "?select=name().eq('" << variable << "')";
+
+      // Opal fails the request of an unknown entity, which shouldn't fail the others
+      Json::Value root;
+      try
+      {
+        root = this->Read( stream.str() );
+      }
+      catch( std::exception &e )
+      {
+        error = e.what();
+        continue;
+      }
+
+      std::map< std::string, std::string > valueSet = this->ParseValueSets( root, true );
+      std::map< std::string, std::string >::iterator found = valueSet.find( *it );
+      if( valueSet.end() != found ) list[*it] = found->second;
+    }
+
+    if( list.empty() && 0 < error.length() ) throw std::runtime_error( error );
+
+    return list;
+  }
+
+  //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+  bool OpalService::FindCachedValue( std::string column, std::string identifier, std::string &value )
+  {
+    std::map< std::string, std::map< std::string, CacheEntry > >::iterator columnIt =
+      this->Columns.find( column );
+    if( this->Columns.end() == columnIt ) return false;
+
+    std::map< std::string, CacheEntry >::iterator entryIt = columnIt->second.find( identifier );
+    if( columnIt->second.end() == entryIt ) return false;
+
+    // expired values are removed when the cache order is next trimmed
+    if( vtkTimerLog::GetUniversalTime() - entryIt->second.Time > this->CacheExpiry ) return false;
+
+    value = entryIt->second.Value;
+    return true;
+  }
+
+  //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+  void OpalService::CacheValue( std::string column, std::string identifier, std::string value )
+  {
+    double now = vtkTimerLog::GetUniversalTime();
+    CacheEntry &entry = this->Columns[column][identifier];
+    entry.Value = value;
+    entry.Time = now;
+
+    CacheRecord record;
+    record.Column = column;
+    record.Identifier = identifier;
+    record.Time = now;
+    this->CacheOrder.push_back( record );
+
+    // evict the oldest values until the cache is within its bounds (a record is stale
+    // if its value has since been memoized again, in which case nothing is evicted)
+    while( !this->CacheOrder.empty() &&
+           ( (int) this->CacheOrder.size() > this->CacheSize ||
+             now - this->CacheOrder.front().Time > this->CacheExpiry ) )
+    {
+      record = this->CacheOrder.front();
+      this->CacheOrder.pop_front();
+
+      std::map< std::string, std::map< std::string, CacheEntry > >::iterator columnIt =
+        this->Columns.find( record.Column );
+      if( this->Columns.end() == columnIt ) continue;
+      std::map< std::string, CacheEntry >::iterator entryIt =
+        columnIt->second.find( record.Identifier );
+      if( columnIt->second.end() != entryIt && entryIt->second.Time == record.Time )
+      {
+        columnIt->second.erase( entryIt );
+        if( columnIt->second.empty() ) this->Columns.erase( columnIt );
+      }
+    }
   }
 }
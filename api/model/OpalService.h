@@ -21,6 +21,11 @@
  * This class provides a programming interface to Opal's RESTful interface by using the
  * curl library.  A description of Opal can be found
  * <a href="http://www.obiba.org/?q=node/63">here</a>.
+ *
+ * Values of individual entities are memoized.  Lookups of the same variable made
+ * by several threads at the same time are coalesced into a single batch which one
+ * thread requests on behalf of the others, and memoized values are discarded once
+ * they expire or when the cache grows beyond its maximum size.
  */
 
 #ifndef __OpalService_h
@@ -31,12 +36,16 @@
 #include "vtkSmartPointer.h"
 #include "vtkBirchMySQLQuery.h"
 
+#include <deque>
 #include <iostream>
 #include <json/reader.h>
 #include <map>
+#include <set>
 #include <vector>
 
 class vtkBirchMySQLOpalService;
+class vtkConditionVariable;
+class vtkSimpleMutexLock;
 
 /**
  * @addtogroup Birch
@@ -54,8 +63,11 @@ namespace Birch
 
     /**
      * Defines connection parameters to use when communicating with the Opal server
+     * (the protocol should only be changed from https when connecting to a local
+     * stand-in server such as aux/opal_stub.py)
      */
-    void Setup( std::string username, std::string password, std::string host, int port );
+    void Setup( std::string username, std::string password, std::string host, int port,
+                std::string protocol = "https" );
 
     /**
      * Returns a list of all identifiers in a particular data source and table
@@ -71,21 +83,92 @@ namespace Birch
      * @param variable string
      * @param offset int The offset to begin the list at.
      * @param limit int The limit of how many key/value pairs to return
+     * @param numberOfValueSets int* If not null, set to the number of value sets Opal
+     *        returned, including those without a value (Opal leaves out empty values
+     *        and may return fewer value sets than the limit)
      */
     std::map< std::string, std::string > GetValueList(
-      std::string dataSource, std::string table, std::string variable, int offset = 0, int limit = 100 );
+      std::string dataSource, std::string table, std::string variable, int offset = 0, int limit = 100,
+      int *numberOfValueSets = NULL );
 
     /**
-     * Returns the value of a particular data source, table and variable name
+     * Returns the value of a particular data source, table and variable name for a
+     * single entity, or an empty string if Opal has no value.  This method is thread safe.
      * @param dataSource string
      * @param table string
      * @param variable string
+     * @param identifier string
+     * @throws runtime_error
+     */
+    std::string GetValue(
+      std::string dataSource, std::string table, std::string variable, std::string identifier );
+
+    /**
+     * Returns the values of a particular data source, table and variable name for a
+     * list of entities.  Values which are not memoized are requested in batches of
+     * at most MaxBatchSize entities.  Entities which Opal doesn't know are neither
+     * returned nor memoized.  This method is thread safe.
+     * @param dataSource string
+     * @param table string
+     * @param variable string
+     * @param identifierList vector
+     * @throws runtime_error
+     */
+    std::map< std::string, std::string > GetValues(
+      std::string dataSource, std::string table, std::string variable,
+      const std::vector< std::string > &identifierList );
+
+    /**
+     * Discards all memoized values
+     */
+    void ClearCache();
+
+    //@{
+    /**
+     * The maximum number of entities requested from Opal at once
+     */
+    vtkSetMacro( MaxBatchSize, int );
+    vtkGetMacro( MaxBatchSize, int );
+    //@}
+
+    //@{
+    /**
+     * The time (in milliseconds) to wait for other lookups to join a batch
+     */
+    vtkSetMacro( BatchDelay, int );
+    vtkGetMacro( BatchDelay, int );
+    //@}
+
+    //@{
+    /**
+     * The maximum number of memoized values
+     */
+    vtkSetMacro( CacheSize, int );
+    vtkGetMacro( CacheSize, int );
+    //@}
+
+    //@{
+    /**
+     * The time (in seconds) after which a memoized value is discarded
      */
-    void GetValue( std::string dataSource, std::string table, std::string variable );
+    vtkSetMacro( CacheExpiry, double );
+    vtkGetMacro( CacheExpiry, double );
+    //@}
+
+    //@{
+    /**
+     * Transfer statistics accumulated by all requests made since the last call to
+     * ResetStatistics().  These methods are thread safe.
+     */
+    void ResetStatistics();
+    int GetNumberOfRequests();
+    double GetNumberOfBytesRead();
+    double GetRequestTime();
+    //@}
 
   protected:
     OpalService();
-    ~OpalService() {}
+    ~OpalService();
 
     /**
      * Returns the response provided by Opal for a given service path
@@ -94,11 +177,71 @@ namespace Birch
      */
     virtual Json::Value Read( std::string servicePath );
 
-    std::map< std::string,std::map< std::string,std::map< std::string, std::string > > > Columns;
+    /**
+     * Returns the identifier/value pairs found in a valueSets response, leaving out
+     * empty values unless requested
+     */
+    std::map< std::string, std::string > ParseValueSets( Json::Value &root, bool includeEmpty = false );
+
+    /**
+     * Requests the values of a set of entities.  Opal's valueSets service can't select
+     * entities, so each entity is requested by its own valueSet service.  Entities
+     * which Opal doesn't know are left out and those it has no value for are returned
+     * with an empty value.
+     * @throws runtime_error if none of the entities could be requested
+     */
+    std::map< std::string, std::string > ReadValues(
+      std::string dataSource, std::string table, std::string variable,
+      const std::set< std::string > &identifierList );
+
+    //@{
+    /**
+     * Methods used to access the memoized values (the cache lock must be held)
+     */
+    bool FindCachedValue( std::string column, std::string identifier, std::string &value );
+    void CacheValue( std::string column, std::string identifier, std::string value );
+    //@}
+
+    struct CacheEntry
+    {
+      std::string Value;
+      double Time;
+    };
+
+    struct CacheRecord
+    {
+      std::string Column;
+      std::string Identifier;
+      double Time;
+    };
+
+    // memoized values indexed by column (data source, table and variable) then identifier
+    std::map< std::string, std::map< std::string, CacheEntry > > Columns;
+
+    // the order in which values were memoized, used to expire and evict values
+    std::deque< CacheRecord > CacheOrder;
+
+    // identifiers waiting to be requested and columns with a request in progress
+    std::map< std::string, std::set< std::string > > PendingLookups;
+    std::set< std::string > ActiveLookups;
+
+    vtkSimpleMutexLock *CacheLock;
+    vtkConditionVariable *CacheCondition;
+    int BatchDelay;
+    int MaxBatchSize;
+    int CacheSize;
+    double CacheExpiry;
+
     std::string Username;
     std::string Password;
     std::string Host;
     int Port;
+    std::string Protocol;
+
+    vtkSimpleMutexLock *StatisticsLock;
+    int NumberOfRequests;
+    double NumberOfBytesRead;
+    double RequestTime;
 
   private:
     OpalService( const OpalService& ); // Not implemented
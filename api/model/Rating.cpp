@@ -1,20 +0,0 @@
-/*=========================================================================
-
-  Program:  Birch (CLSA Retinal Image Viewer)
-  Module:   Rating.cxx
-  Language: C++
-
-  Author: Patrick Emond <emondpd@mcmaster.ca>
-  Author: Dean Inglis <inglisd@mcmaster.ca>
-
-=========================================================================*/
-#include "Rating.h"
-
-#include "Utilities.h"
-
-#include "vtkObjectFactory.h"
-
-namespace Birch
-{
-  vtkStandardNewMacro( Rating );
-}
@@ -0,0 +1,74 @@
+/*=========================================================================
+
+  Program:  Birch (CLSA Retinal Image Viewer)
+  Module:   Rating.cxx
+  Language: C++
+
+  Author: Patrick Emond <emondpd@mcmaster.ca>
+  Author: Dean Inglis <inglisd@mcmaster.ca>
+
+=========================================================================*/
+#include "Rating.h"
+
+#include "Application.h"
+#include "Database.h"
+#include "Utilities.h"
+
+#include "vtkBirchMySQLQuery.h"
+#include "vtkObjectFactory.h"
+#include "vtkSmartPointer.h"
+
+#include <sstream>
+#include <stdexcept>
+
+namespace Birch
+{
+  vtkStandardNewMacro( Rating );
+
+  //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+  void Rating::Upsert( int userId, int imageId, int value )
+  {
+    vtkSmartPointer<vtkBirchMySQLQuery> query = Application::GetInstance()->GetDB()->GetQuery();
+    std::stringstream stream;
+    stream << "INSERT INTO Rating ( image_id, user_id, rating, create_timestamp ) "
+           << "VALUES ( " << imageId << ", " << userId << ", ";
+    if( 0 == value ) stream << "NULL";
+    else stream << value;
+    stream << ", NULL ) "
+           << "ON DUPLICATE KEY UPDATE rating = VALUES( rating )";
+
+    query->SetQuery( stream.str().c_str() );
+
+    // failures are reported so that the rating may be written again later
+    if( !query->Execute() )
+    {
+      std::stringstream error;
+      error << "Unable to write rating: " << query->GetLastErrorText();
+      throw std::runtime_error( error.str() );
+    }
+  }
+
+  //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+  void Rating::GetStudyRatings( int userId, int studyId, std::map< int, int > &ratings )
+  {
+    vtkSmartPointer<vtkBirchMySQLQuery> query = Application::GetInstance()->GetDB()->GetQuery();
+    std::stringstream stream;
+    stream << "SELECT Rating.image_id, Rating.rating "
+           << "FROM Rating "
+           << "JOIN Image ON Image.id = Rating.image_id "
+           << "WHERE Image.study_id = " << studyId << " "
+           << "AND Rating.user_id = " << userId << " "
+           << "AND Rating.rating IS NOT NULL";
+
+    query->SetQuery( stream.str().c_str() );
+    if( !query->Execute() )
+    {
+      std::stringstream error;
+      error << "Unable to read ratings: " << query->GetLastErrorText();
+      throw std::runtime_error( error.str() );
+    }
+
+    while( query->NextRow() )
+      ratings[query->DataValue( 0 ).ToInt()] = query->DataValue( 1 ).ToInt();
+  }
+}
@@ -17,6 +17,9 @@
  * @author Dean Inglis <inglisd@mcmaster.ca>
  * 
  * @brief An active record for the Rating table
+ *
+ * Each user has at most one rating per image (the table has a unique index on
+ * image_id and user_id), use Upsert() to write a rating in a single statement.
  */
 
 #ifndef __Rating_h
@@ -25,6 +28,7 @@
 #include "ActiveRecord.h"
 
 #include <iostream>
+#include <map>
 
 /**
  * @addtogroup Birch
@@ -40,6 +44,25 @@ namespace Birch
     vtkTypeMacro( Rating, ActiveRecord );
     std::string GetName() { return "Rating"; }
 
+    /**
+     * Writes a user's rating of an image using a single INSERT ... ON DUPLICATE KEY
+     * UPDATE statement, whether or not the user has rated the image before
+     * @param userId int
+     * @param imageId int
+     * @param value int The rating (0 removes the rating)
+     * @throws runtime_error
+     */
+    static void Upsert( int userId, int imageId, int value );
+
+    /**
+     * Reads all of a user's ratings of a study's images using a single statement
+     * @param userId int
+     * @param studyId int
+     * @param ratings map Rating values indexed by image id (unrated images are left out)
+     * @throws runtime_error
+     */
+    static void GetStudyRatings( int userId, int studyId, std::map< int, int > &ratings );
+
   protected:
     Rating() {}
     ~Rating() {}
@@ -0,0 +1,85 @@
+/*=========================================================================
+
+  Program:  Birch (CLSA Retinal Image Viewer)
+  Module:   RatingWriteJob.cxx
+  Language: C++
+
+  Author: Patrick Emond <emondpd@mcmaster.ca>
+  Author: Dean Inglis <inglisd@mcmaster.ca>
+
+=========================================================================*/
+
+#include "RatingWriteJob.h"
+
+#include "Rating.h"
+
+#include "vtkMutexLock.h"
+#include "vtkObjectFactory.h"
+
+namespace Birch
+{
+  vtkStandardNewMacro( RatingWriteJob );
+
+  //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+  RatingWriteJob::RatingWriteJob()
+  {
+    this->Priority = Job::INTERACTIVE;
+    this->NumberOfRatingsWritten = 0;
+  }
+
+  //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+  void RatingWriteJob::AddRating( int userId, int imageId, int value )
+  {
+    Entry entry;
+    entry.UserId = userId;
+    entry.ImageId = imageId;
+    entry.Value = value;
+    this->Ratings.push_back( entry );
+  }
+
+  //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+  int RatingWriteJob::GetNumberOfRatingsWritten()
+  {
+    this->Lock->Lock();
+    int number = this->NumberOfRatingsWritten;
+    this->Lock->Unlock();
+    return number;
+  }
+
+  //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+  void RatingWriteJob::TakeUnwritten( std::vector< Entry > &list )
+  {
+    this->Lock->Lock();
+    list.insert( list.end(), this->Ratings.begin() + this->NumberOfRatingsWritten, this->Ratings.end() );
+    this->Ratings.erase( this->Ratings.begin() + this->NumberOfRatingsWritten, this->Ratings.end() );
+    this->Lock->Unlock();
+  }
+
+  //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+  void RatingWriteJob::WriteRating( const Entry &entry )
+  {
+    Rating::Upsert( entry.UserId, entry.ImageId, entry.Value );
+  }
+
+  //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+  void RatingWriteJob::Execute()
+  {
+    // ratings are written in order so that the unwritten ones are always at the end,
+    // and the writer may take the unwritten ones back at any time (see TakeUnwritten())
+    for( int i = 0; ; ++i )
+    {
+      this->Lock->Lock();
+      int size = this->Ratings.size();
+      Entry entry;
+      if( i < size ) entry = this->Ratings[i];
+      this->Lock->Unlock();
+      if( i >= size ) break;
+
+      RatingWriteJob::WriteRating( entry );
+      this->Lock->Lock();
+      this->NumberOfRatingsWritten = i + 1;
+      this->Lock->Unlock();
+      this->UpdateProgress( (double)( i + 1 ) / size );
+    }
+  }
+}
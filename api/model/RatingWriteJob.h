@@ -0,0 +1,106 @@
+/*=========================================================================
+
+  Program:  Birch (CLSA Retinal Image Viewer)
+  Module:   RatingWriteJob.h
+  Language: C++
+
+  Author: Patrick Emond <emondpd@mcmaster.ca>
+  Author: Dean Inglis <inglisd@mcmaster.ca>
+
+=========================================================================*/
+
+/**
+ * @class RatingWriteJob
+ * @namespace Birch
+ *
+ * @author Patrick Emond <emondpd@mcmaster.ca>
+ * @author Dean Inglis <inglisd@mcmaster.ca>
+ *
+ * @brief Job which writes a batch of ratings to the database
+ *
+ * Used by the RatingWriter to save ratings without blocking the GUI thread.  Every
+ * rating is written even if the job is cancelled once it has started.  If writing
+ * fails (for instance when the connection to the database is lost) the job fails and
+ * the ratings which were not written may be collected (on the GUI thread) using
+ * TakeUnwritten() once the scheduler has posted the job's JobFinishedEvent.  They may
+ * also be taken back while the job is running, in which case the job stops once it
+ * has written the rating in progress.
+ */
+
+#ifndef __RatingWriteJob_h
+#define __RatingWriteJob_h
+
+#include "Job.h"
+
+#include <iostream>
+#include <vector>
+
+/**
+ * @addtogroup Birch
+ * @{
+ */
+
+namespace Birch
+{
+  class RatingWriteJob : public Job
+  {
+  public:
+    static RatingWriteJob *New();
+    vtkTypeMacro( RatingWriteJob, Job );
+
+    std::string GetDescription() { return "Rating write"; }
+
+    /** A user's rating of an image (a value of 0 removes the rating) */
+    struct Entry
+    {
+      int UserId;
+      int ImageId;
+      int Value;
+    };
+
+    /**
+     * Adds a rating to be written, this must be done before the job is submitted
+     */
+    void AddRating( int userId, int imageId, int value );
+
+    /**
+     * Returns the ratings to be written by the job (whether or not they have been written)
+     */
+    const std::vector< Entry >& GetRatings() { return this->Ratings; }
+
+    /**
+     * Returns the number of ratings which have been written
+     */
+    int GetNumberOfRatingsWritten();
+
+    /**
+     * Moves all ratings which were not written into the given list (including the
+     * one being written if the job is running).  This must only be called from the
+     * GUI thread.
+     */
+    void TakeUnwritten( std::vector< Entry > &list );
+
+    /**
+     * Writes a single rating using the calling thread's database connection
+     * @throws runtime_error
+     */
+    static void WriteRating( const Entry &entry );
+
+  protected:
+    RatingWriteJob();
+    ~RatingWriteJob() {}
+
+    void Execute();
+
+    std::vector< Entry > Ratings;
+    int NumberOfRatingsWritten;
+
+  private:
+    RatingWriteJob( const RatingWriteJob& ); // Not implemented
+    void operator=( const RatingWriteJob& ); // Not implemented
+  };
+}
+
+/** @} end of doxygen group */
+
+#endif
@@ -0,0 +1,231 @@
+/*=========================================================================
+
+  Program:  Birch (CLSA Retinal Image Viewer)
+  Module:   RatingWriter.cxx
+  Language: C++
+
+  Author: Patrick Emond <emondpd@mcmaster.ca>
+  Author: Dean Inglis <inglisd@mcmaster.ca>
+
+=========================================================================*/
+
+#include "RatingWriter.h"
+
+#include "JobScheduler.h"
+#include "RatingWriteJob.h"
+
+#include "vtkObjectFactory.h"
+#include "vtkTimerLog.h"
+
+#include <vector>
+
+namespace Birch
+{
+  vtkStandardNewMacro( RatingWriter );
+
+  //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+  RatingWriter::RatingWriter()
+  {
+    this->LastChangeTime = 0.0;
+    this->FlushDelay = 1.0;
+    this->RetryDelay = 0.0;
+    this->MaximumRetryDelay = 60.0;
+    this->NextRetryTime = 0.0;
+    this->NumberOfRatingsQueued = 0;
+    this->NumberOfRatingsWritten = 0;
+    this->Scheduler = NULL;
+    this->Observer = vtkSmartPointer< Command >::New();
+    this->Observer->writer = this;
+  }
+
+  //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+  RatingWriter::~RatingWriter()
+  {
+    this->SetScheduler( NULL );
+  }
+
+  //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+  void RatingWriter::SetScheduler( JobScheduler *scheduler )
+  {
+    if( scheduler == this->Scheduler ) return;
+
+    if( this->Scheduler ) this->Scheduler->RemoveObserver( this->Observer );
+    this->Scheduler = scheduler;
+    if( this->Scheduler )
+      this->Scheduler->AddObserver( JobScheduler::JobFinishedEvent, this->Observer );
+  }
+
+  //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+  void RatingWriter::SetRating( int userId, int imageId, int value )
+  {
+    this->PendingRatings[Key( userId, imageId )] = value;
+    this->LastChangeTime = vtkTimerLog::GetUniversalTime();
+    this->NumberOfRatingsQueued++;
+  }
+
+  //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+  bool RatingWriter::GetRating( int userId, int imageId, int &value )
+  {
+    // queued ratings are newer than the ones being written
+    std::map< Key, int >::iterator it = this->PendingRatings.find( Key( userId, imageId ) );
+    if( this->PendingRatings.end() != it )
+    {
+      value = it->second;
+      return true;
+    }
+
+    if( this->WriteJob )
+    {
+      const std::vector< RatingWriteJob::Entry > &list = this->WriteJob->GetRatings();
+      std::vector< RatingWriteJob::Entry >::const_iterator entry;
+      for( entry = list.begin(); entry != list.end(); ++entry )
+      {
+        if( userId == entry->UserId && imageId == entry->ImageId )
+        {
+          value = entry->Value;
+          return true;
+        }
+      }
+    }
+
+    return false;
+  }
+
+  //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+  bool RatingWriter::HasPendingRatings()
+  {
+    return !this->PendingRatings.empty() || this->WriteJob;
+  }
+
+  //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+  void RatingWriter::Update()
+  {
+    if( this->PendingRatings.empty() ) return;
+
+    double now = vtkTimerLog::GetUniversalTime();
+    if( now - this->LastChangeTime >= this->FlushDelay && now >= this->NextRetryTime ) this->Flush();
+  }
+
+  //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+  void RatingWriter::Flush()
+  {
+    // only one write job runs at a time, ratings queued in the mean time are written
+    // once it has finished
+    if( this->PendingRatings.empty() || this->WriteJob ) return;
+
+    // after a failed write the ratings stay queued until the retry delay has passed
+    if( vtkTimerLog::GetUniversalTime() < this->NextRetryTime ) return;
+
+    // without worker threads the ratings are written right away
+    if( !this->Scheduler || !this->Scheduler->IsRunning() )
+    {
+      this->FlushNow();
+      return;
+    }
+
+    this->WriteJob = vtkSmartPointer< RatingWriteJob >::New();
+    std::map< Key, int >::iterator it;
+    for( it = this->PendingRatings.begin(); it != this->PendingRatings.end(); ++it )
+      this->WriteJob->AddRating( it->first.first, it->first.second, it->second );
+    this->PendingRatings.clear();
+    this->Scheduler->Submit( this->WriteJob );
+  }
+
+  //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+  void RatingWriter::FlushNow()
+  {
+    // a write job which hasn't finished (or failed) still has ratings to write, its
+    // finished event is ignored since it is no longer the current write job
+    if( this->WriteJob )
+    {
+      vtkSmartPointer< RatingWriteJob > writeJob = this->WriteJob;
+      this->WriteJob = NULL;
+      writeJob->Cancel();
+      this->Requeue( writeJob );
+    }
+
+    int written = 0;
+    try
+    {
+      while( !this->PendingRatings.empty() )
+      {
+        std::map< Key, int >::iterator it = this->PendingRatings.begin();
+        RatingWriteJob::Entry entry;
+        entry.UserId = it->first.first;
+        entry.ImageId = it->first.second;
+        entry.Value = it->second;
+        RatingWriteJob::WriteRating( entry );
+        this->PendingRatings.erase( it );
+        this->NumberOfRatingsWritten++;
+        written++;
+      }
+    }
+    catch( std::exception &e )
+    {
+      if( 0 < written ) this->InvokeEvent( RatingWriter::RatingsWrittenEvent );
+      throw;
+    }
+
+    if( 0 < written ) this->InvokeEvent( RatingWriter::RatingsWrittenEvent );
+  }
+
+  //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+  void RatingWriter::FinishWrite( Job *job )
+  {
+    vtkSmartPointer< RatingWriteJob > writeJob = RatingWriteJob::SafeDownCast( job );
+    if( !writeJob ) return;
+
+    // a job whose ratings were taken back by FlushNow() may still have written some
+    if( 0 < writeJob->GetNumberOfRatingsWritten() )
+      this->InvokeEvent( RatingWriter::RatingsWrittenEvent );
+    if( writeJob != this->WriteJob ) return;
+    this->WriteJob = NULL;
+    int unwritten = this->Requeue( writeJob );
+
+    // a write cancelled by the scheduler didn't fail, its ratings are simply written
+    // again by the next flush
+    if( Job::CANCELLED == writeJob->GetState() ) return;
+
+    double now = vtkTimerLog::GetUniversalTime();
+    if( 0 == unwritten )
+    {
+      this->RetryDelay = 0.0;
+      this->NextRetryTime = 0.0;
+    }
+    else
+    {
+      // wait longer after every consecutive failure (the connection may be down)
+      this->RetryDelay = 0.0 < this->RetryDelay ? 2.0 * this->RetryDelay : 1.0;
+      if( this->RetryDelay > this->MaximumRetryDelay ) this->RetryDelay = this->MaximumRetryDelay;
+      this->NextRetryTime = now + this->RetryDelay;
+      vtkWarningMacro( << unwritten << " rating(s) could not be written, retrying in "
+                       << this->RetryDelay << " seconds: " << writeJob->GetErrorMessage() );
+    }
+  }
+
+  //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+  int RatingWriter::Requeue( RatingWriteJob *writeJob )
+  {
+    this->NumberOfRatingsWritten += writeJob->GetNumberOfRatingsWritten();
+
+    // queue the ratings which weren't written unless they have been changed since
+    std::vector< RatingWriteJob::Entry > list;
+    std::vector< RatingWriteJob::Entry >::iterator entry;
+    writeJob->TakeUnwritten( list );
+    for( entry = list.begin(); entry != list.end(); ++entry )
+    {
+      Key key( entry->UserId, entry->ImageId );
+      if( this->PendingRatings.end() == this->PendingRatings.find( key ) )
+        this->PendingRatings[key] = entry->Value;
+    }
+
+    return list.size();
+  }
+
+  //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+  void RatingWriter::Command::Execute(
+    vtkObject *caller, unsigned long eventId, void *callData )
+  {
+    if( this->writer ) this->writer->FinishWrite( static_cast<Job*>( callData ) );
+  }
+}
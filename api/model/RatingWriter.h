@@ -0,0 +1,191 @@
+/*=========================================================================
+
+  Program:  Birch (CLSA Retinal Image Viewer)
+  Module:   RatingWriter.h
+  Language: C++
+
+  Author: Patrick Emond <emondpd@mcmaster.ca>
+  Author: Dean Inglis <inglisd@mcmaster.ca>
+
+=========================================================================*/
+
+/**
+ * @class RatingWriter
+ * @namespace Birch
+ *
+ * @author Patrick Emond <emondpd@mcmaster.ca>
+ * @author Dean Inglis <inglisd@mcmaster.ca>
+ *
+ * @brief Write-behind queue of ratings
+ *
+ * A single instance of this class is created and managed by the Application
+ * singleton.  Ratings are queued by SetRating() and only the last rating of each
+ * user and image is written, by a RatingWriteJob on the job scheduler's worker
+ * threads, once no rating has changed for the flush delay (see Update()).  Ratings
+ * which fail to be written are queued again and retried after a delay which doubles
+ * with every failure.
+ *
+ * Ratings queued (or being written) are returned by GetRating() so that the
+ * interface never displays a rating older than the one the user picked.  This class
+ * must only be used from the GUI thread.
+ */
+
+#ifndef __RatingWriter_h
+#define __RatingWriter_h
+
+#include "ModelObject.h"
+
+#include "vtkCommand.h"
+#include "vtkSmartPointer.h"
+
+#include <iostream>
+#include <map>
+#include <utility>
+
+/**
+ * @addtogroup Birch
+ * @{
+ */
+
+namespace Birch
+{
+  class Job;
+  class JobScheduler;
+  class RatingWriteJob;
+  class RatingWriter : public ModelObject
+  {
+  public:
+    static RatingWriter *New();
+    vtkTypeMacro( RatingWriter, ModelObject );
+
+    /**
+     * Invoked whenever ratings have been written to the database (by a write job or
+     * by FlushNow()), call data is NULL
+     */
+    enum
+    {
+      RatingsWrittenEvent = vtkCommand::UserEvent + 400
+    };
+
+    /**
+     * Queues a user's rating of an image, replacing any rating of the same user and
+     * image which hasn't been written yet
+     * @param userId int
+     * @param imageId int
+     * @param value int The rating (0 removes the rating)
+     */
+    void SetRating( int userId, int imageId, int value );
+
+    /**
+     * Gets a rating which is queued or being written, returns false if there is none
+     * (in which case the rating in the database is up to date)
+     */
+    bool GetRating( int userId, int imageId, int &value );
+
+    /**
+     * Returns whether any rating has not been written yet
+     */
+    bool HasPendingRatings();
+
+    /**
+     * Writes the queued ratings if the flush delay has passed since the last change.
+     * This is called periodically by the interface.
+     */
+    void Update();
+
+    /**
+     * Writes the queued ratings in the background without waiting for the flush delay
+     * (used when navigating away from an image).  Nothing is written until the retry
+     * delay has passed after a failed write.
+     */
+    void Flush();
+
+    /**
+     * Writes the queued ratings on the calling thread, including those of a write job
+     * which hasn't finished (the job is cancelled and its unwritten ratings are taken
+     * back).  Used when the ratings must be in the database before continuing, for
+     * instance at exit or before claiming the next unrated study.  A RatingsWrittenEvent
+     * is invoked if any rating was written, even if writing then failed.
+     * @throws runtime_error
+     */
+    void FlushNow();
+
+    /**
+     * Sets the scheduler used to write ratings
+     */
+    void SetScheduler( JobScheduler *scheduler );
+
+    //@{
+    /**
+     * The number of seconds without a rating change before ratings are written
+     */
+    vtkSetMacro( FlushDelay, double );
+    vtkGetMacro( FlushDelay, double );
+    //@}
+
+    //@{
+    /**
+     * The maximum number of seconds to wait before retrying a failed write
+     */
+    vtkSetMacro( MaximumRetryDelay, double );
+    vtkGetMacro( MaximumRetryDelay, double );
+    //@}
+
+    //@{
+    /**
+     * The number of ratings queued and the number of ratings written
+     */
+    vtkGetMacro( NumberOfRatingsQueued, unsigned long );
+    vtkGetMacro( NumberOfRatingsWritten, unsigned long );
+    //@}
+
+  protected:
+    RatingWriter();
+    ~RatingWriter();
+
+    class Command : public vtkCommand
+    {
+    public:
+      static Command *New() { return new Command; }
+      void Execute( vtkObject *caller, unsigned long eventId, void *callData );
+      RatingWriter *writer;
+
+    protected:
+      Command() { this->writer = NULL; }
+    };
+
+    /**
+     * Collects a finished write job, scheduling a retry if it failed, and invokes a
+     * RatingsWrittenEvent if it wrote any ratings
+     */
+    void FinishWrite( Job *job );
+
+    /**
+     * Queues the ratings of a write job which were not written again (unless they have
+     * been changed since) and returns how many there were
+     */
+    int Requeue( RatingWriteJob *writeJob );
+
+    typedef std::pair< int, int > Key; // user id, image id
+    std::map< Key, int > PendingRatings;
+    double LastChangeTime;
+    double FlushDelay;
+    double RetryDelay;
+    double MaximumRetryDelay;
+    double NextRetryTime;
+    unsigned long NumberOfRatingsQueued;
+    unsigned long NumberOfRatingsWritten;
+
+    JobScheduler *Scheduler;
+    vtkSmartPointer< Command > Observer;
+    vtkSmartPointer< RatingWriteJob > WriteJob;
+
+  private:
+    RatingWriter( const RatingWriter& ); // Not implemented
+    void operator=( const RatingWriter& ); // Not implemented
+  };
+}
+
+/** @} end of doxygen group */
+
+#endif
@@ -0,0 +1,165 @@
+/*=========================================================================
+
+  Program:  Birch (CLSA Retinal Image Viewer)
+  Module:   ReviewQueue.cxx
+  Language: C++
+
+  Author: Patrick Emond <emondpd@mcmaster.ca>
+  Author: Dean Inglis <inglisd@mcmaster.ca>
+
+=========================================================================*/
+#include "ReviewQueue.h"
+
+#include "Application.h"
+#include "Database.h"
+#include "Utilities.h"
+
+#include "vtkBirchMySQLQuery.h"
+#include "vtkObjectFactory.h"
+#include "vtkSmartPointer.h"
+
+#include <sstream>
+#include <stdexcept>
+
+namespace Birch
+{
+  vtkStandardNewMacro( ReviewQueue );
+
+  //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+  ReviewQueue::ReviewQueue()
+  {
+    this->RatingsPerImage = 1;
+  }
+
+  //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+  std::string ReviewQueue::GetPolicyName( int policy )
+  {
+    if( ReviewQueue::UIDPolicy == policy ) return "uid";
+    else if( ReviewQueue::AcquisitionPolicy == policy ) return "acquisition";
+    else if( ReviewQueue::SiteBacklogPolicy == policy ) return "site-backlog";
+    else if( ReviewQueue::AdditionalRatingPolicy == policy ) return "additional-rating";
+
+    std::stringstream error;
+    error << "Tried to get name of invalid review policy " << policy;
+    throw std::runtime_error( error.str() );
+  }
+
+  //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+  int ReviewQueue::GetPolicy( const std::string &name )
+  {
+    for( int policy = 0; policy < ReviewQueue::NumberOfPolicies; ++policy )
+      if( name == ReviewQueue::GetPolicyName( policy ) ) return policy;
+    return -1;
+  }
+
+  //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+  void ReviewQueue::Prioritize( int policy )
+  {
+    vtkSmartPointer<vtkBirchMySQLQuery> query = Application::GetInstance()->GetDB()->GetQuery();
+    std::string rankStatement = this->GetRankStatement( policy );
+
+    if( !query->BeginTransaction() )
+      throw std::runtime_error( "Unable to start transaction while ranking studies" );
+
+    try
+    {
+      this->Run( query, rankStatement );
+
+      // the queue only ever has one policy, kept in the table's first row
+      std::stringstream stream;
+      stream << "INSERT INTO ReviewQueue ( id, policy, create_timestamp ) "
+             << "VALUES ( 1, " << query->EscapeString( ReviewQueue::GetPolicyName( policy ) ) << ", NULL ) "
+             << "ON DUPLICATE KEY UPDATE policy = VALUES( policy )";
+      this->Run( query, stream.str() );
+    }
+    catch( std::exception &e )
+    {
+      query->RollbackTransaction();
+      throw;
+    }
+
+    if( !query->CommitTransaction() )
+      throw std::runtime_error( "Unable to commit transaction while ranking studies" );
+  }
+
+  //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+  int ReviewQueue::GetCurrentPolicy()
+  {
+    vtkSmartPointer<vtkBirchMySQLQuery> query = Application::GetInstance()->GetDB()->GetQuery();
+    this->Run( query, "SELECT policy FROM ReviewQueue WHERE id = 1" );
+    return query->NextRow() ? ReviewQueue::GetPolicy( query->DataValue( 0 ).ToString() ) : -1;
+  }
+
+  //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+  std::string ReviewQueue::GetRankStatement( int policy )
+  {
+    // the number of ratings of each image which has been rated
+    std::stringstream counts;
+    counts << "SELECT image_id, COUNT(*) AS total FROM Rating "
+           << "WHERE rating IS NOT NULL "
+           << "GROUP BY image_id";
+
+    std::stringstream stream;
+    if( ReviewQueue::UIDPolicy == policy )
+    {
+      stream << "UPDATE Study SET queue_rank = 0";
+    }
+    else if( ReviewQueue::AcquisitionPolicy == policy )
+    {
+      stream << "UPDATE Study SET queue_rank = TO_DAYS( datetime_acquired )";
+    }
+    else if( ReviewQueue::SiteBacklogPolicy == policy )
+    {
+      // the backlog of a site is the number of its studies with an image needing ratings
+      stream << "UPDATE Study "
+             << "LEFT JOIN ( "
+             <<   "SELECT site, COUNT( DISTINCT Pending.id ) AS backlog "
+             <<   "FROM Study AS Pending "
+             <<   "JOIN Image ON Image.study_id = Pending.id "
+             <<   "LEFT JOIN ( " << counts.str() << " ) AS Counts ON Counts.image_id = Image.id "
+             <<   "WHERE IFNULL( Counts.total, 0 ) < " << this->RatingsPerImage << " "
+             <<   "GROUP BY site "
+             << ") AS Backlog ON Backlog.site = Study.site "
+             << "SET Study.queue_rank = -IFNULL( Backlog.backlog, 0 )";
+    }
+    else if( ReviewQueue::AdditionalRatingPolicy == policy )
+    {
+      // studies with images which have been rated but need more ratings come first,
+      // followed by studies with unrated images and then the finished studies
+      stream << "UPDATE Study "
+             << "LEFT JOIN ( "
+             <<   "SELECT Image.study_id, "
+             <<     "MAX( IFNULL( Counts.total, 0 ) BETWEEN 1 AND " << this->RatingsPerImage - 1 << " ) "
+             <<       "AS partial, "
+             <<     "MAX( Counts.total IS NULL ) AS unrated "
+             <<   "FROM Image "
+             <<   "LEFT JOIN ( " << counts.str() << " ) AS Counts ON Counts.image_id = Image.id "
+             <<   "GROUP BY Image.study_id "
+             << ") AS Progress ON Progress.study_id = Study.id "
+             << "SET Study.queue_rank = CASE "
+             <<   "WHEN Progress.partial THEN 0 "
+             <<   "WHEN Progress.unrated THEN 1 "
+             <<   "ELSE 2 END";
+    }
+    else
+    {
+      std::stringstream error;
+      error << "Tried to rank studies using invalid review policy " << policy;
+      throw std::runtime_error( error.str() );
+    }
+
+    return stream.str();
+  }
+
+  //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+  void ReviewQueue::Run( vtkBirchMySQLQuery *query, const std::string &sql )
+  {
+    query->SetQuery( sql.c_str() );
+    if( !query->Execute() )
+    {
+      std::stringstream error;
+      error << "Unable to rank studies: " << query->GetLastErrorText();
+      throw std::runtime_error( error.str() );
+    }
+  }
+}
@@ -0,0 +1,129 @@
+/*=========================================================================
+
+  Program:  Birch (CLSA Retinal Image Viewer)
+  Module:   ReviewQueue.h
+  Language: C++
+
+  Author: Patrick Emond <emondpd@mcmaster.ca>
+  Author: Dean Inglis <inglisd@mcmaster.ca>
+
+=========================================================================*/
+
+/**
+ * @class ReviewQueue
+ * @namespace Birch
+ *
+ * @author Patrick Emond <emondpd@mcmaster.ca>
+ * @author Dean Inglis <inglisd@mcmaster.ca>
+ *
+ * @brief The order in which studies are reviewed
+ *
+ * Studies are reviewed in order of the Study table's queue_rank column (lowest
+ * first) and then by uid.  Both columns are covered by a single index, so the study
+ * following any other (see Study::GetNext()) is found by a single index lookup, and
+ * the next study to lease to a rater (see StudyLease::Claim()) by walking the index
+ * from the rater's current study (wrapping around to the start of the queue) until a
+ * study the rater may be handed is reached, instead of reading and sorting the whole
+ * list.
+ *
+ * A policy ranks every study using a single UPDATE statement run by the database
+ * server, which is the only way ranks are changed (see Prioritize()).  The policy is
+ * recorded in the ReviewQueue table so that studies added later can be ranked by the
+ * same policy (see GetCurrentPolicy()).  Subclasses may add policies by extending
+ * GetRankStatement().
+ */
+
+#ifndef __ReviewQueue_h
+#define __ReviewQueue_h
+
+#include "ModelObject.h"
+
+#include <iostream>
+
+class vtkBirchMySQLQuery;
+
+/**
+ * @addtogroup Birch
+ * @{
+ */
+
+namespace Birch
+{
+  class ReviewQueue : public ModelObject
+  {
+  public:
+    static ReviewQueue *New();
+    vtkTypeMacro( ReviewQueue, ModelObject );
+
+    /** The orders studies may be reviewed in */
+    enum Policy
+    {
+      UIDPolicy = 0,
+      AcquisitionPolicy, // oldest acquisition first
+      SiteBacklogPolicy, // sites with the most studies left to rate first
+      AdditionalRatingPolicy, // studies with images needing another rating first
+      NumberOfPolicies
+    };
+
+    /**
+     * Returns the name of a policy as used by the configuration ("uid", "acquisition",
+     * "site-backlog" or "additional-rating")
+     * @throws runtime_error
+     */
+    static std::string GetPolicyName( int policy );
+
+    /**
+     * Returns the policy with the given name, or -1 if there is none
+     */
+    static int GetPolicy( const std::string &name );
+
+    //@{
+    /**
+     * The number of ratings each image should get, used by the policies which rank
+     * studies by the ratings they still need
+     */
+    vtkSetMacro( RatingsPerImage, int );
+    vtkGetMacro( RatingsPerImage, int );
+    //@}
+
+    /**
+     * Ranks all studies according to a policy using a single statement and records
+     * the policy as the queue's current policy
+     * @throws runtime_error
+     */
+    void Prioritize( int policy );
+
+    /**
+     * Returns the policy the studies were last ranked by, or -1 if they have never
+     * been ranked
+     * @throws runtime_error
+     */
+    int GetCurrentPolicy();
+
+  protected:
+    ReviewQueue();
+    ~ReviewQueue() {}
+
+    /**
+     * Returns the UPDATE statement ranking the studies by a policy
+     * @throws runtime_error
+     */
+    virtual std::string GetRankStatement( int policy );
+
+    /**
+     * Runs a statement
+     * @throws runtime_error
+     */
+    void Run( vtkBirchMySQLQuery *query, const std::string &sql );
+
+    int RatingsPerImage;
+
+  private:
+    ReviewQueue( const ReviewQueue& ); // Not implemented
+    void operator=( const ReviewQueue& ); // Not implemented
+  };
+}
+
+/** @} end of doxygen group */
+
+#endif
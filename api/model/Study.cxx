@@ -12,14 +12,13 @@
 
 #include "Application.h"
 #include "Image.h"
-//#include "OpalService.h"
 #include "Utilities.h"
 
-#include "vtkCommand.h"
 #include "vtkObjectFactory.h"
 #include "vtkSmartPointer.h"
 
 #include <map>
+#include <sstream>
 #include <stdexcept>
 
 namespace Birch
@@ -27,173 +26,87 @@ namespace Birch
   vtkStandardNewMacro( Study );
 
   //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
-  /*
-  void Study::UpdateData()
+  vtkSmartPointer<Study> Study::GetNext()
   {
-    Application *app = Application::GetInstance();
-    OpalService *opal = app->GetOpal();
-
-    double progress = 0.0;
-    app->InvokeEvent( vtkCommand::ProgressEvent, static_cast<void *>( &progress ) );
-
-    // count the number of identifiers
-    std::vector< std::string > identifierList = opal->GetIdentifiers( "clsa-dcs-images", "CarotidIntima" );
-    std::map< std::string, std::string > userList;
-    std::map< std::string, std::string > datetimeList;
-    std::map< std::string, std::string > map;
-
-    bool done = false;
-    int limit = 100;
-    int index = 0;
-    
-    while( userList.size() < identifierList.size() )
-    {
-      // get users
-      map = opal->GetValueList( "clsa-dcs", "CarotidIntima", "InstrumentRun.user", index, limit );
-      userList.insert( map.begin(), map.end() );
-
-      // get datetimes
-      map = opal->GetValueList( "clsa-dcs", "CarotidIntima", "InstrumentRun.timeStart", index, limit );
-      datetimeList.insert( map.begin(), map.end() );
-      if( 0 == map.size() ) done = true;
-
-      index += map.size();
-
-      progress = (double)userList.size() / identifierList.size() * 0.5;
-      app->InvokeEvent( vtkCommand::ProgressEvent, static_cast<void *>( &progress ) );
-    }
-
-    // now create the records
-    index = 0;
-    std::vector< std::string >::iterator identifier;
-    std::map< std::string, std::string >::iterator value;
-    
-    progress = 0.5;
-    app->InvokeEvent( vtkCommand::ProgressEvent, static_cast<void *>( &progress ) );
-
-    for( identifier = identifierList.begin(); identifier != identifierList.end(); ++identifier )
-    {
-      vtkSmartPointer< Study > study = vtkSmartPointer< Study >::New();
-      study->Load( "uid", *identifier ); // may not result in loading a record
-      study->Set( "uid", *identifier );
-      study->Set( "site", "unknown" ); // TODO: get from Mastodon
-      value = userList.find( *identifier );
-      study->Set( "interviewer", userList.end() != value ? value->second : "unknown" );
-      value = datetimeList.find( *identifier );
-      study->Set( "datetime_acquired", datetimeList.end() != value ? value->second : "unknown" );
-      study->Save();
-      index++;
-
-      if( 0 == index % 100 )
-      {
-        progress = (double)index / identifierList.size() * 0.5 + 0.5;
-        app->InvokeEvent( vtkCommand::ProgressEvent, static_cast<void *>( &progress ) );
-      }
-    }
-
-    progress = 1.0;
-    app->InvokeEvent( vtkCommand::ProgressEvent, static_cast<void *>( &progress ) );
+    return this->GetAdjacent( true );
   }
-  */
 
   //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
-  /*
-  std::vector< std::string > Study::GetIdentifierList()
+  void Study::Next()
   {
-    return Application::GetInstance()->GetOpal()->GetIdentifiers( "clsa-dcs-images", "CarotidIntima" );
+    this->Load( "id", this->GetNext()->Get( "id" ).ToString() );
   }
-  */
 
   //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
-  vtkSmartPointer<Study> Study::GetNext()
+  vtkSmartPointer<Study> Study::GetPrevious()
   {
-    std::string currentUid = this->Get( "uid" ).ToString();
-    std::vector< std::string > list = Study::GetUIDList();
-    std::vector< std::string >::reverse_iterator it;
-
-    // the list should never be empty (since we are already an instance of study)
-    if( list.empty() ) throw std::runtime_error( "Study list is empty while trying to get next study." );
-    
-    // find this record's uid in the list, return the next one
-    std::string uid;
-    for( it = list.rbegin(); it != list.rend(); it++ )
-    {
-      if( currentUid == *it )
-      {
-        if( list.rbegin() == it )
-        { // first uid matches, get the last uid
-          uid = list.front();
-        }
-        else
-        { // move the iterator to the previous address, get it's value
-          it--;
-          uid = *it;
-        }
-        break;
-      }
-    }
-
-    if( uid.empty() ) throw std::runtime_error( "Study list does not include current UID." );
-
-    vtkSmartPointer<Study> study = vtkSmartPointer<Study>::New();
-    study->Load( "uid", uid );
-    return study;
+    return this->GetAdjacent( false );
   }
 
   //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
-  void Study::Next()
+  void Study::Previous()
   {
-    this->Load( "id", this->GetNext()->Get( "id" ).ToString() );
+    this->Load( "id", this->GetPrevious()->Get( "id" ).ToString() );
   }
 
   //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
-  vtkSmartPointer<Study> Study::GetPrevious()
+  vtkSmartPointer<Study> Study::GetAdjacent( bool next )
   {
-    std::string currentUid = this->Get( "uid" ).ToString();
-    std::vector< std::string > list = Study::GetUIDList();
-    std::vector< std::string >::iterator it;
-
-    // the list should never be empty (since we are already an instance of study)
-    if( list.empty() ) throw std::runtime_error( "Study list is empty while trying to get next study." );
-    
-    // find this record's uid in the list, return the next one
-    std::string uid;
-    for( it = list.begin(); it != list.end(); it++ )
+    this->AssertPrimaryId();
+
+    Application *app = Application::GetInstance();
+    vtkSmartPointer<vtkBirchMySQLQuery> query = app->GetDB()->GetQuery();
+    std::string uid = query->EscapeString( this->Get( "uid" ).ToString() );
+
+    // the rank may have changed since the record was loaded
+    std::stringstream stream;
+    stream << "SELECT queue_rank FROM Study WHERE id = " << this->Get( "id" ).ToInt();
+    query->SetQuery( stream.str().c_str() );
+    if( !query->Execute() || !query->NextRow() )
+      throw std::runtime_error( "Study list does not include current study." );
+    int rank = query->DataValue( 0 ).ToInt();
+
+    // both lookups are a single seek of the (queue_rank, uid) index
+    std::string order = next ? "ORDER BY queue_rank, uid " : "ORDER BY queue_rank DESC, uid DESC ";
+    stream.str( "" );
+    stream << "SELECT id FROM Study "
+           << "WHERE queue_rank " << ( next ? ">" : "<" ) << " " << rank << " "
+           << "OR ( queue_rank = " << rank << " AND uid " << ( next ? ">" : "<" ) << " " << uid << " ) "
+           << order << "LIMIT 1";
+    query->SetQuery( stream.str().c_str() );
+    if( !query->Execute() )
+    {
+      std::stringstream error;
+      error << "Unable to get adjacent study: " << query->GetLastErrorText();
+      throw std::runtime_error( error.str() );
+    }
+    if( !query->NextRow() )
     {
-      if( currentUid == *it )
+      // wrap around to the other end of the queue
+      stream.str( "" );
+      stream << "SELECT id FROM Study " << order << "LIMIT 1";
+      query->SetQuery( stream.str().c_str() );
+      if( !query->Execute() )
       {
-        if( list.begin() == it )
-        { // first uid matches, get the last uid
-          uid = list.back();
-        }
-        else
-        { // move the iterator to the previous address, get it's value
-          it--;
-          uid = *it;
-        }
-        break;
+        std::stringstream error;
+        error << "Unable to get adjacent study: " << query->GetLastErrorText();
+        throw std::runtime_error( error.str() );
       }
+      if( !query->NextRow() )
+        throw std::runtime_error( "Study list is empty while trying to get adjacent study." );
     }
 
-    if( uid.empty() ) throw std::runtime_error( "Study list does not include current UID." );
-
     vtkSmartPointer<Study> study = vtkSmartPointer<Study>::New();
-    study->Load( "uid", uid );
+    study->Load( "id", query->DataValue( 0 ).ToString() );
     return study;
   }
 
-  //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
-  void Study::Previous()
-  {
-    this->Load( "id", this->GetPrevious()->Get( "id" ).ToString() );
-  }
-
   //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
   std::vector< std::string > Study::GetUIDList()
   {
     Application *app = Application::GetInstance();
     vtkSmartPointer<vtkBirchMySQLQuery> query = app->GetDB()->GetQuery();
-    query->SetQuery( "SELECT uid FROM Study ORDER BY uid" );
+    query->SetQuery( "SELECT uid FROM Study ORDER BY queue_rank, uid" );
     query->Execute();
 
     std::vector< std::string > list;
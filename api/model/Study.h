@@ -39,32 +39,34 @@ namespace Birch
   public:
     static Study *New();
     vtkTypeMacro( Study, ActiveRecord );
-//    static void UpdateData();
-//    static std::vector< std::string > GetIdentifierList();
     std::string GetName() { return "Study"; }
 
     /**
-     * Returns the next study in UID order.
+     * Returns the next study in review queue order (see ReviewQueue), wrapping around
+     * to the first study
+     * @throws runtime_error
      */
     vtkSmartPointer<Study> GetNext();
 
     /**
-     * Makes the current record the next record in UID order.
+     * Makes the current record the next record in review queue order.
      */
     void Next();
 
     /**
-     * Returns the previous study in UID order.
+     * Returns the previous study in review queue order, wrapping around to the last
+     * study
+     * @throws runtime_error
      */
     vtkSmartPointer<Study> GetPrevious();
 
     /**
-     * Makes the current record the previous record in UID order.
+     * Makes the current record the previous record in review queue order.
      */
     void Previous();
 
     /**
-     * Returns a vector of all UIDs alphabetically ordered
+     * Returns a vector of all UIDs in review queue order
      */
     static std::vector< std::string > GetUIDList();
 
@@ -78,6 +80,12 @@ namespace Birch
     Study() {}
     ~Study() {}
 
+    /**
+     * Returns the next or previous study in review queue order
+     * @throws runtime_error
+     */
+    vtkSmartPointer<Study> GetAdjacent( bool next );
+
   private:
     Study( const Study& ); // Not implemented
     void operator=( const Study& ); // Not implemented
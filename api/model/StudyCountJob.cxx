@@ -0,0 +1,54 @@
+/*=========================================================================
+
+  Program:  Birch (CLSA Retinal Image Viewer)
+  Module:   StudyCountJob.cxx
+  Language: C++
+
+  Author: Patrick Emond <emondpd@mcmaster.ca>
+  Author: Dean Inglis <inglisd@mcmaster.ca>
+
+=========================================================================*/
+
+#include "StudyCountJob.h"
+
+#include "vtkMutexLock.h"
+#include "vtkObjectFactory.h"
+
+namespace Birch
+{
+  vtkStandardNewMacro( StudyCountJob );
+
+  //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+  StudyCountJob::StudyCountJob()
+  {
+    this->Query = vtkSmartPointer< StudyQuery >::New();
+    this->Count = 0;
+  }
+
+  //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+  void StudyCountJob::Cancel()
+  {
+    this->Superclass::Cancel();
+    this->Query->Cancel();
+  }
+
+  //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+  int StudyCountJob::GetCount()
+  {
+    this->Lock->Lock();
+    int count = this->Count;
+    this->Lock->Unlock();
+    return count;
+  }
+
+  //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+  void StudyCountJob::Execute()
+  {
+    int count = this->Query->GetCount();
+
+    this->Lock->Lock();
+    this->Count = count;
+    this->Lock->Unlock();
+    this->UpdateProgress( 1.0 );
+  }
+}
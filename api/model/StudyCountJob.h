@@ -0,0 +1,86 @@
+/*=========================================================================
+
+  Program:  Birch (CLSA Retinal Image Viewer)
+  Module:   StudyCountJob.h
+  Language: C++
+
+  Author: Patrick Emond <emondpd@mcmaster.ca>
+  Author: Dean Inglis <inglisd@mcmaster.ca>
+
+=========================================================================*/
+
+/**
+ * @class StudyCountJob
+ * @namespace Birch
+ *
+ * @author Patrick Emond <emondpd@mcmaster.ca>
+ * @author Dean Inglis <inglisd@mcmaster.ca>
+ *
+ * @brief Job which counts the studies in a study list
+ *
+ * Used by the study browser to count the studies matching a search without
+ * blocking the GUI thread.  The job works on its own copy of the query and
+ * cancelling the job interrupts its query.  The count may be read once the scheduler
+ * has posted the job's JobFinishedEvent.
+ */
+
+#ifndef __StudyCountJob_h
+#define __StudyCountJob_h
+
+#include "Job.h"
+
+#include "StudyQuery.h"
+
+#include "vtkSmartPointer.h"
+
+#include <iostream>
+
+/**
+ * @addtogroup Birch
+ * @{
+ */
+
+namespace Birch
+{
+  class StudyCountJob : public Job
+  {
+  public:
+    static StudyCountJob *New();
+    vtkTypeMacro( StudyCountJob, Job );
+
+    std::string GetDescription() { return "Study count"; }
+
+    /**
+     * Extends the parent method to also interrupt the job's query
+     */
+    void Cancel();
+
+    /**
+     * Sets the query to count the studies of, the query is copied so it may be
+     * changed afterwards.  This must be done before the job is submitted.
+     */
+    void SetQuery( StudyQuery *query ) { this->Query->DeepCopy( query ); }
+
+    /**
+     * Returns the number of studies counted (only valid once the job has finished)
+     */
+    int GetCount();
+
+  protected:
+    StudyCountJob();
+    ~StudyCountJob() {}
+
+    void Execute();
+
+    vtkSmartPointer< StudyQuery > Query;
+    int Count;
+
+  private:
+    StudyCountJob( const StudyCountJob& ); // Not implemented
+    void operator=( const StudyCountJob& ); // Not implemented
+  };
+}
+
+/** @} end of doxygen group */
+
+#endif
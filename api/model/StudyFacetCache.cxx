@@ -0,0 +1,135 @@
+/*=========================================================================
+
+  Program:  Birch (CLSA Retinal Image Viewer)
+  Module:   StudyFacetCache.cxx
+  Language: C++
+
+  Author: Patrick Emond <emondpd@mcmaster.ca>
+  Author: Dean Inglis <inglisd@mcmaster.ca>
+
+=========================================================================*/
+
+#include "StudyFacetCache.h"
+
+#include "JobScheduler.h"
+#include "RatingWriter.h"
+#include "StudySyncJob.h"
+
+#include "vtkObjectFactory.h"
+#include "vtkTimerLog.h"
+
+namespace Birch
+{
+  vtkStandardNewMacro( StudyFacetCache );
+
+  //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+  StudyFacetCache::StudyFacetCache()
+  {
+    this->Expiry = 300.0;
+    this->MaximumNumberOfEntries = 100;
+    this->Scheduler = NULL;
+    this->Writer = NULL;
+    this->Observer = vtkSmartPointer< Command >::New();
+    this->Observer->cache = this;
+  }
+
+  //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+  StudyFacetCache::~StudyFacetCache()
+  {
+    this->SetScheduler( NULL );
+    this->SetRatingWriter( NULL );
+  }
+
+  //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+  void StudyFacetCache::SetScheduler( JobScheduler *scheduler )
+  {
+    if( scheduler == this->Scheduler ) return;
+
+    if( this->Scheduler ) this->Scheduler->RemoveObserver( this->Observer );
+    this->Scheduler = scheduler;
+    if( this->Scheduler )
+      this->Scheduler->AddObserver( JobScheduler::JobDataEvent, this->Observer );
+  }
+
+  //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+  void StudyFacetCache::SetRatingWriter( RatingWriter *writer )
+  {
+    if( writer == this->Writer ) return;
+
+    if( this->Writer ) this->Writer->RemoveObserver( this->Observer );
+    this->Writer = writer;
+    if( this->Writer )
+      this->Writer->AddObserver( RatingWriter::RatingsWrittenEvent, this->Observer );
+  }
+
+  //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+  bool StudyFacetCache::GetCounts( StudyQuery *query, int facet, StudyQuery::FacetCounts &counts )
+  {
+    std::map< std::string, Entry >::iterator it = this->Entries.find( query->GetFacetKey( facet ) );
+    if( this->Entries.end() == it ) return false;
+
+    if( vtkTimerLog::GetUniversalTime() - it->second.Time > this->Expiry )
+    {
+      this->Entries.erase( it );
+      return false;
+    }
+
+    counts = it->second.Counts;
+    return true;
+  }
+
+  //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+  void StudyFacetCache::SetCounts(
+    StudyQuery *query, int facet, const StudyQuery::FacetCounts &counts )
+  {
+    Entry entry;
+    entry.Counts = counts;
+    entry.DependsOnRatings = query->FacetDependsOnRatings( facet );
+    entry.Time = vtkTimerLog::GetUniversalTime();
+    this->Entries[query->GetFacetKey( facet )] = entry;
+
+    while( (int) this->Entries.size() > this->MaximumNumberOfEntries )
+    {
+      std::map< std::string, Entry >::iterator oldest = this->Entries.begin();
+      std::map< std::string, Entry >::iterator it;
+      for( it = this->Entries.begin(); it != this->Entries.end(); ++it )
+        if( it->second.Time < oldest->second.Time ) oldest = it;
+      this->Entries.erase( oldest );
+    }
+  }
+
+  //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+  void StudyFacetCache::Clear()
+  {
+    this->Entries.clear();
+  }
+
+  //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+  void StudyFacetCache::ClearRatings()
+  {
+    std::map< std::string, Entry >::iterator it = this->Entries.begin();
+    while( it != this->Entries.end() )
+    {
+      if( it->second.DependsOnRatings ) this->Entries.erase( it++ );
+      else ++it;
+    }
+  }
+
+  //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+  void StudyFacetCache::ProcessJobEvent( Job *job, unsigned long event )
+  {
+    // studies are only added or changed while the study database is being updated
+    if( JobScheduler::JobDataEvent == event && StudySyncJob::SafeDownCast( job ) )
+      this->Clear();
+  }
+
+  //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+  void StudyFacetCache::Command::Execute(
+    vtkObject *caller, unsigned long eventId, void *callData )
+  {
+    if( !this->cache ) return;
+
+    if( RatingWriter::RatingsWrittenEvent == eventId ) this->cache->ClearRatings();
+    else this->cache->ProcessJobEvent( static_cast<Job*>( callData ), eventId );
+  }
+}
@@ -0,0 +1,149 @@
+/*=========================================================================
+
+  Program:  Birch (CLSA Retinal Image Viewer)
+  Module:   StudyFacetCache.h
+  Language: C++
+
+  Author: Patrick Emond <emondpd@mcmaster.ca>
+  Author: Dean Inglis <inglisd@mcmaster.ca>
+
+=========================================================================*/
+
+/**
+ * @class StudyFacetCache
+ * @namespace Birch
+ *
+ * @author Patrick Emond <emondpd@mcmaster.ca>
+ * @author Dean Inglis <inglisd@mcmaster.ca>
+ *
+ * @brief Cache of the facet counts of study lists
+ *
+ * A single instance of this class is created and managed by the Application
+ * singleton.  Counts are indexed by StudyQuery::GetFacetKey() so that changing one
+ * restriction of a study list only requires the other facets to be counted again.
+ *
+ * Counts are invalidated when the study database is updated (a StudySyncJob posts
+ * data), counts which depend on ratings are invalidated whenever the RatingWriter
+ * reports that ratings have been written and all counts expire after a while so that
+ * changes made by other users eventually show.  This class must only be used from
+ * the GUI thread.
+ */
+
+#ifndef __StudyFacetCache_h
+#define __StudyFacetCache_h
+
+#include "ModelObject.h"
+
+#include "StudyQuery.h"
+
+#include "vtkCommand.h"
+#include "vtkSmartPointer.h"
+
+#include <iostream>
+#include <map>
+
+/**
+ * @addtogroup Birch
+ * @{
+ */
+
+namespace Birch
+{
+  class Job;
+  class JobScheduler;
+  class RatingWriter;
+  class StudyFacetCache : public ModelObject
+  {
+  public:
+    static StudyFacetCache *New();
+    vtkTypeMacro( StudyFacetCache, ModelObject );
+
+    /**
+     * Gets the cached counts of a query's facet, returns false if they aren't cached
+     */
+    bool GetCounts( StudyQuery *query, int facet, StudyQuery::FacetCounts &counts );
+
+    /**
+     * Adds (or replaces) the counts of a query's facet
+     */
+    void SetCounts( StudyQuery *query, int facet, const StudyQuery::FacetCounts &counts );
+
+    /**
+     * Removes all counts from the cache
+     */
+    void Clear();
+
+    /**
+     * Removes the counts which depend on ratings from the cache
+     */
+    void ClearRatings();
+
+    /**
+     * Sets the scheduler whose jobs invalidate the cache
+     */
+    void SetScheduler( JobScheduler *scheduler );
+
+    /**
+     * Sets the rating writer whose writes invalidate the counts depending on ratings
+     */
+    void SetRatingWriter( RatingWriter *writer );
+
+    //@{
+    /**
+     * The number of seconds counts are cached for
+     */
+    vtkSetMacro( Expiry, double );
+    vtkGetMacro( Expiry, double );
+    //@}
+
+    //@{
+    /**
+     * The maximum number of counts to cache (the oldest are removed first)
+     */
+    vtkSetMacro( MaximumNumberOfEntries, int );
+    vtkGetMacro( MaximumNumberOfEntries, int );
+    //@}
+
+  protected:
+    StudyFacetCache();
+    ~StudyFacetCache();
+
+    class Command : public vtkCommand
+    {
+    public:
+      static Command *New() { return new Command; }
+      void Execute( vtkObject *caller, unsigned long eventId, void *callData );
+      StudyFacetCache *cache;
+
+    protected:
+      Command() { this->cache = NULL; }
+    };
+
+    /**
+     * Invalidates counts changed by a job
+     */
+    void ProcessJobEvent( Job *job, unsigned long event );
+
+    struct Entry
+    {
+      StudyQuery::FacetCounts Counts;
+      bool DependsOnRatings;
+      double Time;
+    };
+    std::map< std::string, Entry > Entries;
+    double Expiry;
+    int MaximumNumberOfEntries;
+
+    JobScheduler *Scheduler;
+    RatingWriter *Writer;
+    vtkSmartPointer< Command > Observer;
+
+  private:
+    StudyFacetCache( const StudyFacetCache& ); // Not implemented
+    void operator=( const StudyFacetCache& ); // Not implemented
+  };
+}
+
+/** @} end of doxygen group */
+
+#endif
@@ -0,0 +1,63 @@
+/*=========================================================================
+
+  Program:  Birch (CLSA Retinal Image Viewer)
+  Module:   StudyFacetJob.cxx
+  Language: C++
+
+  Author: Patrick Emond <emondpd@mcmaster.ca>
+  Author: Dean Inglis <inglisd@mcmaster.ca>
+
+=========================================================================*/
+
+#include "StudyFacetJob.h"
+
+#include "vtkMutexLock.h"
+#include "vtkObjectFactory.h"
+
+namespace Birch
+{
+  vtkStandardNewMacro( StudyFacetJob );
+
+  //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+  StudyFacetJob::StudyFacetJob()
+  {
+    this->Query = vtkSmartPointer< StudyQuery >::New();
+  }
+
+  //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+  void StudyFacetJob::Cancel()
+  {
+    this->Superclass::Cancel();
+    this->Query->Cancel();
+  }
+
+  //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+  bool StudyFacetJob::GetFacetCounts( int facet, StudyQuery::FacetCounts &counts )
+  {
+    this->Lock->Lock();
+    std::map< int, StudyQuery::FacetCounts >::iterator it = this->Counts.find( facet );
+    bool found = this->Counts.end() != it;
+    if( found ) counts = it->second;
+    this->Lock->Unlock();
+    return found;
+  }
+
+  //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+  void StudyFacetJob::Execute()
+  {
+    int size = this->Facets.size();
+    for( int i = 0; i < size && !this->IsCancelled(); ++i )
+    {
+      StudyQuery::FacetCounts counts;
+      this->Query->GetFacetCounts( this->Facets[i], counts );
+
+      // counts of an interrupted query are incomplete
+      if( this->IsCancelled() ) break;
+
+      this->Lock->Lock();
+      this->Counts[this->Facets[i]] = counts;
+      this->Lock->Unlock();
+      this->UpdateProgress( (double)( i + 1 ) / size );
+    }
+  }
+}
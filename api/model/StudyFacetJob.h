@@ -0,0 +1,105 @@
+/*=========================================================================
+
+  Program:  Birch (CLSA Retinal Image Viewer)
+  Module:   StudyFacetJob.h
+  Language: C++
+
+  Author: Patrick Emond <emondpd@mcmaster.ca>
+  Author: Dean Inglis <inglisd@mcmaster.ca>
+
+=========================================================================*/
+
+/**
+ * @class StudyFacetJob
+ * @namespace Birch
+ *
+ * @author Patrick Emond <emondpd@mcmaster.ca>
+ * @author Dean Inglis <inglisd@mcmaster.ca>
+ *
+ * @brief Job which counts the studies of a study list by facet
+ *
+ * Used by the study browser to count the facets which aren't cached (see
+ * StudyFacetCache) without blocking the GUI thread.  The job works on its own copy
+ * of the query and cancelling the job interrupts its query.  Counts may be collected
+ * (on the GUI thread) using GetFacetCounts() once the scheduler has posted the job's
+ * JobFinishedEvent.
+ */
+
+#ifndef __StudyFacetJob_h
+#define __StudyFacetJob_h
+
+#include "Job.h"
+
+#include "StudyQuery.h"
+
+#include "vtkSmartPointer.h"
+
+#include <iostream>
+#include <map>
+#include <vector>
+
+/**
+ * @addtogroup Birch
+ * @{
+ */
+
+namespace Birch
+{
+  class StudyFacetJob : public Job
+  {
+  public:
+    static StudyFacetJob *New();
+    vtkTypeMacro( StudyFacetJob, Job );
+
+    std::string GetDescription() { return "Study facet count"; }
+
+    /**
+     * Extends the parent method to also interrupt the job's query
+     */
+    void Cancel();
+
+    /**
+     * Sets the query to count the facets of, the query is copied so it may be changed
+     * afterwards.  This must be done before the job is submitted.
+     */
+    void SetQuery( StudyQuery *query ) { this->Query->DeepCopy( query ); }
+
+    /**
+     * Returns the job's copy of the query (which the counts belong to)
+     */
+    StudyQuery* GetQuery() { return this->Query; }
+
+    /**
+     * Adds a facet to be counted, this must be done before the job is submitted
+     */
+    void AddFacet( int facet ) { this->Facets.push_back( facet ); }
+
+    /**
+     * Returns the facets to be counted by the job
+     */
+    const std::vector< int >& GetFacets() { return this->Facets; }
+
+    /**
+     * Gets the counts of a facet, returns false if the facet hasn't been counted
+     */
+    bool GetFacetCounts( int facet, StudyQuery::FacetCounts &counts );
+
+  protected:
+    StudyFacetJob();
+    ~StudyFacetJob() {}
+
+    void Execute();
+
+    vtkSmartPointer< StudyQuery > Query;
+    std::vector< int > Facets;
+    std::map< int, StudyQuery::FacetCounts > Counts;
+
+  private:
+    StudyFacetJob( const StudyFacetJob& ); // Not implemented
+    void operator=( const StudyFacetJob& ); // Not implemented
+  };
+}
+
+/** @} end of doxygen group */
+
+#endif
@@ -0,0 +1,258 @@
+/*=========================================================================
+
+  Program:  Birch (CLSA Retinal Image Viewer)
+  Module:   StudyLease.cxx
+  Language: C++
+
+  Author: Patrick Emond <emondpd@mcmaster.ca>
+  Author: Dean Inglis <inglisd@mcmaster.ca>
+
+=========================================================================*/
+#include "StudyLease.h"
+
+#include "Application.h"
+#include "Database.h"
+#include "Study.h"
+#include "User.h"
+#include "Utilities.h"
+
+#include "vtkBirchMySQLQuery.h"
+#include "vtkObjectFactory.h"
+#include "vtkSmartPointer.h"
+
+#include <sstream>
+#include <stdexcept>
+
+namespace Birch
+{
+  vtkStandardNewMacro( StudyLease );
+
+  //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+  vtkSmartPointer<Study> StudyLease::Claim(
+    User *user, Study *after, int duration, int ratingsPerImage )
+  {
+    if( !user ) throw std::runtime_error( "Tried to claim a study for null user" );
+
+    vtkSmartPointer<vtkBirchMySQLQuery> query = Application::GetInstance()->GetDB()->GetQuery();
+    int userId = user->Get( "id" ).ToInt();
+    std::string afterUid;
+    int afterRank = 0;
+
+    // a study which no longer exists is claimed from the start
+    if( after && !StudyLease::GetPosition( query, after, afterRank, afterUid ) ) after = NULL;
+
+    // under read committed the studies which are scanned but not claimed are unlocked
+    // right away instead of staying locked until the claim commits
+    StudyLease::Run( query, "SET TRANSACTION ISOLATION LEVEL READ COMMITTED" );
+    if( !query->BeginTransaction() )
+      throw std::runtime_error( "Unable to start transaction while claiming a study" );
+
+    int studyId = 0;
+    try
+    {
+      // studies after the rater's current study are handed out first, then the queue
+      // wraps around to the studies up to and including the current one
+      if( after )
+      {
+        studyId = StudyLease::Lock( query, userId, ratingsPerImage,
+          StudyLease::GetRange( query, afterRank, afterUid, true ), "" );
+        if( 0 == studyId ) studyId = StudyLease::Lock( query, userId, ratingsPerImage,
+          "", StudyLease::GetRange( query, afterRank, afterUid, false ) );
+      }
+      else studyId = StudyLease::Lock( query, userId, ratingsPerImage, "", "" );
+
+      // a rater only ever holds one lease
+      std::stringstream releaseStream;
+      releaseStream << "DELETE FROM StudyLease WHERE user_id = " << userId;
+      if( 0 != studyId ) releaseStream << " AND study_id != " << studyId;
+      StudyLease::Run( query, releaseStream.str() );
+
+      if( 0 != studyId )
+      {
+        std::stringstream leaseStream;
+        leaseStream << "INSERT INTO StudyLease ( study_id, user_id, expiry, create_timestamp ) "
+                    << "VALUES ( " << studyId << ", " << userId << ", "
+                    << "NOW() + INTERVAL " << duration << " MINUTE, NULL ) "
+                    << "ON DUPLICATE KEY UPDATE "
+                    << "user_id = VALUES( user_id ), expiry = VALUES( expiry )";
+        StudyLease::Run( query, leaseStream.str() );
+      }
+    }
+    catch( std::exception &e )
+    {
+      query->RollbackTransaction();
+      throw;
+    }
+
+    if( !query->CommitTransaction() )
+      throw std::runtime_error( "Unable to commit transaction while claiming a study" );
+
+    vtkSmartPointer<Study> study;
+    if( 0 != studyId )
+    {
+      study = vtkSmartPointer<Study>::New();
+      study->Load( "id", vtkVariant( studyId ).ToString() );
+    }
+    return study;
+  }
+
+  //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+  int StudyLease::Lock(
+    vtkBirchMySQLQuery *query, int userId, int ratingsPerImage,
+    std::string first, const std::string &last )
+  {
+    while( true )
+    {
+      // the (queue_rank, uid) index is walked in order and each study's conditions are
+      // checked as it is reached, so the search stops at the first study it can claim
+      // and only locks that one (studies being claimed by other raters are skipped)
+      std::stringstream stream;
+      stream << "SELECT Study.id, Study.queue_rank, Study.uid "
+             << "FROM Study FORCE INDEX ( dk_queue_rank_uid ) "
+             << "WHERE ";
+      if( !first.empty() ) stream << first << " AND ";
+      if( !last.empty() ) stream << last << " AND ";
+      stream << StudyLease::GetClaimable( userId, ratingsPerImage ) << " "
+             << "ORDER BY Study.queue_rank, Study.uid "
+             << "LIMIT 1 "
+             << "FOR UPDATE OF Study SKIP LOCKED";
+      StudyLease::Run( query, stream.str() );
+      if( !query->NextRow() ) return 0;
+      int studyId = query->DataValue( 0 ).ToInt();
+      int rank = query->DataValue( 1 ).ToInt();
+      std::string uid = query->DataValue( 2 ).ToString();
+
+      // the study is now locked, so a locking read of its lease (which sees the latest
+      // committed lease) can't be raced by another claim
+      std::stringstream leaseStream;
+      leaseStream << "SELECT COUNT(*) FROM StudyLease "
+                  << "WHERE study_id = " << studyId << " "
+                  << "AND user_id != " << userId << " "
+                  << "AND expiry > NOW() "
+                  << "FOR UPDATE";
+      StudyLease::Run( query, leaseStream.str() );
+      if( query->NextRow() && 0 == query->DataValue( 0 ).ToInt() ) return studyId;
+
+      // another rater's claim committed while the search ran, carry on past the study
+      first = StudyLease::GetRange( query, rank, uid, true );
+    }
+  }
+
+  //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+  std::vector< int > StudyLease::Peek( int userId, Study *after, int ratingsPerImage, int count )
+  {
+    std::vector< int > list;
+    if( 0 >= count ) return list;
+
+    vtkSmartPointer<vtkBirchMySQLQuery> query = Application::GetInstance()->GetDB()->GetQuery();
+    std::string afterUid;
+    int afterRank = 0;
+    int afterId = 0;
+    if( after && StudyLease::GetPosition( query, after, afterRank, afterUid ) )
+      afterId = after->Get( "id" ).ToInt();
+
+    // the same ranges are searched in the same order as Claim() but with a plain read,
+    // so nothing is locked and the rater's current study is simply left out
+    std::vector< std::string > rangeList;
+    if( 0 != afterId )
+    {
+      rangeList.push_back( StudyLease::GetRange( query, afterRank, afterUid, true ) );
+      rangeList.push_back( StudyLease::GetRange( query, afterRank, afterUid, false ) );
+    }
+    else rangeList.push_back( "" );
+
+    std::vector< std::string >::iterator range;
+    for( range = rangeList.begin(); range != rangeList.end() && (int) list.size() < count; ++range )
+    {
+      std::stringstream stream;
+      stream << "SELECT Study.id "
+             << "FROM Study FORCE INDEX ( dk_queue_rank_uid ) "
+             << "WHERE ";
+      if( !range->empty() ) stream << *range << " AND ";
+      if( 0 != afterId ) stream << "Study.id != " << afterId << " AND ";
+      stream << StudyLease::GetClaimable( userId, ratingsPerImage ) << " "
+             << "ORDER BY Study.queue_rank, Study.uid "
+             << "LIMIT " << count - list.size();
+      StudyLease::Run( query, stream.str() );
+      while( query->NextRow() ) list.push_back( query->DataValue( 0 ).ToInt() );
+    }
+
+    return list;
+  }
+
+  //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+  bool StudyLease::GetPosition(
+    vtkBirchMySQLQuery *query, Study *study, int &rank, std::string &uid )
+  {
+    // the rank may have changed since the record was loaded (the queue may have been
+    // prioritized since)
+    std::stringstream stream;
+    stream << "SELECT queue_rank, uid FROM Study WHERE id = " << study->Get( "id" ).ToInt();
+    StudyLease::Run( query, stream.str() );
+    if( !query->NextRow() ) return false;
+
+    rank = query->DataValue( 0 ).ToInt();
+    uid = query->DataValue( 1 ).ToString();
+    return true;
+  }
+
+  //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+  std::string StudyLease::GetClaimable( int userId, int ratingsPerImage )
+  {
+    // a study has an image which the user hasn't rated and which needs more ratings,
+    // and isn't leased to another rater
+    std::stringstream stream;
+    stream << "EXISTS ( "
+           <<   "SELECT 1 FROM Image "
+           <<   "WHERE Image.study_id = Study.id "
+           <<   "AND NOT EXISTS ( "
+           <<     "SELECT 1 FROM Rating "
+           <<     "WHERE Rating.image_id = Image.id "
+           <<     "AND Rating.user_id = " << userId << " "
+           <<     "AND Rating.rating IS NOT NULL ) "
+           <<   "AND ( "
+           <<     "SELECT COUNT(*) FROM Rating "
+           <<     "WHERE Rating.image_id = Image.id "
+           <<     "AND Rating.rating IS NOT NULL ) < " << ratingsPerImage << " ) "
+           << "AND NOT EXISTS ( "
+           <<   "SELECT 1 FROM StudyLease "
+           <<   "WHERE StudyLease.study_id = Study.id "
+           <<   "AND StudyLease.user_id != " << userId << " "
+           <<   "AND StudyLease.expiry > NOW() )";
+    return stream.str();
+  }
+
+  //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+  std::string StudyLease::GetRange(
+    vtkBirchMySQLQuery *query, int rank, const std::string &uid, bool after )
+  {
+    std::stringstream stream;
+    stream << "( Study.queue_rank " << ( after ? ">" : "<" ) << " " << rank << " "
+           << "OR ( Study.queue_rank = " << rank << " "
+           << "AND Study.uid " << ( after ? ">" : "<=" ) << " " << query->EscapeString( uid ) << " ) )";
+    return stream.str();
+  }
+
+  //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+  void StudyLease::Release( User *user )
+  {
+    if( !user ) throw std::runtime_error( "Tried to release studies of null user" );
+
+    vtkSmartPointer<vtkBirchMySQLQuery> query = Application::GetInstance()->GetDB()->GetQuery();
+    std::stringstream stream;
+    stream << "DELETE FROM StudyLease WHERE user_id = " << user->Get( "id" ).ToInt();
+    StudyLease::Run( query, stream.str() );
+  }
+
+  //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+  void StudyLease::Run( vtkBirchMySQLQuery *query, const std::string &sql )
+  {
+    query->SetQuery( sql.c_str() );
+    if( !query->Execute() )
+    {
+      std::stringstream error;
+      error << "Unable to update study leases: " << query->GetLastErrorText();
+      throw std::runtime_error( error.str() );
+    }
+  }
+}
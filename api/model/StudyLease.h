@@ -0,0 +1,137 @@
+/*=========================================================================
+
+  Program:  Birch (CLSA Retinal Image Viewer)
+  Module:   StudyLease.h
+  Language: C++
+
+  Author: Patrick Emond <emondpd@mcmaster.ca>
+  Author: Dean Inglis <inglisd@mcmaster.ca>
+
+=========================================================================*/
+
+/**
+ * @class StudyLease
+ * @namespace Birch
+ * 
+ * @author Patrick Emond <emondpd@mcmaster.ca>
+ * @author Dean Inglis <inglisd@mcmaster.ca>
+ * 
+ * @brief An active record for the StudyLease table
+ *
+ * A lease hands a study to a single rater for a limited time so that raters working
+ * at the same time are given different studies.  Claim() finds and leases the next
+ * study in a single read committed transaction: the (queue_rank, uid) index is walked
+ * in order by a SELECT ... LIMIT 1 FOR UPDATE SKIP LOCKED which only locks the study
+ * it returns (so concurrent claims never wait on or pick the same study) and studies
+ * leased by other raters are skipped until their lease expires.  Only studies with an
+ * image which the rater hasn't rated and which has fewer than the target number of
+ * ratings are handed out.  SKIP LOCKED requires MySQL 8.0 or later.
+ */
+
+#ifndef __StudyLease_h
+#define __StudyLease_h
+
+#include "ActiveRecord.h"
+
+#include <iostream>
+#include <vector>
+
+class vtkBirchMySQLQuery;
+
+/**
+ * @addtogroup Birch
+ * @{
+ */
+
+namespace Birch
+{
+  class Study;
+  class User;
+  class StudyLease : public ActiveRecord
+  {
+  public:
+    static StudyLease *New();
+    vtkTypeMacro( StudyLease, ActiveRecord );
+    std::string GetName() { return "StudyLease"; }
+
+    /**
+     * Leases the next study needing the user's ratings to the user, releasing any
+     * study previously leased to them, and returns it (or null if there is none).
+     * Studies after the given study in review queue order (see ReviewQueue), using the
+     * study's current rank in the database, are handed out first and the queue then
+     * wraps around to its start.
+     * @param user User The rater
+     * @param after Study The rater's current study (may be null)
+     * @param duration int The number of minutes before the lease expires
+     * @param ratingsPerImage int The number of ratings each image should get
+     * @throws runtime_error
+     */
+    static vtkSmartPointer<Study> Claim( User *user, Study *after, int duration, int ratingsPerImage );
+
+    /**
+     * Returns the ids of the studies which Claim() would hand to the user next, in
+     * order, without leasing or locking them (so the list is only a prediction).  The
+     * given study itself is left out.  This may be called from any thread.
+     * @param userId int The rater
+     * @param after Study The rater's current study (may be null)
+     * @param ratingsPerImage int The number of ratings each image should get
+     * @param count int The maximum number of studies to return
+     * @throws runtime_error
+     */
+    static std::vector< int > Peek( int userId, Study *after, int ratingsPerImage, int count );
+
+    /**
+     * Releases any study leased to a user
+     * @throws runtime_error
+     */
+    static void Release( User *user );
+
+  protected:
+    StudyLease() {}
+    ~StudyLease() {}
+
+    /**
+     * Locks the first study in review queue order which the user may claim and returns
+     * its id (0 if there is none).  The search is restricted to the studies matching
+     * the given ranges of the queue (see GetRange(), empty for no restriction).
+     * @throws runtime_error
+     */
+    static int Lock( vtkBirchMySQLQuery *query, int userId, int ratingsPerImage,
+      std::string first, const std::string &last );
+
+    /**
+     * Returns a study's current position in review queue order (its rank may have
+     * changed since the record was loaded)
+     * @return false if the study no longer exists
+     * @throws runtime_error
+     */
+    static bool GetPosition( vtkBirchMySQLQuery *query, Study *study, int &rank, std::string &uid );
+
+    /**
+     * Returns the condition matching the studies which a user may claim (leaving out
+     * studies leased to other raters)
+     */
+    static std::string GetClaimable( int userId, int ratingsPerImage );
+
+    /**
+     * Returns the condition matching the studies after (or up to and including) a
+     * position in review queue order
+     */
+    static std::string GetRange(
+      vtkBirchMySQLQuery *query, int rank, const std::string &uid, bool after );
+
+    /**
+     * Runs a statement on the leases
+     * @throws runtime_error
+     */
+    static void Run( vtkBirchMySQLQuery *query, const std::string &sql );
+
+  private:
+    StudyLease( const StudyLease& ); // Not implemented
+    void operator=( const StudyLease& ); // Not implemented
+  };
+}
+
+/** @} end of doxygen group */
+
+#endif
@@ -0,0 +1,56 @@
+/*=========================================================================
+
+  Program:  Birch (CLSA Retinal Image Viewer)
+  Module:   StudyPageJob.cxx
+  Language: C++
+
+  Author: Patrick Emond <emondpd@mcmaster.ca>
+  Author: Dean Inglis <inglisd@mcmaster.ca>
+
+=========================================================================*/
+
+#include "StudyPageJob.h"
+
+#include "vtkMutexLock.h"
+#include "vtkObjectFactory.h"
+
+namespace Birch
+{
+  vtkStandardNewMacro( StudyPageJob );
+
+  //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+  StudyPageJob::StudyPageJob()
+  {
+    this->Query = vtkSmartPointer< StudyQuery >::New();
+    this->Page = 0;
+    this->PageSize = 100;
+  }
+
+  //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+  void StudyPageJob::Cancel()
+  {
+    this->Superclass::Cancel();
+    this->Query->Cancel();
+  }
+
+  //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+  void StudyPageJob::TakeRows( std::vector< StudyQuery::Row > &list )
+  {
+    this->Lock->Lock();
+    list.insert( list.end(), this->Rows.begin(), this->Rows.end() );
+    this->Rows.clear();
+    this->Lock->Unlock();
+  }
+
+  //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+  void StudyPageJob::Execute()
+  {
+    std::vector< StudyQuery::Row > list;
+    this->Query->GetRows( this->Page * this->PageSize, this->PageSize, list );
+
+    this->Lock->Lock();
+    this->Rows.swap( list );
+    this->Lock->Unlock();
+    this->UpdateProgress( 1.0 );
+  }
+}
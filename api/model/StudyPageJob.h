@@ -0,0 +1,101 @@
+/*=========================================================================
+
+  Program:  Birch (CLSA Retinal Image Viewer)
+  Module:   StudyPageJob.h
+  Language: C++
+
+  Author: Patrick Emond <emondpd@mcmaster.ca>
+  Author: Dean Inglis <inglisd@mcmaster.ca>
+
+=========================================================================*/
+
+/**
+ * @class StudyPageJob
+ * @namespace Birch
+ *
+ * @author Patrick Emond <emondpd@mcmaster.ca>
+ * @author Dean Inglis <inglisd@mcmaster.ca>
+ *
+ * @brief Job which reads one page of a study list
+ *
+ * Used by the study browser to read the rows being displayed (and the pages around
+ * them) without blocking the GUI thread.  The job works on its own copy of the
+ * query so that the interface may change its query while the job is running.  Once
+ * the scheduler has posted the job's JobFinishedEvent the rows may be collected (on
+ * the GUI thread) using TakeRows().  Cancelling the job interrupts its query.
+ */
+
+#ifndef __StudyPageJob_h
+#define __StudyPageJob_h
+
+#include "Job.h"
+
+#include "StudyQuery.h"
+
+#include "vtkSmartPointer.h"
+
+#include <iostream>
+#include <vector>
+
+/**
+ * @addtogroup Birch
+ * @{
+ */
+
+namespace Birch
+{
+  class StudyPageJob : public Job
+  {
+  public:
+    static StudyPageJob *New();
+    vtkTypeMacro( StudyPageJob, Job );
+
+    std::string GetDescription() { return "Study page"; }
+
+    /**
+     * Extends the parent method to also interrupt the job's query
+     */
+    void Cancel();
+
+    /**
+     * Sets the query to read a page of, the query is copied so it may be changed
+     * afterwards.  This must be done before the job is submitted.
+     */
+    void SetQuery( StudyQuery *query ) { this->Query->DeepCopy( query ); }
+
+    //@{
+    /**
+     * The page to read and the number of rows in every page
+     */
+    vtkSetMacro( Page, int );
+    vtkGetMacro( Page, int );
+    vtkSetMacro( PageSize, int );
+    vtkGetMacro( PageSize, int );
+    //@}
+
+    /**
+     * Moves the rows which were read into the given list.  This must only be called
+     * once the job has finished.
+     */
+    void TakeRows( std::vector< StudyQuery::Row > &list );
+
+  protected:
+    StudyPageJob();
+    ~StudyPageJob() {}
+
+    void Execute();
+
+    vtkSmartPointer< StudyQuery > Query;
+    int Page;
+    int PageSize;
+    std::vector< StudyQuery::Row > Rows;
+
+  private:
+    StudyPageJob( const StudyPageJob& ); // Not implemented
+    void operator=( const StudyPageJob& ); // Not implemented
+  };
+}
+
+/** @} end of doxygen group */
+
+#endif
@@ -0,0 +1,46 @@
+/*=========================================================================
+
+  Program:  Birch (CLSA Retinal Image Viewer)
+  Module:   StudyPrioritizeJob.cxx
+  Language: C++
+
+  Author: Patrick Emond <emondpd@mcmaster.ca>
+  Author: Dean Inglis <inglisd@mcmaster.ca>
+
+=========================================================================*/
+#include "StudyPrioritizeJob.h"
+
+#include "ReviewQueue.h"
+
+#include "vtkObjectFactory.h"
+#include "vtkSmartPointer.h"
+
+namespace Birch
+{
+  vtkStandardNewMacro( StudyPrioritizeJob );
+
+  //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+  StudyPrioritizeJob::StudyPrioritizeJob()
+  {
+    this->Policy = ReviewQueue::UIDPolicy;
+    this->RatingsPerImage = 1;
+    this->KeepCurrentPolicy = false;
+  }
+
+  //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+  void StudyPrioritizeJob::Execute()
+  {
+    // this is run from a worker thread so the queue uses the thread's own connection
+    vtkSmartPointer< ReviewQueue > queue = vtkSmartPointer< ReviewQueue >::New();
+    queue->SetRatingsPerImage( this->RatingsPerImage );
+
+    int policy = this->Policy;
+    if( this->KeepCurrentPolicy )
+    {
+      int current = queue->GetCurrentPolicy();
+      if( 0 <= current ) policy = current;
+    }
+    if( 0 <= policy ) queue->Prioritize( policy );
+    this->UpdateProgress( 1.0 );
+  }
+}
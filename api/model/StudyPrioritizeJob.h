@@ -0,0 +1,89 @@
+/*=========================================================================
+
+  Program:  Birch (CLSA Retinal Image Viewer)
+  Module:   StudyPrioritizeJob.h
+  Language: C++
+
+  Author: Patrick Emond <emondpd@mcmaster.ca>
+  Author: Dean Inglis <inglisd@mcmaster.ca>
+
+=========================================================================*/
+
+/**
+ * @class StudyPrioritizeJob
+ * @namespace Birch
+ *
+ * @author Patrick Emond <emondpd@mcmaster.ca>
+ * @author Dean Inglis <inglisd@mcmaster.ca>
+ *
+ * @brief Job which ranks the review queue's studies by a policy
+ *
+ * Ranking every study is a single (but possibly slow) statement, so it is run on one
+ * of the scheduler's worker threads.  See ReviewQueue for the available policies.
+ * The job may instead rank the studies again by the queue's current policy (used once
+ * new studies have been added, so that a policy picked by an administrator is kept).
+ */
+
+#ifndef __StudyPrioritizeJob_h
+#define __StudyPrioritizeJob_h
+
+#include "Job.h"
+
+#include <iostream>
+
+/**
+ * @addtogroup Birch
+ * @{
+ */
+
+namespace Birch
+{
+  class StudyPrioritizeJob : public Job
+  {
+  public:
+    static StudyPrioritizeJob *New();
+    vtkTypeMacro( StudyPrioritizeJob, Job );
+
+    std::string GetDescription() { return "Study prioritization"; }
+
+    //@{
+    /**
+     * The policy to rank studies by and the number of ratings each image should get.
+     * These must be set before the job is submitted.
+     */
+    vtkSetMacro( Policy, int );
+    vtkGetMacro( Policy, int );
+    vtkSetMacro( RatingsPerImage, int );
+    vtkGetMacro( RatingsPerImage, int );
+    //@}
+
+    //@{
+    /**
+     * Whether to rank the studies by the queue's current policy (see
+     * ReviewQueue::GetCurrentPolicy()) rather than by Policy, which is then only used
+     * if the studies have never been ranked (and may be -1 to do nothing in that case).
+     */
+    vtkSetMacro( KeepCurrentPolicy, bool );
+    vtkGetMacro( KeepCurrentPolicy, bool );
+    vtkBooleanMacro( KeepCurrentPolicy, bool );
+    //@}
+
+  protected:
+    StudyPrioritizeJob();
+    ~StudyPrioritizeJob() {}
+
+    void Execute();
+
+    int Policy;
+    int RatingsPerImage;
+    bool KeepCurrentPolicy;
+
+  private:
+    StudyPrioritizeJob( const StudyPrioritizeJob& ); // Not implemented
+    void operator=( const StudyPrioritizeJob& ); // Not implemented
+  };
+}
+
+/** @} end of doxygen group */
+
+#endif
@@ -0,0 +1,361 @@
+/*=========================================================================
+
+  Program:  Birch (CLSA Retinal Image Viewer)
+  Module:   StudyQuery.cxx
+  Language: C++
+
+  Author: Patrick Emond <emondpd@mcmaster.ca>
+  Author: Dean Inglis <inglisd@mcmaster.ca>
+
+=========================================================================*/
+#include "StudyQuery.h"
+
+#include "Application.h"
+#include "Database.h"
+
+#include "vtkBirchMySQLQuery.h"
+#include "vtkMutexLock.h"
+#include "vtkObjectFactory.h"
+#include "vtkSmartPointer.h"
+
+#include <sstream>
+#include <stdexcept>
+
+namespace Birch
+{
+  vtkStandardNewMacro( StudyQuery );
+
+  //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+  StudyQuery::StudyQuery()
+  {
+    this->SearchText = "";
+    this->Site = "";
+    this->Interviewer = "";
+    this->FirstAcquiredDate = "";
+    this->LastAcquiredDate = "";
+    this->RatingStatus = StudyQuery::AnyRatingStatus;
+    this->RatingUserId = 0;
+    this->SortColumn = StudyQuery::UIDColumn;
+    this->SortAscending = true;
+    this->Lock = vtkSimpleMutexLock::New();
+    this->Cancelled = false;
+    this->RunningConnectionId = 0;
+  }
+
+  //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+  StudyQuery::~StudyQuery()
+  {
+    this->Lock->Delete();
+  }
+
+  //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+  std::string StudyQuery::GetColumnName( int column )
+  {
+    // column names are written into queries so only these may ever be used
+    if( StudyQuery::UIDColumn == column ) return "uid";
+    else if( StudyQuery::SiteColumn == column ) return "site";
+    else if( StudyQuery::InterviewerColumn == column ) return "interviewer";
+    else if( StudyQuery::DatetimeAcquiredColumn == column ) return "datetime_acquired";
+
+    std::stringstream error;
+    error << "Tried to get name of invalid study column " << column;
+    throw std::runtime_error( error.str() );
+  }
+
+  //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+  void StudyQuery::DeepCopy( StudyQuery *query )
+  {
+    this->SetSearchText( query->SearchText );
+    this->SetSite( query->Site );
+    this->SetInterviewer( query->Interviewer );
+    this->SetFirstAcquiredDate( query->FirstAcquiredDate );
+    this->SetLastAcquiredDate( query->LastAcquiredDate );
+    this->SetRatingStatus( query->RatingStatus );
+    this->SetRatingUserId( query->RatingUserId );
+    this->SetSortColumn( query->SortColumn );
+    this->SetSortAscending( query->SortAscending );
+  }
+
+  //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+  void StudyQuery::SetSearchText( const std::string &text )
+  {
+    if( text == this->SearchText ) return;
+    this->SearchText = text;
+    this->Modified();
+  }
+
+  //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+  void StudyQuery::SetSite( const std::string &site )
+  {
+    if( site == this->Site ) return;
+    this->Site = site;
+    this->Modified();
+  }
+
+  //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+  void StudyQuery::SetInterviewer( const std::string &interviewer )
+  {
+    if( interviewer == this->Interviewer ) return;
+    this->Interviewer = interviewer;
+    this->Modified();
+  }
+
+  //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+  void StudyQuery::SetFirstAcquiredDate( const std::string &date )
+  {
+    if( date == this->FirstAcquiredDate ) return;
+    this->FirstAcquiredDate = date;
+    this->Modified();
+  }
+
+  //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+  void StudyQuery::SetLastAcquiredDate( const std::string &date )
+  {
+    if( date == this->LastAcquiredDate ) return;
+    this->LastAcquiredDate = date;
+    this->Modified();
+  }
+
+  //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+  void StudyQuery::SetSortColumn( int column )
+  {
+    if( 0 > column || StudyQuery::NumberOfColumns <= column )
+    {
+      std::stringstream error;
+      error << "Tried to sort studies by invalid column " << column;
+      throw std::runtime_error( error.str() );
+    }
+
+    if( column == this->SortColumn ) return;
+    this->SortColumn = column;
+    this->Modified();
+  }
+
+  //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+  std::string StudyQuery::GetWhereClause( vtkBirchMySQLQuery *query, int excludedFacet )
+  {
+    std::vector< std::string > words;
+    std::stringstream stream( this->SearchText );
+    std::string word;
+    while( stream >> word ) words.push_back( word );
+
+    // every word must be a prefix of the uid, site or interviewer (with LIKE's wildcards
+    // escaped), so each word's condition can be answered by those columns' indexes
+    std::vector< std::string > conditions;
+    std::vector< std::string >::iterator wordIt;
+    for( wordIt = words.begin(); wordIt != words.end(); ++wordIt )
+    {
+      std::string pattern;
+      std::string::const_iterator it;
+      for( it = wordIt->begin(); it != wordIt->end(); ++it )
+      {
+        if( '%' == *it || '_' == *it || '\\' == *it ) pattern += '\\';
+        pattern += *it;
+      }
+      std::string value = query->EscapeString( pattern + "%" );
+
+      conditions.push_back(
+        "( uid LIKE " + value + " OR site LIKE " + value + " OR interviewer LIKE " + value + " )" );
+    }
+
+    if( StudyQuery::SiteFacet != excludedFacet && !this->Site.empty() )
+      conditions.push_back( "site = " + query->EscapeString( this->Site ) );
+    if( StudyQuery::InterviewerFacet != excludedFacet && !this->Interviewer.empty() )
+      conditions.push_back( "interviewer = " + query->EscapeString( this->Interviewer ) );
+
+    // the last date includes the whole day (acquisition times are not displayed)
+    if( !this->FirstAcquiredDate.empty() )
+      conditions.push_back( "datetime_acquired >= " + query->EscapeString( this->FirstAcquiredDate ) );
+    if( !this->LastAcquiredDate.empty() )
+      conditions.push_back( "datetime_acquired < DATE_ADD( " +
+        query->EscapeString( this->LastAcquiredDate ) + ", INTERVAL 1 DAY )" );
+
+    if( StudyQuery::RatingFacet != excludedFacet && 0 != this->RatingUserId )
+    {
+      if( StudyQuery::RatedStatus == this->RatingStatus )
+        conditions.push_back( this->GetRatedCondition() );
+      else if( StudyQuery::UnratedStatus == this->RatingStatus )
+        conditions.push_back( "NOT ( " + this->GetRatedCondition() + " )" );
+    }
+
+    if( conditions.empty() ) return "";
+
+    std::string clause = "WHERE " + conditions[0];
+    for( unsigned int index = 1; index < conditions.size(); ++index )
+      clause += " AND " + conditions[index];
+    return clause + " ";
+  }
+
+  //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+  std::string StudyQuery::GetRatedCondition()
+  {
+    // a study is rated when none of its images are missing a rating (same as
+    // Study::IsRatedBy), this uses the image and unique rating indexes
+    std::stringstream stream;
+    stream << "NOT EXISTS ( "
+           << "SELECT 1 FROM Image "
+           << "LEFT JOIN Rating ON Rating.image_id = Image.id AND Rating.user_id = " << this->RatingUserId << " "
+           << "WHERE Image.study_id = Study.id AND Rating.rating IS NULL )";
+    return stream.str();
+  }
+
+  //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+  bool StudyQuery::Run(
+    vtkBirchMySQLQuery *query, const std::string &sql, const std::string &action )
+  {
+    // the connection id is read first so that Cancel() knows which statement to interrupt
+    int connectionId = Application::GetInstance()->GetDB()->GetConnectionId();
+
+    this->Lock->Lock();
+    bool cancelled = this->Cancelled;
+    if( !cancelled ) this->RunningConnectionId = connectionId;
+    this->Lock->Unlock();
+    if( cancelled ) return false;
+
+    query->SetQuery( sql.c_str() );
+    bool success = query->Execute();
+
+    this->Lock->Lock();
+    this->RunningConnectionId = 0;
+    cancelled = this->Cancelled;
+    this->Lock->Unlock();
+    if( cancelled ) return false;
+
+    if( !success )
+    {
+      std::stringstream error;
+      error << "Unable to " << action << ": " << query->GetLastErrorText();
+      throw std::runtime_error( error.str() );
+    }
+
+    return true;
+  }
+
+  //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+  void StudyQuery::Cancel()
+  {
+    // the lock is held while interrupting so that the connection can't move on to
+    // another statement in the mean time
+    this->Lock->Lock();
+    this->Cancelled = true;
+    if( 0 != this->RunningConnectionId )
+    {
+      try
+      {
+        Application::GetInstance()->GetDB()->KillQuery( this->RunningConnectionId );
+      }
+      catch( std::exception &e )
+      {
+        // the statement will simply run to completion
+        vtkWarningMacro( << e.what() );
+      }
+    }
+    this->Lock->Unlock();
+  }
+
+  //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+  bool StudyQuery::IsCancelled()
+  {
+    this->Lock->Lock();
+    bool cancelled = this->Cancelled;
+    this->Lock->Unlock();
+    return cancelled;
+  }
+
+  //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+  void StudyQuery::GetFacetCounts( int facet, FacetCounts &counts )
+  {
+    vtkSmartPointer<vtkBirchMySQLQuery> query = Application::GetInstance()->GetDB()->GetQuery();
+    std::string where = this->GetWhereClause( query, facet );
+    std::string sql;
+    if( StudyQuery::SiteFacet == facet )
+      sql = "SELECT site, COUNT(*) FROM Study " + where + "GROUP BY site ORDER BY site";
+    else if( StudyQuery::InterviewerFacet == facet )
+      sql = "SELECT interviewer, COUNT(*) FROM Study " + where + "GROUP BY interviewer ORDER BY interviewer";
+    else if( StudyQuery::RatingFacet == facet )
+    {
+      // there is no rating status without a user to rate
+      if( 0 == this->RatingUserId ) return;
+      sql = "SELECT " + this->GetRatedCondition() + " AS rated, COUNT(*) FROM Study " + where +
+            "GROUP BY rated ORDER BY rated DESC";
+    }
+    else
+    {
+      std::stringstream error;
+      error << "Tried to count studies by invalid facet " << facet;
+      throw std::runtime_error( error.str() );
+    }
+
+    if( !this->Run( query, sql, "count studies" ) ) return;
+
+    while( query->NextRow() )
+    {
+      std::string value = query->DataValue( 0 ).ToString();
+      if( StudyQuery::RatingFacet == facet ) value = query->DataValue( 0 ).ToInt() ? "rated" : "unrated";
+      counts.push_back( std::pair< std::string, int >( value, query->DataValue( 1 ).ToInt() ) );
+    }
+  }
+
+  //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+  std::string StudyQuery::GetFacetKey( int facet )
+  {
+    // everything which restricts the list other than the facet's own restriction,
+    // text is prefixed by its length so that no value can be mistaken for a separator
+    std::string site = StudyQuery::SiteFacet == facet ? "" : this->Site;
+    std::string interviewer = StudyQuery::InterviewerFacet == facet ? "" : this->Interviewer;
+    std::stringstream stream;
+    stream << facet
+           << "|" << this->SearchText.size() << ":" << this->SearchText
+           << "|" << site.size() << ":" << site
+           << "|" << interviewer.size() << ":" << interviewer
+           << "|" << this->FirstAcquiredDate.size() << ":" << this->FirstAcquiredDate
+           << "|" << this->LastAcquiredDate.size() << ":" << this->LastAcquiredDate
+           << "|" << ( StudyQuery::RatingFacet == facet ? 0 : this->RatingStatus )
+           << "|" << this->RatingUserId;
+    return stream.str();
+  }
+
+  //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+  bool StudyQuery::FacetDependsOnRatings( int facet )
+  {
+    return 0 != this->RatingUserId &&
+           ( StudyQuery::RatingFacet == facet || StudyQuery::AnyRatingStatus != this->RatingStatus );
+  }
+
+  //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+  int StudyQuery::GetCount()
+  {
+    vtkSmartPointer<vtkBirchMySQLQuery> query = Application::GetInstance()->GetDB()->GetQuery();
+    std::string sql = "SELECT COUNT(*) FROM Study " + this->GetWhereClause( query );
+    if( !this->Run( query, sql, "count studies" ) || !query->NextRow() ) return 0;
+    return query->DataValue( 0 ).ToInt();
+  }
+
+  //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+  void StudyQuery::GetRows( int offset, int limit, std::vector< Row > &list )
+  {
+    vtkSmartPointer<vtkBirchMySQLQuery> query = Application::GetInstance()->GetDB()->GetQuery();
+    std::string direction = this->SortAscending ? "ASC" : "DESC";
+    std::stringstream stream;
+    stream << "SELECT id";
+    for( int column = 0; column < StudyQuery::NumberOfColumns; ++column )
+      stream << ", " << StudyQuery::GetColumnName( column );
+    stream << " FROM Study " << this->GetWhereClause( query )
+           << "ORDER BY " << StudyQuery::GetColumnName( this->SortColumn ) << " " << direction;
+
+    // uids are unique, so ordering ties by uid makes the order of every page stable
+    if( StudyQuery::UIDColumn != this->SortColumn ) stream << ", uid " << direction;
+    stream << " LIMIT " << offset << ", " << limit;
+
+    if( !this->Run( query, stream.str(), "list studies" ) ) return;
+
+    while( query->NextRow() )
+    {
+      Row row;
+      row.Id = query->DataValue( 0 ).ToInt();
+      for( int column = 0; column < StudyQuery::NumberOfColumns; ++column )
+        row.Values.push_back( query->DataValue( column + 1 ).ToString() );
+      list.push_back( row );
+    }
+  }
+}
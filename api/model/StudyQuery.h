@@ -0,0 +1,259 @@
+/*=========================================================================
+
+  Program:  Birch (CLSA Retinal Image Viewer)
+  Module:   StudyQuery.h
+  Language: C++
+
+  Author: Patrick Emond <emondpd@mcmaster.ca>
+  Author: Dean Inglis <inglisd@mcmaster.ca>
+
+=========================================================================*/
+
+/**
+ * @class StudyQuery
+ * @namespace Birch
+ *
+ * @author Patrick Emond <emondpd@mcmaster.ca>
+ * @author Dean Inglis <inglisd@mcmaster.ca>
+ *
+ * @brief A filtered and sorted view of the Study table
+ *
+ * Describes which studies to list and in which order, and reads the number of
+ * matching studies or a range of rows of the list from the database.  Filtering,
+ * sorting and paging are all done by the database server so that only the rows
+ * being displayed are ever transferred.
+ *
+ * The search text lists studies whose uid, site or interviewer starts with every one
+ * of its words.  Each word is matched with LIKE prefixes, which rely on the Study
+ * table's dk_uid, dk_site and dk_interviewer indexes (see sql/schema.sql), so short
+ * words and common words match just as any other.  The list may also be restricted to a site, an interviewer, a range of
+ * acquisition dates and to studies which a user has (or hasn't) finished rating.
+ *
+ * Facets count how many of the listed studies have each site, interviewer or rating
+ * status, ignoring the facet's own restriction so that the counts show what choosing
+ * another value would list.  Each facet is counted by a single aggregate query.
+ *
+ * Queries are run on the calling thread's database connection, so a copy of the
+ * query (see DeepCopy()) may be used by a job on one of the scheduler's threads.
+ * Cancel() may then be called from the GUI thread to interrupt the statement being
+ * run by the job.
+ */
+
+#ifndef __StudyQuery_h
+#define __StudyQuery_h
+
+#include "ModelObject.h"
+
+#include <iostream>
+#include <utility>
+#include <vector>
+
+class vtkBirchMySQLQuery;
+class vtkSimpleMutexLock;
+
+/**
+ * @addtogroup Birch
+ * @{
+ */
+
+namespace Birch
+{
+  class StudyQuery : public ModelObject
+  {
+  public:
+    static StudyQuery *New();
+    vtkTypeMacro( StudyQuery, ModelObject );
+
+    /** The columns listed by the query */
+    enum Column
+    {
+      UIDColumn = 0,
+      SiteColumn,
+      InterviewerColumn,
+      DatetimeAcquiredColumn,
+      NumberOfColumns
+    };
+
+    /** A row of the list, values are in the same order as the columns */
+    struct Row
+    {
+      int Id;
+      std::vector< std::string > Values;
+    };
+
+    /** The values which studies may be counted by */
+    enum Facet
+    {
+      SiteFacet = 0,
+      InterviewerFacet,
+      RatingFacet,
+      NumberOfFacets
+    };
+
+    /** Whether studies have been rated, a study is rated once all its images are */
+    enum RatingStatus
+    {
+      AnyRatingStatus = 0,
+      RatedStatus,
+      UnratedStatus
+    };
+
+    /** Value and number of studies pairs of a facet */
+    typedef std::vector< std::pair< std::string, int > > FacetCounts;
+
+    /**
+     * Returns the name of a column's field in the Study table
+     * @throws runtime_error
+     */
+    static std::string GetColumnName( int column );
+
+    /**
+     * Copies the search text, restrictions and sort order of another query
+     */
+    void DeepCopy( StudyQuery *query );
+
+    //@{
+    /**
+     * The words to search for (ignoring case), all studies are listed if empty
+     */
+    void SetSearchText( const std::string &text );
+    std::string GetSearchText() { return this->SearchText; }
+    //@}
+
+    //@{
+    /**
+     * Only studies of this site and interviewer are listed (any if empty)
+     */
+    void SetSite( const std::string &site );
+    std::string GetSite() { return this->Site; }
+    void SetInterviewer( const std::string &interviewer );
+    std::string GetInterviewer() { return this->Interviewer; }
+    //@}
+
+    //@{
+    /**
+     * Only studies acquired on or after the first date and on or before the last date
+     * (formatted as YYYY-MM-DD) are listed, either end of the range is open if empty
+     */
+    void SetFirstAcquiredDate( const std::string &date );
+    std::string GetFirstAcquiredDate() { return this->FirstAcquiredDate; }
+    void SetLastAcquiredDate( const std::string &date );
+    std::string GetLastAcquiredDate() { return this->LastAcquiredDate; }
+    //@}
+
+    //@{
+    /**
+     * Only studies with this rating status are listed.  The status is that of the
+     * rating user's ratings and is ignored (as is the rating facet) until a user is set.
+     */
+    vtkSetClampMacro( RatingStatus, int, AnyRatingStatus, UnratedStatus );
+    vtkGetMacro( RatingStatus, int );
+    vtkSetMacro( RatingUserId, int );
+    vtkGetMacro( RatingUserId, int );
+    //@}
+
+    //@{
+    /**
+     * The column the list is sorted by (ties are ordered by uid)
+     * @throws runtime_error
+     */
+    void SetSortColumn( int column );
+    vtkGetMacro( SortColumn, int );
+    //@}
+
+    //@{
+    /**
+     * Whether the list is sorted in ascending order
+     */
+    vtkSetMacro( SortAscending, bool );
+    vtkGetMacro( SortAscending, bool );
+    vtkBooleanMacro( SortAscending, bool );
+    //@}
+
+    /**
+     * Returns the number of studies in the list (0 once cancelled)
+     * @throws runtime_error
+     */
+    int GetCount();
+
+    /**
+     * Reads up to limit rows of the list starting at the given offset (no rows are
+     * read once cancelled)
+     * @throws runtime_error
+     */
+    void GetRows( int offset, int limit, std::vector< Row > &list );
+
+    /**
+     * Counts the listed studies by the values of a facet (the facet's own restriction
+     * is ignored).  Rating status values are "rated" and "unrated".
+     * @throws runtime_error
+     */
+    void GetFacetCounts( int facet, FacetCounts &counts );
+
+    /**
+     * Returns a string which is the same for any two queries whose counts of a facet
+     * are the same (used to cache facet counts)
+     */
+    std::string GetFacetKey( int facet );
+
+    /**
+     * Returns whether a facet's counts change when studies are rated
+     */
+    bool FacetDependsOnRatings( int facet );
+
+    /**
+     * Interrupts the statement being run by another thread using this query and stops
+     * any more statements from being run.  This method is thread safe.
+     */
+    void Cancel();
+
+    /**
+     * Returns whether the query has been cancelled
+     */
+    bool IsCancelled();
+
+  protected:
+    StudyQuery();
+    ~StudyQuery();
+
+    /**
+     * Returns the WHERE clause (which may be empty) restricting the list, leaving out
+     * the restriction of the excluded facet (if any)
+     */
+    std::string GetWhereClause( vtkBirchMySQLQuery *query, int excludedFacet = -1 );
+
+    /**
+     * Returns a condition which is true for studies the rating user has rated
+     */
+    std::string GetRatedCondition();
+
+    /**
+     * Runs a statement which may be interrupted by Cancel(), returns false if the
+     * query was cancelled
+     * @throws runtime_error
+     */
+    bool Run( vtkBirchMySQLQuery *query, const std::string &sql, const std::string &action );
+
+    std::string SearchText;
+    std::string Site;
+    std::string Interviewer;
+    std::string FirstAcquiredDate;
+    std::string LastAcquiredDate;
+    int RatingStatus;
+    int RatingUserId;
+    int SortColumn;
+    bool SortAscending;
+
+    vtkSimpleMutexLock *Lock;
+    bool Cancelled;
+    int RunningConnectionId; // the connection running a statement (0 if none)
+
+  private:
+    StudyQuery( const StudyQuery& ); // Not implemented
+    void operator=( const StudyQuery& ); // Not implemented
+  };
+}
+
+/** @} end of doxygen group */
+
+#endif
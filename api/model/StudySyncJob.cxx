@@ -0,0 +1,168 @@
+/*=========================================================================
+
+  Program:  Birch (CLSA Retinal Image Viewer)
+  Module:   StudySyncJob.cxx
+  Language: C++
+
+  Author: Patrick Emond <emondpd@mcmaster.ca>
+  Author: Dean Inglis <inglisd@mcmaster.ca>
+
+=========================================================================*/
+
+#include "StudySyncJob.h"
+
+#include "Application.h"
+#include "Database.h"
+#include "JobScheduler.h"
+#include "OpalService.h"
+#include "Study.h"
+
+#include "vtkMutexLock.h"
+#include "vtkObjectFactory.h"
+#include "vtkSmartPointer.h"
+
+#include <algorithm>
+#include <set>
+#include <stdexcept>
+
+namespace Birch
+{
+  vtkStandardNewMacro( StudySyncJob );
+
+  //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+  StudySyncJob::StudySyncJob()
+  {
+    this->Priority = Job::BACKGROUND;
+    this->IdentifierDataSource = "clsa-dcs-images";
+    this->IdentifierTable = "CarotidIntima";
+    this->ValueDataSource = "clsa-dcs";
+    this->ValueTable = "CarotidIntima";
+    this->BatchSize = 100;
+    this->NumberOfStudiesWritten = 0;
+  }
+
+  //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+  int StudySyncJob::GetNumberOfStudiesWritten()
+  {
+    this->Lock->Lock();
+    int count = this->NumberOfStudiesWritten;
+    this->Lock->Unlock();
+    return count;
+  }
+
+  //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+  void StudySyncJob::Execute()
+  {
+    OpalService *opal = Application::GetInstance()->GetOpal();
+
+    this->Lock->Lock();
+    this->NumberOfStudiesWritten = 0;
+    this->Lock->Unlock();
+    this->UpdateProgress( 0.0 );
+
+    std::vector< std::string > identifierList =
+      opal->GetIdentifiers( this->IdentifierDataSource, this->IdentifierTable );
+    if( identifierList.empty() ) return;
+
+    std::set< std::string > remainingList( identifierList.begin(), identifierList.end() );
+    int offset = 0;
+    int lastPageSize = 0;
+
+    // request, write and commit one page of value sets at a time
+    while( !remainingList.empty() && !this->IsCancelled() )
+    {
+      int interviewerPageSize = 0, datetimePageSize = 0;
+      std::map< std::string, std::string > interviewerList = opal->GetValueList(
+        this->ValueDataSource, this->ValueTable, "InstrumentRun.user",
+        offset, this->BatchSize, &interviewerPageSize );
+      std::map< std::string, std::string > datetimeList = opal->GetValueList(
+        this->ValueDataSource, this->ValueTable, "InstrumentRun.timeStart",
+        offset, this->BatchSize, &datetimePageSize );
+
+      // pages are counted in value sets rather than values (Opal leaves out empty values)
+      // and the server may return fewer than requested, so the offset advances by what
+      // was returned and only an empty page (or one shorter than the last, which a
+      // server limit can't explain) ends the list
+      int pageSize = std::max( interviewerPageSize, datetimePageSize );
+      if( 0 == pageSize ) break;
+      offset += pageSize;
+      bool lastPage = 0 < lastPageSize && pageSize < lastPageSize;
+      lastPageSize = pageSize;
+
+      // only write identifiers which have not already been written
+      std::vector< std::string > batchList;
+      std::map< std::string, std::string >::const_iterator it;
+      for( it = interviewerList.begin(); it != interviewerList.end(); ++it )
+        if( remainingList.erase( it->first ) ) batchList.push_back( it->first );
+      for( it = datetimeList.begin(); it != datetimeList.end(); ++it )
+        if( remainingList.erase( it->first ) ) batchList.push_back( it->first );
+
+      if( !batchList.empty() ) this->WriteBatch( batchList, interviewerList, datetimeList );
+      this->UpdateProgress(
+        (double)( identifierList.size() - remainingList.size() ) / identifierList.size() );
+      if( lastPage ) break;
+    }
+
+    // identifiers which Opal has no values for are still added to the database
+    std::map< std::string, std::string > emptyList;
+    std::vector< std::string > batchList;
+    std::set< std::string >::iterator it;
+    for( it = remainingList.begin(); it != remainingList.end() && !this->IsCancelled(); ++it )
+    {
+      batchList.push_back( *it );
+      if( (int) batchList.size() == this->BatchSize )
+      {
+        this->WriteBatch( batchList, emptyList, emptyList );
+        batchList.clear();
+      }
+    }
+    if( !batchList.empty() && !this->IsCancelled() ) this->WriteBatch( batchList, emptyList, emptyList );
+
+    if( !this->IsCancelled() ) this->UpdateProgress( 1.0 );
+  }
+
+  //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+  void StudySyncJob::WriteBatch(
+    const std::vector< std::string > &identifierList,
+    const std::map< std::string, std::string > &interviewerList,
+    const std::map< std::string, std::string > &datetimeList )
+  {
+    // this is run from a worker thread so GetDB() returns the thread's own connection
+    vtkSmartPointer<vtkBirchMySQLQuery> query = Application::GetInstance()->GetDB()->GetQuery();
+    if( !query->BeginTransaction() )
+      throw std::runtime_error( "Unable to start transaction while updating study database" );
+
+    try
+    {
+      std::vector< std::string >::const_iterator identifier;
+      std::map< std::string, std::string >::const_iterator value;
+      for( identifier = identifierList.begin(); identifier != identifierList.end(); ++identifier )
+      {
+        vtkSmartPointer< Study > study = vtkSmartPointer< Study >::New();
+        study->Load( "uid", *identifier ); // may not result in loading a record
+        study->Set( "uid", *identifier );
+        study->Set( "site", "unknown" ); // TODO: get from Mastodon
+        value = interviewerList.find( *identifier );
+        study->Set( "interviewer", interviewerList.end() != value ? value->second : "unknown" );
+        value = datetimeList.find( *identifier );
+        study->Set( "datetime_acquired", datetimeList.end() != value ? value->second : "unknown" );
+        study->Save();
+      }
+    }
+    catch( std::exception &e )
+    {
+      query->RollbackTransaction();
+      throw;
+    }
+
+    if( !query->CommitTransaction() )
+      throw std::runtime_error( "Unable to commit transaction while updating study database" );
+
+    this->Lock->Lock();
+    this->NumberOfStudiesWritten += identifierList.size();
+    this->Lock->Unlock();
+
+    // let the interface know that new studies are available
+    this->PostEvent( JobScheduler::JobDataEvent );
+  }
+}
@@ -0,0 +1,114 @@
+/*=========================================================================
+
+  Program:  Birch (CLSA Retinal Image Viewer)
+  Module:   StudySyncJob.h
+  Language: C++
+
+  Author: Patrick Emond <emondpd@mcmaster.ca>
+  Author: Dean Inglis <inglisd@mcmaster.ca>
+
+=========================================================================*/
+
+/**
+ * @class StudySyncJob
+ * @namespace Birch
+ *
+ * @author Patrick Emond <emondpd@mcmaster.ca>
+ * @author Dean Inglis <inglisd@mcmaster.ca>
+ *
+ * @brief Job which updates the Study table using data from Opal
+ *
+ * Study records are created or updated one page of Opal value sets at a time.
+ * Each page is written in a single transaction and, once committed, a
+ * JobScheduler::JobDataEvent is posted so that the interface can show the new
+ * studies without waiting for the whole synchronization to finish.
+ */
+
+#ifndef __StudySyncJob_h
+#define __StudySyncJob_h
+
+#include "Job.h"
+
+#include <iostream>
+#include <map>
+#include <vector>
+
+/**
+ * @addtogroup Birch
+ * @{
+ */
+
+namespace Birch
+{
+  class StudySyncJob : public Job
+  {
+  public:
+    static StudySyncJob *New();
+    vtkTypeMacro( StudySyncJob, Job );
+
+    std::string GetDescription() { return "Study database update"; }
+
+    //@{
+    /**
+     * The Opal data source and table to read identifiers from
+     */
+    vtkSetMacro( IdentifierDataSource, std::string );
+    vtkGetMacro( IdentifierDataSource, std::string );
+    vtkSetMacro( IdentifierTable, std::string );
+    vtkGetMacro( IdentifierTable, std::string );
+    //@}
+
+    //@{
+    /**
+     * The Opal data source and table to read study values from
+     */
+    vtkSetMacro( ValueDataSource, std::string );
+    vtkGetMacro( ValueDataSource, std::string );
+    vtkSetMacro( ValueTable, std::string );
+    vtkGetMacro( ValueTable, std::string );
+    //@}
+
+    //@{
+    /**
+     * The number of value sets requested from Opal (and committed) at a time
+     */
+    vtkSetMacro( BatchSize, int );
+    vtkGetMacro( BatchSize, int );
+    //@}
+
+    /**
+     * Returns the number of studies written by the last (or current) run
+     */
+    int GetNumberOfStudiesWritten();
+
+  protected:
+    StudySyncJob();
+    ~StudySyncJob() {}
+
+    void Execute();
+
+    /**
+     * Creates or updates study records in a single transaction
+     * @throws runtime_error
+     */
+    void WriteBatch(
+      const std::vector< std::string > &identifierList,
+      const std::map< std::string, std::string > &interviewerList,
+      const std::map< std::string, std::string > &datetimeList );
+
+    std::string IdentifierDataSource;
+    std::string IdentifierTable;
+    std::string ValueDataSource;
+    std::string ValueTable;
+    int BatchSize;
+    int NumberOfStudiesWritten;
+
+  private:
+    StudySyncJob( const StudySyncJob& ); // Not implemented
+    void operator=( const StudySyncJob& ); // Not implemented
+  };
+}
+
+/** @} end of doxygen group */
+
+#endif
@@ -0,0 +1,187 @@
+/*=========================================================================
+
+  Program:   Birch ( CLSA Retinal Image Viewer )
+  Module:    vtkBirchDefaultWindowLevel.cxx
+  Language:  C++
+
+  Author: Patrick Emond <emondpd@mcmaster.ca>
+  Author: Dean Inglis <inglisd@mcmaster.ca>
+
+=========================================================================*/
+#include "vtkBirchDefaultWindowLevel.h"
+
+#include "vtkDataArray.h"
+#include "vtkDoubleArray.h"
+#include "vtkFieldData.h"
+#include "vtkImageData.h"
+#include "vtkObjectFactory.h"
+
+#include <vector>
+
+vtkStandardNewMacro( vtkBirchDefaultWindowLevel );
+
+const char* vtkBirchDefaultWindowLevel::ArrayName = "DefaultWindowLevel";
+const double vtkBirchDefaultWindowLevel::Clipping = 0.005;
+
+//-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+// Counts the values of an image in a single pass.  Values are offset so that
+// signed types start at bin 0.  Consecutive values are counted in four
+// separate histograms since neighbouring pixels often have the same value and
+// incrementing one counter repeatedly stalls on the previous increment.  Only
+// the first colourComponents of each pixel's components are counted.
+template <class T>
+static void vtkBirchDefaultWindowLevelHistogram(
+  const T* ptr, vtkIdType pixels, int components, int colourComponents, int offset,
+  std::vector< vtkIdType >& histogram )
+{
+  size_t bins = histogram.size();
+  std::vector< unsigned int > partial( 4 * bins, 0 );
+  unsigned int* h0 = &partial[0];
+  unsigned int* h1 = h0 + bins;
+  unsigned int* h2 = h1 + bins;
+  unsigned int* h3 = h2 + bins;
+
+  // without alpha every value is counted, so the pixels are one long run of values
+  vtkIdType count = pixels;
+  if( components == colourComponents )
+  {
+    count = pixels * components;
+    components = colourComponents = 1;
+  }
+
+  // partial counts are flushed before they can overflow
+  const vtkIdType block = 1 << 30;
+  for( vtkIdType start = 0; start < count; start += block )
+  {
+    vtkIdType end = count - start < block ? count : start + block;
+    vtkIdType i = start;
+    if( 1 == components )
+    {
+      for( ; i + 4 <= end; i += 4 )
+      {
+        ++h0[static_cast<int>( ptr[i] ) + offset];
+        ++h1[static_cast<int>( ptr[i + 1] ) + offset];
+        ++h2[static_cast<int>( ptr[i + 2] ) + offset];
+        ++h3[static_cast<int>( ptr[i + 3] ) + offset];
+      }
+      for( ; i < end; ++i ) ++h0[static_cast<int>( ptr[i] ) + offset];
+    }
+    else
+    {
+      for( ; i < end; ++i )
+      {
+        const T* pixel = ptr + i * components;
+        ++h0[static_cast<int>( pixel[0] ) + offset];
+        if( 1 < colourComponents ) ++h1[static_cast<int>( pixel[1] ) + offset];
+        if( 2 < colourComponents ) ++h2[static_cast<int>( pixel[2] ) + offset];
+      }
+    }
+
+    for( size_t b = 0; b < bins; ++b )
+    {
+      histogram[b] += h0[b] + h1[b] + h2[b] + h3[b];
+      h0[b] = h1[b] = h2[b] = h3[b] = 0;
+    }
+  }
+}
+
+//-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+bool vtkBirchDefaultWindowLevel::Compute( vtkImageData* image )
+{
+  if( !image ) return false;
+
+  // luminance/alpha and RGBA images have a trailing alpha component
+  int components = image->GetNumberOfScalarComponents();
+  int colourComponents = 2 == components || 4 == components ? components - 1 : components;
+  if( 1 > colourComponents || 3 < colourComponents ) return false;
+
+  vtkIdType pixels = image->GetNumberOfPoints();
+  void* ptr = image->GetScalarPointer();
+  if( 0 == pixels || !ptr ) return false;
+
+  int offset;
+  std::vector< vtkIdType > histogram;
+  switch( image->GetScalarType() )
+  {
+    case VTK_UNSIGNED_CHAR:
+      offset = 0;
+      histogram.resize( VTK_UNSIGNED_CHAR_MAX + 1, 0 );
+      vtkBirchDefaultWindowLevelHistogram(
+        static_cast< unsigned char* >( ptr ), pixels, components, colourComponents, offset, histogram );
+      break;
+    case VTK_SIGNED_CHAR:
+      offset = -VTK_SIGNED_CHAR_MIN;
+      histogram.resize( VTK_UNSIGNED_CHAR_MAX + 1, 0 );
+      vtkBirchDefaultWindowLevelHistogram(
+        static_cast< signed char* >( ptr ), pixels, components, colourComponents, offset, histogram );
+      break;
+    case VTK_CHAR:
+      offset = -VTK_CHAR_MIN;
+      histogram.resize( VTK_UNSIGNED_CHAR_MAX + 1, 0 );
+      vtkBirchDefaultWindowLevelHistogram(
+        static_cast< char* >( ptr ), pixels, components, colourComponents, offset, histogram );
+      break;
+    case VTK_UNSIGNED_SHORT:
+      offset = 0;
+      histogram.resize( VTK_UNSIGNED_SHORT_MAX + 1, 0 );
+      vtkBirchDefaultWindowLevelHistogram(
+        static_cast< unsigned short* >( ptr ), pixels, components, colourComponents, offset, histogram );
+      break;
+    case VTK_SHORT:
+      offset = -VTK_SHORT_MIN;
+      histogram.resize( VTK_UNSIGNED_SHORT_MAX + 1, 0 );
+      vtkBirchDefaultWindowLevelHistogram(
+        static_cast< short* >( ptr ), pixels, components, colourComponents, offset, histogram );
+      break;
+    default:
+      return false;
+  }
+
+  // clip the given fraction of values at each end of the histogram
+  vtkIdType count = pixels * colourComponents;
+  vtkIdType clip = static_cast< vtkIdType >( count * vtkBirchDefaultWindowLevel::Clipping );
+  int bins = static_cast< int >( histogram.size() );
+  int lower = 0, upper = bins - 1;
+  for( vtkIdType sum = histogram[lower]; sum <= clip && lower < upper; sum += histogram[lower] ) ++lower;
+  for( vtkIdType sum = histogram[upper]; sum <= clip && upper > lower; sum += histogram[upper] ) --upper;
+
+  double window = upper - lower;
+  double level = 0.5 * ( lower + upper ) - offset;
+  vtkBirchDefaultWindowLevel::Set( image, 0.0 < window ? window : 1.0, level );
+  return true;
+}
+
+//-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+bool vtkBirchDefaultWindowLevel::Get( vtkImageData* image, double& window, double& level )
+{
+  vtkDataArray* array = image ?
+    image->GetFieldData()->GetArray( vtkBirchDefaultWindowLevel::ArrayName ) : NULL;
+  if( !array || 2 != array->GetNumberOfTuples() ) return false;
+
+  window = array->GetTuple1( 0 );
+  level = array->GetTuple1( 1 );
+  return true;
+}
+
+//-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+void vtkBirchDefaultWindowLevel::Set( vtkImageData* image, double window, double level )
+{
+  if( !image ) return;
+
+  vtkDoubleArray* array = vtkDoubleArray::New();
+  array->SetName( vtkBirchDefaultWindowLevel::ArrayName );
+  array->SetNumberOfTuples( 2 );
+  array->SetValue( 0, window );
+  array->SetValue( 1, level );
+  image->GetFieldData()->RemoveArray( vtkBirchDefaultWindowLevel::ArrayName );
+  image->GetFieldData()->AddArray( array );
+  array->Delete();
+}
+
+//-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+void vtkBirchDefaultWindowLevel::PrintSelf( ostream& os, vtkIndent indent )
+{
+  this->Superclass::PrintSelf( os, indent );
+  os << indent << "ArrayName: " << vtkBirchDefaultWindowLevel::ArrayName << "\n";
+  os << indent << "Clipping: " << vtkBirchDefaultWindowLevel::Clipping << "\n";
+}
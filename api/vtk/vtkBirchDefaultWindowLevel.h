@@ -0,0 +1,83 @@
+/*=======================================================================
+
+  Module:    vtkBirchDefaultWindowLevel.h
+  Program:   Birch (CLSA Retinal Image Viewer)
+  Language:  C++
+  Author:    Patrick Emond <emondpd@mcmaster.ca>
+  Author:    Dean Inglis <inglisd@mcmaster.ca>
+
+=========================================================================*/
+
+/**
+ * @class vtkBirchDefaultWindowLevel
+ *
+ * @author Patrick Emond <emondpd@mcmaster.ca>
+ * @author Dean Inglis <inglisd@mcmaster.ca>
+ *
+ * @brief Computes and stores the default window/level of an image.
+ *
+ * The default window/level of an image is computed from its histogram and kept
+ * in the image's field data, so that it is cached along with the decoded image
+ * and may be computed on any thread before the image is displayed.  Both the
+ * model (which saves it with the image's record) and vtkMedicalImageViewer use
+ * this class.
+ *
+ * @see vtkMedicalImageViewer
+ */
+#ifndef __vtkBirchDefaultWindowLevel_h
+#define __vtkBirchDefaultWindowLevel_h
+
+#include "vtkObject.h"
+
+class vtkImageData;
+
+class vtkBirchDefaultWindowLevel : public vtkObject
+{
+public:
+  static vtkBirchDefaultWindowLevel *New();
+  vtkTypeMacro( vtkBirchDefaultWindowLevel, vtkObject );
+  void PrintSelf( ostream& os, vtkIndent indent );
+
+  /**
+   * Compute the default window/level of an image from its histogram.
+   * The histogram of an 8 or 16 bit integer image is counted in one pass over
+   * the pixels and the window spans the values between the Clipping and
+   * 1 - Clipping quantiles, so a few outlier pixels can't ruin the contrast.
+   * The colour components of multi-component images are counted together
+   * (alpha is left out) since they are all mapped by the same window/level.
+   * The result is stored in the image's field data.  This method may be called
+   * from any thread.
+   * @param image vtkImageData to compute the window/level of
+   * @return false if the image's scalar type isn't supported
+   */
+  static bool Compute( vtkImageData* image );
+
+  /**
+   * Get the default window/level stored in an image's field data by Compute()
+   * or Set().
+   * @return false if the image has no default window/level
+   */
+  static bool Get( vtkImageData* image, double& window, double& level );
+
+  /**
+   * Store the default window/level of an image in its field data (for instance
+   * one which was previously computed and saved elsewhere).
+   */
+  static void Set( vtkImageData* image, double window, double level );
+
+  /** Name of the field data array holding an image's default window/level */
+  static const char* ArrayName;
+
+  /** Fraction of values ignored at each end of the histogram (0.005) */
+  static const double Clipping;
+
+protected:
+  vtkBirchDefaultWindowLevel() {}
+  ~vtkBirchDefaultWindowLevel() {}
+
+private:
+  vtkBirchDefaultWindowLevel( const vtkBirchDefaultWindowLevel& );  // Not implemented.
+  void operator=( const vtkBirchDefaultWindowLevel& );  // Not implemented.
+};
+
+#endif
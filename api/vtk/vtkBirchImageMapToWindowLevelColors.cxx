@@ -0,0 +1,553 @@
+/*=========================================================================
+
+  Program:   Birch ( CLSA Retinal Image Viewer )
+  Module:    vtkBirchImageMapToWindowLevelColors.cxx
+  Language:  C++
+
+  Author: Patrick Emond <emondpd@mcmaster.ca>
+  Author: Dean Inglis <inglisd@mcmaster.ca>
+
+=========================================================================*/
+#include "vtkBirchImageMapToWindowLevelColors.h"
+
+#include "vtkConditionVariable.h"
+#include "vtkDataObject.h"
+#include "vtkImageData.h"
+#include "vtkInformation.h"
+#include "vtkInformationVector.h"
+#include "vtkMultiThreader.h"
+#include "vtkMutexLock.h"
+#include "vtkObjectFactory.h"
+#include "vtkPointData.h"
+#include "vtkStreamingDemandDrivenPipeline.h"
+
+#include <cmath>
+
+#if defined( __SSE2__ ) || defined( _M_X64 ) || ( defined( _M_IX86_FP ) && _M_IX86_FP >= 2 )
+#define BIRCH_WINDOW_LEVEL_SSE2
+#include <emmintrin.h>
+#endif
+
+#if defined( __AVX2__ )
+#define BIRCH_WINDOW_LEVEL_AVX2
+#include <immintrin.h>
+#endif
+
+vtkStandardNewMacro( vtkBirchImageMapToWindowLevelColors );
+
+// slabs smaller than this many pixels aren't worth handing to another thread
+static const int vtkWindowLevelMinimumSlabSize = 65536;
+
+//-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+// A pool of threads which map slabs of an image.  Threads are created when the
+// pool is first used (or resized) and wait for work between executions.  The
+// thread calling Execute() maps slabs as well, so a pool of N threads has N-1
+// workers.
+class vtkBirchWindowLevelThreadPool
+{
+public:
+  typedef void ( *SlabMethod )( void *data, int slab );
+
+  vtkBirchWindowLevelThreadPool()
+  {
+    this->Threader = vtkMultiThreader::New();
+    this->Lock = vtkSimpleMutexLock::New();
+    this->WorkCondition = vtkConditionVariable::New();
+    this->DoneCondition = vtkConditionVariable::New();
+    this->Stopping = false;
+    this->Method = NULL;
+    this->Data = NULL;
+    this->NumberOfSlabs = 0;
+    this->NextSlab = 0;
+    this->RemainingSlabs = 0;
+  }
+
+  ~vtkBirchWindowLevelThreadPool()
+  {
+    this->Stop();
+    this->Threader->Delete();
+    this->Lock->Delete();
+    this->WorkCondition->Delete();
+    this->DoneCondition->Delete();
+  }
+
+  // maps every slab and returns once all of them are done
+  void Execute( int numberOfThreads, int numberOfSlabs, SlabMethod method, void *data )
+  {
+    if( static_cast<int>( this->ThreadIds.size() ) != numberOfThreads - 1 )
+    {
+      this->Stop();
+      for( int i = 1; i < numberOfThreads; ++i )
+      {
+        // if a thread can't be created the remaining threads do the work
+        int id = this->Threader->SpawnThread( vtkBirchWindowLevelThreadPool::WorkerThread, this );
+        if( 0 > id ) break;
+        this->ThreadIds.push_back( id );
+      }
+    }
+
+    this->Lock->Lock();
+    this->Method = method;
+    this->Data = data;
+    this->NumberOfSlabs = numberOfSlabs;
+    this->NextSlab = 0;
+    this->RemainingSlabs = numberOfSlabs;
+    this->WorkCondition->Broadcast();
+    this->MapSlabs();
+    while( 0 < this->RemainingSlabs ) this->DoneCondition->Wait( *this->Lock );
+    this->NumberOfSlabs = 0;
+    this->NextSlab = 0;
+    this->Lock->Unlock();
+  }
+
+protected:
+  // maps slabs until none are left, the lock must be held
+  void MapSlabs()
+  {
+    while( this->NextSlab < this->NumberOfSlabs )
+    {
+      int slab = this->NextSlab++;
+      this->Lock->Unlock();
+      this->Method( this->Data, slab );
+      this->Lock->Lock();
+      if( 0 == --this->RemainingSlabs ) this->DoneCondition->Broadcast();
+    }
+  }
+
+  void Stop()
+  {
+    this->Lock->Lock();
+    this->Stopping = true;
+    this->WorkCondition->Broadcast();
+    this->Lock->Unlock();
+
+    std::vector<int>::iterator it;
+    for( it = this->ThreadIds.begin(); it != this->ThreadIds.end(); ++it )
+      this->Threader->TerminateThread( *it );
+    this->ThreadIds.clear();
+    this->Stopping = false;
+  }
+
+  static VTK_THREAD_RETURN_TYPE WorkerThread( void *arg )
+  {
+    vtkMultiThreader::ThreadInfo *info = static_cast<vtkMultiThreader::ThreadInfo*>( arg );
+    vtkBirchWindowLevelThreadPool *self = static_cast<vtkBirchWindowLevelThreadPool*>( info->UserData );
+
+    self->Lock->Lock();
+    while( true )
+    {
+      while( !self->Stopping && self->NextSlab >= self->NumberOfSlabs )
+        self->WorkCondition->Wait( *self->Lock );
+      if( self->Stopping ) break;
+      self->MapSlabs();
+    }
+    self->Lock->Unlock();
+    return VTK_THREAD_RETURN_VALUE;
+  }
+
+  vtkMultiThreader *Threader;
+  vtkSimpleMutexLock *Lock;
+  vtkConditionVariable *WorkCondition;
+  vtkConditionVariable *DoneCondition;
+  std::vector<int> ThreadIds;
+  bool Stopping;
+  SlabMethod Method;
+  void *Data;
+  int NumberOfSlabs;
+  int NextSlab;
+  int RemainingSlabs;
+};
+
+//-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+// An image split into slabs along its rows (or slices if it has more than one)
+struct vtkWindowLevelSlabs
+{
+  vtkBirchImageMapToWindowLevelColors *Filter;
+  vtkImageData *InData;
+  vtkImageData *OutData;
+  int Extent[6];
+  int Axis;
+  int NumberOfSlabs;
+};
+
+//-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+// The mapping of a single value, the table and SIMD kernels must agree exactly
+// so every step is done in single precision in the same order
+static inline unsigned char vtkWindowLevelMapValue( float value, float scale, float offset )
+{
+  float result = value * scale;
+  result = result + offset;
+  if( result < 0.0f ) result = 0.0f;
+  if( result > 255.0f ) result = 255.0f;
+  return static_cast<unsigned char>( result );
+}
+
+//-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+// The scale and offset of the mapping, a (nearly) zero window is widened so that
+// the scale stays finite and maps values to either side of the level
+static void vtkWindowLevelScaleOffset( double window, double level, float &scale, float &offset )
+{
+  const double minimumWindow = 1.0e-3;
+  if( fabs( window ) < minimumWindow ) window = window < 0.0 ? -minimumWindow : minimumWindow;
+  scale = static_cast<float>( 255.0 / window );
+  offset = static_cast<float>( ( window / 2.0 - level ) * 255.0 / window );
+}
+
+#ifdef BIRCH_WINDOW_LEVEL_SSE2
+//-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+static inline __m128i vtkWindowLevelMap4( __m128i value, __m128 scale, __m128 offset )
+{
+  __m128 result = _mm_mul_ps( _mm_cvtepi32_ps( value ), scale );
+  result = _mm_add_ps( result, offset );
+  result = _mm_min_ps( _mm_max_ps( result, _mm_setzero_ps() ), _mm_set1_ps( 255.0f ) );
+  return _mm_cvttps_epi32( result );
+}
+#endif
+
+#ifdef BIRCH_WINDOW_LEVEL_AVX2
+//-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+static inline __m256i vtkWindowLevelMap8( __m256i value, __m256 scale, __m256 offset )
+{
+  __m256 result = _mm256_mul_ps( _mm256_cvtepi32_ps( value ), scale );
+  result = _mm256_add_ps( result, offset );
+  result = _mm256_min_ps( _mm256_max_ps( result, _mm256_setzero_ps() ), _mm256_set1_ps( 255.0f ) );
+  return _mm256_cvttps_epi32( result );
+}
+
+//-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+// packs two vectors of 8 mapped values into 16 bytes
+static inline __m128i vtkWindowLevelPack16( __m256i first, __m256i second )
+{
+  __m128i low = _mm_packs_epi32(
+    _mm256_castsi256_si128( first ), _mm256_extracti128_si256( first, 1 ) );
+  __m128i high = _mm_packs_epi32(
+    _mm256_castsi256_si128( second ), _mm256_extracti128_si256( second, 1 ) );
+  return _mm_packus_epi16( low, high );
+}
+#endif
+
+//-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+// Maps a contiguous run of values, 16 at a time using SIMD instructions then
+// one at a time using the table
+static void vtkWindowLevelMapRun( const unsigned char *in, unsigned char *out, int count,
+                                  const unsigned char *table, float scale, float offset )
+{
+  int i = 0;
+#ifdef BIRCH_WINDOW_LEVEL_AVX2
+  const __m256 scale8 = _mm256_set1_ps( scale ), offset8 = _mm256_set1_ps( offset );
+  for( ; i + 16 <= count; i += 16 )
+  {
+    __m128i value = _mm_loadu_si128( reinterpret_cast<const __m128i*>( in + i ) );
+    __m256i first = vtkWindowLevelMap8( _mm256_cvtepu8_epi32( value ), scale8, offset8 );
+    __m256i second = vtkWindowLevelMap8(
+      _mm256_cvtepu8_epi32( _mm_srli_si128( value, 8 ) ), scale8, offset8 );
+    _mm_storeu_si128( reinterpret_cast<__m128i*>( out + i ), vtkWindowLevelPack16( first, second ) );
+  }
+#endif
+#ifdef BIRCH_WINDOW_LEVEL_SSE2
+  const __m128 scale4 = _mm_set1_ps( scale ), offset4 = _mm_set1_ps( offset );
+  const __m128i zero = _mm_setzero_si128();
+  for( ; i + 16 <= count; i += 16 )
+  {
+    __m128i value = _mm_loadu_si128( reinterpret_cast<const __m128i*>( in + i ) );
+    __m128i low = _mm_unpacklo_epi8( value, zero );
+    __m128i high = _mm_unpackhi_epi8( value, zero );
+    __m128i low16 = _mm_packs_epi32(
+      vtkWindowLevelMap4( _mm_unpacklo_epi16( low, zero ), scale4, offset4 ),
+      vtkWindowLevelMap4( _mm_unpackhi_epi16( low, zero ), scale4, offset4 ) );
+    __m128i high16 = _mm_packs_epi32(
+      vtkWindowLevelMap4( _mm_unpacklo_epi16( high, zero ), scale4, offset4 ),
+      vtkWindowLevelMap4( _mm_unpackhi_epi16( high, zero ), scale4, offset4 ) );
+    _mm_storeu_si128( reinterpret_cast<__m128i*>( out + i ), _mm_packus_epi16( low16, high16 ) );
+  }
+#endif
+  for( ; i < count; ++i ) out[i] = table[in[i]];
+}
+
+//-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+static void vtkWindowLevelMapRun( const unsigned short *in, unsigned char *out, int count,
+                                  const unsigned char *table, float scale, float offset )
+{
+  int i = 0;
+#ifdef BIRCH_WINDOW_LEVEL_AVX2
+  const __m256 scale8 = _mm256_set1_ps( scale ), offset8 = _mm256_set1_ps( offset );
+  for( ; i + 16 <= count; i += 16 )
+  {
+    __m256i first = vtkWindowLevelMap8( _mm256_cvtepu16_epi32(
+      _mm_loadu_si128( reinterpret_cast<const __m128i*>( in + i ) ) ), scale8, offset8 );
+    __m256i second = vtkWindowLevelMap8( _mm256_cvtepu16_epi32(
+      _mm_loadu_si128( reinterpret_cast<const __m128i*>( in + i + 8 ) ) ), scale8, offset8 );
+    _mm_storeu_si128( reinterpret_cast<__m128i*>( out + i ), vtkWindowLevelPack16( first, second ) );
+  }
+#endif
+#ifdef BIRCH_WINDOW_LEVEL_SSE2
+  const __m128 scale4 = _mm_set1_ps( scale ), offset4 = _mm_set1_ps( offset );
+  const __m128i zero = _mm_setzero_si128();
+  for( ; i + 16 <= count; i += 16 )
+  {
+    __m128i first = _mm_loadu_si128( reinterpret_cast<const __m128i*>( in + i ) );
+    __m128i second = _mm_loadu_si128( reinterpret_cast<const __m128i*>( in + i + 8 ) );
+    __m128i low16 = _mm_packs_epi32(
+      vtkWindowLevelMap4( _mm_unpacklo_epi16( first, zero ), scale4, offset4 ),
+      vtkWindowLevelMap4( _mm_unpackhi_epi16( first, zero ), scale4, offset4 ) );
+    __m128i high16 = _mm_packs_epi32(
+      vtkWindowLevelMap4( _mm_unpacklo_epi16( second, zero ), scale4, offset4 ),
+      vtkWindowLevelMap4( _mm_unpackhi_epi16( second, zero ), scale4, offset4 ) );
+    _mm_storeu_si128( reinterpret_cast<__m128i*>( out + i ), _mm_packus_epi16( low16, high16 ) );
+  }
+#endif
+  for( ; i < count; ++i ) out[i] = table[in[i]];
+}
+
+//-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+// Alpha is passed to the output without being window/levelled
+static inline unsigned char vtkWindowLevelAlpha( unsigned char value ) { return value; }
+static inline unsigned char vtkWindowLevelAlpha( unsigned short value )
+{
+  return static_cast<unsigned char>( value >> 8 );
+}
+
+//-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+// Maps pixels whose output layout differs from their input (e.g., luminance to RGBA)
+template <class T>
+static void vtkWindowLevelMapPixels( const T *in, unsigned char *out, int count,
+                                     int inComponents, int outFormat, int activeComponent,
+                                     bool passAlpha, const unsigned char *table )
+{
+  bool color = ( VTK_RGB == outFormat || VTK_RGBA == outFormat ) && 3 <= inComponents;
+  for( int i = 0; i < count; ++i )
+  {
+    unsigned char value = table[in[color ? 0 : activeComponent]];
+    switch( outFormat )
+    {
+      case VTK_LUMINANCE:
+        *out++ = value;
+        break;
+      case VTK_LUMINANCE_ALPHA:
+        *out++ = value;
+        *out++ = 255;
+        break;
+      case VTK_RGB:
+      case VTK_RGBA:
+        *out++ = value;
+        *out++ = color ? table[in[1]] : value;
+        *out++ = color ? table[in[2]] : value;
+        if( VTK_RGBA == outFormat )
+          *out++ = passAlpha && 4 <= inComponents ? vtkWindowLevelAlpha( in[3] ) : 255;
+        break;
+    }
+    in += inComponents;
+  }
+}
+
+//-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+template <class T>
+static void vtkWindowLevelExecute( vtkBirchImageMapToWindowLevelColors *self,
+                                   vtkImageData *inData, T *inPtr,
+                                   vtkImageData *outData, unsigned char *outPtr,
+                                   int outExt[6], const unsigned char *table )
+{
+  float scale, offset;
+  vtkWindowLevelScaleOffset( self->GetWindow(), self->GetLevel(), scale, offset );
+  int inComponents = inData->GetNumberOfScalarComponents();
+  int outComponents = outData->GetNumberOfScalarComponents();
+  int outFormat = self->GetOutputFormat();
+  int activeComponent = self->GetActiveComponent();
+  if( activeComponent < 0 || activeComponent >= inComponents ) activeComponent = 0;
+  bool passAlpha = 0 != self->GetPassAlphaToOutput();
+
+  // grayscale to luminance and RGB to RGB rows are mapped value by value
+  bool run = ( VTK_LUMINANCE == outFormat && 1 == inComponents ) ||
+             ( VTK_RGB == outFormat && 3 == inComponents );
+
+  vtkIdType inIncX, inIncY, inIncZ, outIncX, outIncY, outIncZ; // only Y and Z are used
+  inData->GetContinuousIncrements( outExt, inIncX, inIncY, inIncZ );
+  outData->GetContinuousIncrements( outExt, outIncX, outIncY, outIncZ );
+  int width = outExt[1] - outExt[0] + 1;
+
+  for( int z = outExt[4]; z <= outExt[5]; ++z )
+  {
+    for( int y = outExt[2]; y <= outExt[3]; ++y )
+    {
+      if( run )
+      {
+        vtkWindowLevelMapRun( inPtr, outPtr, width * inComponents, table, scale, offset );
+      }
+      else
+      {
+        vtkWindowLevelMapPixels(
+          inPtr, outPtr, width, inComponents, outFormat, activeComponent, passAlpha, table );
+      }
+      inPtr += width * inComponents + inIncY;
+      outPtr += width * outComponents + outIncY;
+    }
+    inPtr += inIncZ;
+    outPtr += outIncZ;
+  }
+}
+
+//-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+vtkBirchImageMapToWindowLevelColors::vtkBirchImageMapToWindowLevelColors()
+{
+  this->TableScalarType = -1;
+  this->TableWindow = 0.0;
+  this->TableLevel = 0.0;
+  this->ThreadPool = new vtkBirchWindowLevelThreadPool;
+}
+
+//-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+vtkBirchImageMapToWindowLevelColors::~vtkBirchImageMapToWindowLevelColors()
+{
+  delete this->ThreadPool;
+}
+
+//-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+bool vtkBirchImageMapToWindowLevelColors::IsFastScalarType( int scalarType )
+{
+  return VTK_UNSIGNED_CHAR == scalarType || VTK_UNSIGNED_SHORT == scalarType;
+}
+
+//-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+const char* vtkBirchImageMapToWindowLevelColors::GetInstructionSet()
+{
+#if defined( BIRCH_WINDOW_LEVEL_AVX2 )
+  return "AVX2";
+#elif defined( BIRCH_WINDOW_LEVEL_SSE2 )
+  return "SSE2";
+#else
+  return "scalar";
+#endif
+}
+
+//-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+int vtkBirchImageMapToWindowLevelColors::RequestData(
+  vtkInformation *request,
+  vtkInformationVector **inputVector,
+  vtkInformationVector *outputVector )
+{
+  // the table is computed here, once per window/level change, since the
+  // threaded part of the execution may only read it
+  vtkImageData *inData = vtkImageData::SafeDownCast(
+    inputVector[0]->GetInformationObject( 0 )->Get( vtkDataObject::DATA_OBJECT() ) );
+  int scalarType = inData ? inData->GetScalarType() : -1;
+  if( !this->LookupTable &&
+      vtkBirchImageMapToWindowLevelColors::IsFastScalarType( scalarType ) &&
+      ( scalarType != this->TableScalarType ||
+        this->Window != this->TableWindow || this->Level != this->TableLevel ) )
+  {
+    float scale, offset;
+    vtkWindowLevelScaleOffset( this->Window, this->Level, scale, offset );
+    int size = VTK_UNSIGNED_CHAR == scalarType ? VTK_UNSIGNED_CHAR_MAX + 1 : VTK_UNSIGNED_SHORT_MAX + 1;
+    this->Table.resize( size );
+    for( int i = 0; i < size; ++i )
+      this->Table[i] = vtkWindowLevelMapValue( static_cast<float>( i ), scale, offset );
+
+    this->TableScalarType = scalarType;
+    this->TableWindow = this->Window;
+    this->TableLevel = this->Level;
+  }
+
+  // the superclass passes the input through unchanged at the default window/level
+  if( !this->UseKernel( inData ) ||
+      ( VTK_UNSIGNED_CHAR == scalarType && 255 == this->Window && 127.5 == this->Level ) )
+    return this->Superclass::RequestData( request, inputVector, outputVector );
+
+  vtkInformation *outInfo = outputVector->GetInformationObject( 0 );
+  vtkImageData *outData = vtkImageData::SafeDownCast( outInfo->Get( vtkDataObject::DATA_OBJECT() ) );
+  if( this->DataWasPassed )
+  {
+    outData->GetPointData()->SetScalars( NULL );
+    this->DataWasPassed = 0;
+  }
+
+  vtkWindowLevelSlabs slabs;
+  outInfo->Get( vtkStreamingDemandDrivenPipeline::UPDATE_EXTENT(), slabs.Extent );
+  this->AllocateOutputData( outData, slabs.Extent );
+  this->CopyAttributeData( inData, outData, inputVector );
+
+  // split into slabs along the outermost axis, no more than one per thread
+  slabs.Filter = this;
+  slabs.InData = inData;
+  slabs.OutData = outData;
+  slabs.Axis = slabs.Extent[5] > slabs.Extent[4] ? 2 : 1;
+  int length = slabs.Extent[2 * slabs.Axis + 1] - slabs.Extent[2 * slabs.Axis] + 1;
+  vtkIdType slabSize = static_cast<vtkIdType>( slabs.Extent[1] - slabs.Extent[0] + 1 ) *
+    ( 2 == slabs.Axis ? slabs.Extent[3] - slabs.Extent[2] + 1 : 1 );
+  vtkIdType minimumLength = vtkWindowLevelMinimumSlabSize / ( 0 < slabSize ? slabSize : 1 ) + 1;
+  slabs.NumberOfSlabs = static_cast<int>( length / minimumLength );
+  if( slabs.NumberOfSlabs > this->NumberOfThreads ) slabs.NumberOfSlabs = this->NumberOfThreads;
+  if( 1 > slabs.NumberOfSlabs ) slabs.NumberOfSlabs = 1;
+
+  if( 1 == slabs.NumberOfSlabs ) this->MapExtent( inData, outData, slabs.Extent );
+  else this->ThreadPool->Execute(
+    this->NumberOfThreads, slabs.NumberOfSlabs, vtkBirchImageMapToWindowLevelColors::MapSlab, &slabs );
+
+  return 1;
+}
+
+//-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+void vtkBirchImageMapToWindowLevelColors::MapSlab( void *data, int slab )
+{
+  vtkWindowLevelSlabs *slabs = static_cast<vtkWindowLevelSlabs*>( data );
+  int extent[6];
+  for( int i = 0; i < 6; ++i ) extent[i] = slabs->Extent[i];
+
+  int min = slabs->Extent[2 * slabs->Axis];
+  int length = slabs->Extent[2 * slabs->Axis + 1] - min + 1;
+  extent[2 * slabs->Axis] = min + slab * length / slabs->NumberOfSlabs;
+  extent[2 * slabs->Axis + 1] = min + ( slab + 1 ) * length / slabs->NumberOfSlabs - 1;
+  slabs->Filter->MapExtent( slabs->InData, slabs->OutData, extent );
+}
+
+//-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+bool vtkBirchImageMapToWindowLevelColors::UseKernel( vtkImageData *inData )
+{
+  int scalarType = inData ? inData->GetScalarType() : -1;
+  return !this->LookupTable && scalarType == this->TableScalarType &&
+         vtkBirchImageMapToWindowLevelColors::IsFastScalarType( scalarType );
+}
+
+//-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+void vtkBirchImageMapToWindowLevelColors::ThreadedRequestData(
+  vtkInformation *request,
+  vtkInformationVector **inputVector,
+  vtkInformationVector *outputVector,
+  vtkImageData ***inData, vtkImageData **outData,
+  int outExt[6], int id )
+{
+  if( !this->UseKernel( inData[0][0] ) )
+  {
+    this->Superclass::ThreadedRequestData(
+      request, inputVector, outputVector, inData, outData, outExt, id );
+    return;
+  }
+
+  this->MapExtent( inData[0][0], outData[0], outExt );
+}
+
+//-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+void vtkBirchImageMapToWindowLevelColors::MapExtent(
+  vtkImageData *inData, vtkImageData *outData, int extent[6] )
+{
+  void *inPtr = inData->GetScalarPointerForExtent( extent );
+  unsigned char *outPtr = static_cast<unsigned char*>( outData->GetScalarPointerForExtent( extent ) );
+
+  if( VTK_UNSIGNED_CHAR == inData->GetScalarType() )
+  {
+    vtkWindowLevelExecute( this, inData, static_cast<unsigned char*>( inPtr ),
+                           outData, outPtr, extent, &this->Table[0] );
+  }
+  else
+  {
+    vtkWindowLevelExecute( this, inData, static_cast<unsigned short*>( inPtr ),
+                           outData, outPtr, extent, &this->Table[0] );
+  }
+}
+
+//-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+void vtkBirchImageMapToWindowLevelColors::PrintSelf( ostream& os, vtkIndent indent )
+{
+  this->Superclass::PrintSelf( os, indent );
+  os << indent << "InstructionSet: "
+     << vtkBirchImageMapToWindowLevelColors::GetInstructionSet() << endl;
+}
@@ -0,0 +1,111 @@
+/*=======================================================================
+
+  Module:    vtkBirchImageMapToWindowLevelColors.h
+  Program:   Birch (CLSA Retinal Image Viewer)
+  Language:  C++
+  Author:    Patrick Emond <emondpd@mcmaster.ca>
+  Author:    Dean Inglis <inglisd@mcmaster.ca>
+
+=========================================================================*/
+
+/**
+ * @class vtkBirchImageMapToWindowLevelColors
+ *
+ * @author Patrick Emond <emondpd@mcmaster.ca>
+ * @author Dean Inglis <inglisd@mcmaster.ca>
+ *
+ * @brief Fast window/level mapping of 8 and 16 bit images.
+ *
+ * vtkBirchImageMapToWindowLevelColors maps unsigned char and unsigned short
+ * images without a lookup table using a dedicated kernel.  A table holding the
+ * mapped value of every possible input value is computed once per window/level
+ * change, and rows of grayscale or RGB pixels are mapped using SSE2 (or AVX2
+ * when compiled with AVX2 support) instructions with the table handling the
+ * remaining pixels.  All other inputs are mapped by the superclass.
+ *
+ * Images mapped by the kernel are split into slabs of rows (or slices for
+ * volumes) which are mapped in parallel by a pool of threads kept alive
+ * between updates, avoiding the cost of creating threads on every
+ * window/level change.  The number of threads is set using
+ * SetNumberOfThreads() and defaults to the number of processors.
+ *
+ * Unlike the superclass each colour component of an RGB or RGBA input is
+ * window/levelled, rather than only the first one.  Values are computed in
+ * single precision so they may differ from the superclass's by one.
+ *
+ * @see vtkImageMapToWindowLevelColors
+ */
+#ifndef __vtkBirchImageMapToWindowLevelColors_h
+#define __vtkBirchImageMapToWindowLevelColors_h
+
+#include "vtkImageMapToWindowLevelColors.h"
+
+#include <vector>
+
+class vtkBirchWindowLevelThreadPool;
+
+class vtkBirchImageMapToWindowLevelColors : public vtkImageMapToWindowLevelColors
+{
+public:
+  static vtkBirchImageMapToWindowLevelColors *New();
+  vtkTypeMacro( vtkBirchImageMapToWindowLevelColors, vtkImageMapToWindowLevelColors );
+  void PrintSelf( ostream& os, vtkIndent indent );
+
+  /**
+   * Get whether an image of the given scalar type is mapped by the dedicated
+   * kernel (provided that no lookup table is set).
+   * @param scalarType VTK scalar type (e.g., VTK_UNSIGNED_SHORT)
+   */
+  static bool IsFastScalarType( int scalarType );
+
+  /**
+   * Get the name of the instruction set used by the kernel ("AVX2", "SSE2" or
+   * "scalar").
+   */
+  static const char* GetInstructionSet();
+
+protected:
+  vtkBirchImageMapToWindowLevelColors();
+  ~vtkBirchImageMapToWindowLevelColors();
+
+  /**
+   * Computes the table for the current window/level then maps the image in
+   * slabs using the thread pool, or using the superclass if the kernel can't
+   * be used.
+   */
+  virtual int RequestData( vtkInformation *request,
+                           vtkInformationVector **inputVector,
+                           vtkInformationVector *outputVector );
+
+  /** Maps the extent of one thread, using the dedicated kernel if possible. */
+  void ThreadedRequestData( vtkInformation *request,
+                            vtkInformationVector **inputVector,
+                            vtkInformationVector *outputVector,
+                            vtkImageData ***inData, vtkImageData **outData,
+                            int extent[6], int id );
+
+  /** Maps an extent using the dedicated kernel (the table must be up to date). */
+  void MapExtent( vtkImageData *inData, vtkImageData *outData, int extent[6] );
+
+  /** Maps one slab of the image being mapped by the thread pool. */
+  static void MapSlab( void *data, int slab );
+
+  /** Returns whether the dedicated kernel can map the given input. */
+  bool UseKernel( vtkImageData *inData );
+
+  vtkBirchWindowLevelThreadPool *ThreadPool;
+
+  //@{
+  /** Mapped value of every input value (see RequestData) */
+  std::vector<unsigned char> Table;
+  int TableScalarType;
+  double TableWindow;
+  double TableLevel;
+  //@}
+
+private:
+  vtkBirchImageMapToWindowLevelColors( const vtkBirchImageMapToWindowLevelColors& );  // Not implemented.
+  void operator=( const vtkBirchImageMapToWindowLevelColors& );  // Not implemented.
+};
+
+#endif
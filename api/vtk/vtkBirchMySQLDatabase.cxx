@@ -237,6 +237,24 @@ bool vtkBirchMySQLDatabase::IsOpen()
   return (this->Private->Connection != NULL);
 }
 
+// ----------------------------------------------------------------------
+unsigned long vtkBirchMySQLDatabase::GetConnectionId()
+{
+  return this->IsOpen() ? mysql_thread_id( this->Private->Connection ) : 0;
+}
+
+// ----------------------------------------------------------------------
+void vtkBirchMySQLDatabase::ThreadInitialize()
+{
+  mysql_thread_init();
+}
+
+// ----------------------------------------------------------------------
+void vtkBirchMySQLDatabase::ThreadFinalize()
+{
+  mysql_thread_end();
+}
+
 // ----------------------------------------------------------------------
 vtkSQLQuery* vtkBirchMySQLDatabase::GetQueryInstance()
 {
@@ -67,6 +67,18 @@ public:
   // Return whether the database has an open connection
   bool IsOpen();
 
+  // Description:
+  // Return the server's id of the open connection (0 if it isn't open).
+  // The id is kept by the client library when it connects (or reconnects)
+  // so no statement is sent to the server.
+  unsigned long GetConnectionId();
+
+  // Description:
+  // Must be called by every thread (other than the main thread) before it
+  // opens a connection, and ThreadFinalize() before the thread exits.
+  static void ThreadInitialize();
+  static void ThreadFinalize();
+
   // Description:
   // Return an empty query on this database.
   vtkSQLQuery* GetQueryInstance();
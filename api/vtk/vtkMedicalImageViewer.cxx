@@ -10,22 +10,93 @@
 =========================================================================*/
 #include "vtkMedicalImageViewer.h"
 
+#include "vtkBirchDefaultWindowLevel.h"
+#include "vtkBirchImageMapToWindowLevelColors.h"
 #include "vtkCamera.h"
 #include "vtkCommand.h"
 #include "vtkGDCMImageReader.h"
 #include "vtkImageActor.h"
 #include "vtkImageData.h"
 #include "vtkImageMapToWindowLevelColors.h"
+#include "vtkImageShrink3D.h"
 #include "vtkImageSinusoidSource.h"
 #include "vtkImageSliceMapper.h"
 #include "vtkInteractorStyleImage.h"
+#include "vtkJPEGReader.h"
 #include "vtkObjectFactory.h"
+#include "vtkPNGReader.h"
 #include "vtkRenderer.h"
 #include "vtkRenderWindow.h"
 #include "vtkRenderWindowInteractor.h"
+#include "vtkTextActor.h"
+#include "vtkTextProperty.h"
+#include "vtkTimerLog.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+extern "C" {
+#include <vtk_jpeg.h>
+#include <setjmp.h>
+}
 
 vtkStandardNewMacro( vtkMedicalImageViewer );
 
+// number of recent frame times kept for the cine playback percentiles
+static const int vtkMedicalImageViewerCineFrameHistory = 1000;
+
+//-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+// Image reader registry: the reader used to decode a file is chosen by matching
+// the file's leading bytes with the signature of each format
+static vtkImageReader2* vtkNewJPEGReader() { return vtkJPEGReader::New(); }
+static vtkImageReader2* vtkNewPNGReader() { return vtkPNGReader::New(); }
+static vtkImageReader2* vtkNewGDCMReader() { return vtkGDCMImageReader::New(); }
+
+struct vtkMedicalImageFormat
+{
+  int Format;
+  const char *Name;
+  unsigned int Offset;         /**< Position of the signature in the file */
+  unsigned int Length;         /**< Length of the signature */
+  const char *Signature;
+  vtkImageReader2* (*NewReader)();
+};
+
+static const vtkMedicalImageFormat vtkMedicalImageFormats[] =
+{
+  { vtkMedicalImageViewer::FORMAT_JPEG, "JPEG", 0, 3, "\xFF\xD8\xFF", vtkNewJPEGReader },
+  { vtkMedicalImageViewer::FORMAT_PNG, "PNG", 0, 8, "\x89PNG\r\n\x1A\n", vtkNewPNGReader },
+  { vtkMedicalImageViewer::FORMAT_DICOM, "DICOM", 128, 4, "DICM", vtkNewGDCMReader }
+};
+
+static const int vtkNumberOfMedicalImageFormats =
+  sizeof( vtkMedicalImageFormats ) / sizeof( vtkMedicalImageFormat );
+
+// the number of leading bytes needed to recognize every format
+static const unsigned int vtkMedicalImageSignatureSize = 132;
+
+//-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+// libjpeg exits the program on fatal errors unless error_exit jumps back out
+struct vtkMedicalImageJPEGError
+{
+  struct jpeg_error_mgr pub;
+  jmp_buf setjmp_buffer;
+};
+
+extern "C" void vtkMedicalImageJPEGErrorExit( j_common_ptr cinfo )
+{
+  vtkMedicalImageJPEGError *error = reinterpret_cast< vtkMedicalImageJPEGError* >( cinfo->err );
+  longjmp( error->setjmp_buffer, 1 );
+}
+
+extern "C" void vtkMedicalImageJPEGOutputMessage( j_common_ptr vtkNotUsed( cinfo ) )
+{
+  // warnings about corrupt data are not reported, the preview is disposable
+}
+
 //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
 class vtkWindowLevelCallback : public vtkCommand
 {
@@ -57,18 +128,135 @@ public:
   vtkMedicalImageViewer* Viewer;
 };
 
+//-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+class vtkCineCallback : public vtkCommand
+{
+public:
+  static vtkCineCallback *New() { return new vtkCineCallback; }
+
+  void Execute( vtkObject *vtkNotUsed( caller ), unsigned long vtkNotUsed( event ),
+                void *callData )
+  {
+    // the interactor's other timers are ignored
+    if( this->Viewer && callData && this->TimerId == *static_cast<int*>( callData ) )
+      this->Viewer->CineUpdate();
+  }
+
+  vtkCineCallback():Viewer( 0 ), TimerId( 0 ){}
+  ~vtkCineCallback(){ this->Viewer = NULL; }
+
+  vtkMedicalImageViewer* Viewer;
+  int TimerId;
+};
+
+//-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+class vtkRenderRequestCallback : public vtkCommand
+{
+public:
+  static vtkRenderRequestCallback *New() { return new vtkRenderRequestCallback; }
+
+  void Execute( vtkObject *vtkNotUsed( caller ), unsigned long vtkNotUsed( event ),
+                void *callData )
+  {
+    // the interactor's other timers are ignored
+    if( this->Viewer && callData && this->TimerId == *static_cast<int*>( callData ) )
+      this->Viewer->ProcessRenderRequest();
+  }
+
+  vtkRenderRequestCallback():Viewer( 0 ), TimerId( 0 ){}
+  ~vtkRenderRequestCallback(){ this->Viewer = NULL; }
+
+  vtkMedicalImageViewer* Viewer;
+  int TimerId;
+};
+
+//-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+class vtkPyramidCallback : public vtkCommand
+{
+public:
+  static vtkPyramidCallback *New() { return new vtkPyramidCallback; }
+
+  void Execute( vtkObject *caller, unsigned long event,
+                void *vtkNotUsed( callData ) )
+  {
+    if( !this->Viewer ) return;
+    if( vtkCommand::StartEvent == event )
+    {
+      this->Viewer->UpdatePyramidExtent( true );
+    }
+    else if( vtkCommand::CharEvent == event )
+    {
+      // the interactor style resets the camera to the bounds of the displayed
+      // tiles, so display the whole level first
+      vtkRenderWindowInteractor *rwi = static_cast<vtkRenderWindowInteractor*>( caller );
+      char code = rwi->GetKeyCode();
+      if( ( 'r' == code || 'R' == code ) && ( rwi->GetShiftKey() || rwi->GetControlKey() ) )
+        this->Viewer->UpdatePyramidExtent( false );
+    }
+  }
+
+  vtkPyramidCallback():Viewer( 0 ){}
+  ~vtkPyramidCallback(){ this->Viewer = NULL; }
+
+  vtkMedicalImageViewer* Viewer;
+};
+
 //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
 vtkMedicalImageViewer::vtkMedicalImageViewer()
 {
   this->RenderWindow    = NULL;
   this->Renderer        = NULL;
   this->ImageActor      = vtkImageActor::New();
-  this->WindowLevel     = vtkImageMapToWindowLevelColors::New();
+  this->WindowLevel     = vtkBirchImageMapToWindowLevelColors::New();
   this->Interactor      = NULL;
   this->InteractorStyle = NULL;
+  this->Input           = NULL;
+
+  this->TileSize = 512;
+  this->PyramidLevel = 0;
+  this->RenderCallbackTag = 0;
+  this->CharCallbackTag = 0;
+  this->PipelineInstalled = false;
+
+  this->MessageActor = vtkTextActor::New();
+  this->MessageActor->GetPositionCoordinate()->SetCoordinateSystemToNormalizedViewport();
+  this->MessageActor->SetPosition( 0.5, 0.5 );
+  this->MessageActor->GetTextProperty()->SetJustificationToCentered();
+  this->MessageActor->GetTextProperty()->SetVerticalJustificationToCentered();
+  this->MessageActor->GetTextProperty()->SetFontSize( 18 );
+  this->MessageActor->VisibilityOff();
 
   this->PlayEvent = vtkCommand::UserEvent + 100;
   this->StopEvent = vtkCommand::UserEvent + 101;
+  this->CineStatisticsEvent = vtkCommand::UserEvent + 102;
+  this->CineState = vtkMedicalImageViewer::STOP;
+  this->CineFrameRate = 25.0;
+  this->CineLoopSlices = false;
+  this->CineTimerId = 0;
+  this->CineTimerCallbackTag = 0;
+  this->CineStartSlice = 0;
+  this->CineFrame = 0;
+  this->CineDroppedFrames = 0;
+  this->CineFrameTimeCount = 0;
+  this->CineStartTime = 0.0;
+  this->CineLastFrameTime = 0.0;
+  this->CineLastReportTime = 0.0;
+
+  this->SliceWindowLevel = vtkBirchImageMapToWindowLevelColors::New();
+  this->SliceCacheMemorySize = 0;
+  this->SliceCacheTime = 0;
+  this->SliceCacheMemoryLimit = 64;
+  this->SliceCacheReadAhead = 2;
+  this->SliceCacheDirection = 0;
+
+  this->RenderPending = false;
+  this->RenderTimerId = 0;
+  this->RenderTimerCallbackTag = 0;
+  this->MaximumRenderRate = 60.0;
+  this->LastRenderTime = 0.0;
+  this->NumberOfRenderRequests = 0;
+  this->NumberOfCoalescedRenders = 0;
+  this->NumberOfRenders = 0;
   
   this->MaintainLastWindowLevel = 0;
   this->OriginalWindow = 255.0;
@@ -106,13 +294,27 @@ vtkMedicalImageViewer::vtkMedicalImageViewer()
   vtkRenderer *ren = vtkRenderer::New();
   this->SetRenderer( ren );
   ren->Delete();
-
-  this->CineState = vtkMedicalImageViewer::STOP;
 }
 
 //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
 vtkMedicalImageViewer::~vtkMedicalImageViewer()
 {
+  this->CineStopTimer();
+  this->CancelRenderRequest();
+  this->ClearPyramid();
+  this->ClearSliceCache();
+  if( this->SliceWindowLevel )
+  {
+    this->SliceWindowLevel->Delete();
+    this->SliceWindowLevel = NULL;
+  }
+
+  if( this->Input )
+  {
+    this->Input->UnRegister( this );
+    this->Input = NULL;
+  }
+
   if( this->WindowLevel )
   {
     this->WindowLevel->Delete();
@@ -125,6 +327,12 @@ vtkMedicalImageViewer::~vtkMedicalImageViewer()
     this->ImageActor = NULL;
   }
 
+  if( this->MessageActor )
+  {
+    this->MessageActor->Delete();
+    this->MessageActor = NULL;
+  }
+
   if( this->Renderer )
   {
     this->Renderer->Delete();
@@ -153,11 +361,40 @@ vtkMedicalImageViewer::~vtkMedicalImageViewer()
 //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
 void vtkMedicalImageViewer::SetInput( vtkImageData* input )
 {
-  this->UnInstallPipeline();
-  if( !input ) return;
-  
+  this->SetInput( input, std::vector<vtkImageData*>() );
+}
+
+//-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+void vtkMedicalImageViewer::SetInput( vtkImageData* input, const std::vector<vtkImageData*>& pyramid )
+{
+  if( !input )
+  {
+    this->UnInstallPipeline();
+    return;
+  }
+
+  this->MessageActor->VisibilityOff();
+  this->ImageActor->VisibilityOn();
+
+  if( input != this->Input )
+  {
+    this->ClearPyramid();
+    input->Register( this );
+    if( this->Input ) this->Input->UnRegister( this );
+    this->Input = input;
+  }
+
+  // adopt prebuilt levels the viewer doesn't have yet
+  for( size_t i = this->Pyramid.size(); i < pyramid.size(); ++i )
+  {
+    pyramid[i]->Register( this );
+    this->Pyramid.push_back( pyramid[i] );
+  }
+  this->ClearSliceCache();
   this->WindowLevel->SetInputConnection( input->GetProducerPort() );
-  this->ImageActor->SetInput( this->WindowLevel->GetOutput() );
+  this->PyramidLevel = 0;
+  if( this->ImageActor->GetInput() != this->WindowLevel->GetOutput() )
+    this->ImageActor->SetInput( this->WindowLevel->GetOutput() );
 
   input->Update();
   int components = input->GetNumberOfScalarComponents();
@@ -172,32 +409,173 @@ void vtkMedicalImageViewer::SetInput( vtkImageData* input )
   this->InitializeWindowLevel();
   this->InitializeCameraViews();
 
-  this->InstallPipeline();
+  // the pipeline is only rebuilt if it was dismantled by a NULL input
+  if( !this->PipelineInstalled ) this->InstallPipeline();
   this->UpdateDisplayExtent();
-  this->Render(); 
+  this->RequestRender();
 }
 
 //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
 bool vtkMedicalImageViewer::Load( std::string fileName )
 {
-  bool success = false;
-  vtkGDCMImageReader* reader = vtkGDCMImageReader::New();
-  if( reader->CanReadFile( fileName.c_str() ) )
+  vtkImageData* image = vtkImageData::New();
+  bool success = vtkMedicalImageViewer::ReadImage( fileName, image );
+  if( success ) this->SetInput( image );
+  image->Delete();
+
+  return success;
+}
+
+//-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+void vtkMedicalImageViewer::SetMessage( std::string message )
+{
+  bool show = !message.empty();
+  this->MessageActor->SetInput( message.c_str() );
+  this->MessageActor->SetVisibility( show );
+  this->ImageActor->SetVisibility( !show );
+  this->Render();
+}
+
+//-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+bool vtkMedicalImageViewer::ReadImage( std::string fileName, vtkImageData* output )
+{
+  if( !output ) return false;
+
+  vtkImageReader2* reader = vtkMedicalImageViewer::CreateReader( fileName );
+  if( !reader ) return false;
+
+  reader->SetFileName( fileName.c_str() );
+  reader->Update();
+
+  // corrupt files may produce an empty image rather than an error
+  bool success = 0 < reader->GetOutput()->GetNumberOfPoints();
+  if( success ) output->ShallowCopy( reader->GetOutput() );
+  reader->Delete();
+
+  return success;
+}
+
+//-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+bool vtkMedicalImageViewer::ReadPreviewImage(
+  std::string fileName, vtkImageData* output, int shrinkFactor )
+{
+  if( !output ) return false;
+  if( 2 != shrinkFactor && 4 != shrinkFactor && 8 != shrinkFactor ) return false;
+  if( vtkMedicalImageViewer::FORMAT_JPEG != vtkMedicalImageViewer::GetFileFormat( fileName ) )
+    return false;
+
+  FILE *file = fopen( fileName.c_str(), "rb" );
+  if( !file ) return false;
+
+  // nothing which needs destroying may be created between here and the last libjpeg call
+  struct jpeg_decompress_struct cinfo;
+  vtkMedicalImageJPEGError error;
+  cinfo.err = jpeg_std_error( &error.pub );
+  error.pub.error_exit = vtkMedicalImageJPEGErrorExit;
+  error.pub.output_message = vtkMedicalImageJPEGOutputMessage;
+  if( setjmp( error.setjmp_buffer ) )
+  {
+    jpeg_destroy_decompress( &cinfo );
+    fclose( file );
+    return false;
+  }
+
+  jpeg_create_decompress( &cinfo );
+  jpeg_stdio_src( &cinfo, file );
+  jpeg_read_header( &cinfo, TRUE );
+
+  // only grayscale and colour images are displayed the same way the full image is
+  if( 1 != cinfo.num_components && 3 != cinfo.num_components )
+  {
+    jpeg_destroy_decompress( &cinfo );
+    fclose( file );
+    return false;
+  }
+
+  cinfo.scale_num = 1;
+  cinfo.scale_denom = shrinkFactor;
+  cinfo.dct_method = JDCT_IFAST;
+  cinfo.do_fancy_upsampling = FALSE;
+  jpeg_start_decompress( &cinfo );
+
+  int width = cinfo.output_width;
+  int height = cinfo.output_height;
+  int components = cinfo.output_components;
+
+  // each preview pixel is centered on the block of full resolution pixels it covers
+  double offset = 0.5 * ( shrinkFactor - 1 );
+  output->Initialize();
+  output->SetDimensions( width, height, 1 );
+  output->SetWholeExtent( 0, width - 1, 0, height - 1, 0, 0 );
+  output->SetSpacing( shrinkFactor, shrinkFactor, 1.0 );
+  output->SetOrigin( offset, offset, 0.0 );
+  output->SetScalarTypeToUnsignedChar();
+  output->SetNumberOfScalarComponents( components );
+  output->AllocateScalars();
+
+  // VTK images start with the bottom row
+  unsigned char *pixels = static_cast< unsigned char* >( output->GetScalarPointer() );
+  while( cinfo.output_scanline < cinfo.output_height )
+  {
+    JSAMPROW row = pixels + ( height - 1 - cinfo.output_scanline ) * width * components;
+    jpeg_read_scanlines( &cinfo, &row, 1 );
+  }
+
+  jpeg_finish_decompress( &cinfo );
+  jpeg_destroy_decompress( &cinfo );
+  fclose( file );
+
+  return true;
+}
+
+//-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+int vtkMedicalImageViewer::GetFileFormat( std::string fileName )
+{
+  char buffer[vtkMedicalImageSignatureSize];
+  std::ifstream file( fileName.c_str(), std::ios::in | std::ios::binary );
+  if( !file.is_open() ) return vtkMedicalImageViewer::FORMAT_UNKNOWN;
+  file.read( buffer, vtkMedicalImageSignatureSize );
+  unsigned int size = static_cast< unsigned int >( file.gcount() );
+
+  for( int i = 0; i < vtkNumberOfMedicalImageFormats; ++i )
   {
-    reader->SetFileName( fileName.c_str() );
-    reader->Update();
-    this->SetInput( reader->GetOutput() );
-    success = true;
+    const vtkMedicalImageFormat &format = vtkMedicalImageFormats[i];
+    if( format.Offset + format.Length <= size &&
+        0 == memcmp( buffer + format.Offset, format.Signature, format.Length ) )
+      return format.Format;
   }
+
+  return vtkMedicalImageViewer::FORMAT_UNKNOWN;
+}
+
+//-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+const char* vtkMedicalImageViewer::GetFileFormatName( int format )
+{
+  for( int i = 0; i < vtkNumberOfMedicalImageFormats; ++i )
+    if( format == vtkMedicalImageFormats[i].Format ) return vtkMedicalImageFormats[i].Name;
+
+  return "unknown";
+}
+
+//-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+vtkImageReader2* vtkMedicalImageViewer::CreateReader( std::string fileName )
+{
+  int format = vtkMedicalImageViewer::GetFileFormat( fileName );
+  for( int i = 0; i < vtkNumberOfMedicalImageFormats; ++i )
+    if( format == vtkMedicalImageFormats[i].Format ) return vtkMedicalImageFormats[i].NewReader();
+
+  // DICOM files need not have a preamble, let GDCM decide whether it can read the file
+  vtkGDCMImageReader* reader = vtkGDCMImageReader::New();
+  if( reader->CanReadFile( fileName.c_str() ) ) return reader;
   reader->Delete();
 
-  return success;
+  return NULL;
 }
 
 //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
 vtkImageData* vtkMedicalImageViewer::GetInput()
 {
-  return vtkImageData::SafeDownCast( this->WindowLevel->GetInput() );
+  return this->Input;
 }
 
 //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
@@ -206,6 +584,7 @@ void vtkMedicalImageViewer::SetMappingToLuminance()
   this->WindowLevel->SetActiveComponent( 0 );
   this->WindowLevel->PassAlphaToOutputOff();
   this->WindowLevel->SetOutputFormatToLuminance();
+  this->ClearSliceCache();
   this->WindowLevel->Modified();
 }
 
@@ -214,6 +593,7 @@ void vtkMedicalImageViewer::SetMappingToColor()
 {
   this->WindowLevel->SetOutputFormatToRGB();
   this->WindowLevel->PassAlphaToOutputOff();
+  this->ClearSliceCache();
   this->WindowLevel->Modified();
 }
 
@@ -222,6 +602,7 @@ void vtkMedicalImageViewer::SetMappingToColorAlpha()
 {
   this->WindowLevel->SetOutputFormatToRGBA();
   this->WindowLevel->PassAlphaToOutputOn();
+  this->ClearSliceCache();
   this->WindowLevel->Modified();
 }
 
@@ -287,6 +668,10 @@ void vtkMedicalImageViewer::SetRenderer( vtkRenderer *arg )
 //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
 void vtkMedicalImageViewer::InstallPipeline()
 {
+  // observers must not be added twice
+  if( this->PipelineInstalled ) this->UnInstallPipeline();
+  this->PipelineInstalled = true;
+
   // setup the render window
   if( this->RenderWindow && this->Renderer )
     this->RenderWindow->AddRenderer( this->Renderer );
@@ -325,12 +710,25 @@ void vtkMedicalImageViewer::InstallPipeline()
   {
     this->Renderer->GetActiveCamera()->ParallelProjectionOn();
     this->Renderer->AddViewProp( this->ImageActor );
+    this->Renderer->AddViewProp( this->MessageActor );
+
+    // choose the pyramid level and tiles to display before every render
+    vtkPyramidCallback *cbk = vtkPyramidCallback::New();
+    cbk->Viewer = this;
+    this->RenderCallbackTag = this->Renderer->AddObserver( vtkCommand::StartEvent, cbk );
+    if( this->Interactor )
+      this->CharCallbackTag = this->Interactor->AddObserver( vtkCommand::CharEvent, cbk, 1.0 );
+    cbk->Delete();
   }
 }
 
 //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
 void vtkMedicalImageViewer::UnInstallPipeline()
 {
+  // the cine and render timers belong to the interactor
+  if( vtkMedicalImageViewer::PLAY == this->CineState ) this->CineStop();
+  this->CancelRenderRequest();
+
   if( this->InteractorStyle && !this->WindowLevelCallbackTags.empty() )
   {
     std::vector<unsigned long>::iterator it;
@@ -341,12 +739,23 @@ void vtkMedicalImageViewer::UnInstallPipeline()
       this->InteractorStyle->RemoveObserver( ( *it ) );
     }  
   }
+  this->WindowLevelCallbackTags.clear();
+  this->PipelineInstalled = false;
 
   if( this->RenderWindow && this->Renderer )
     this->RenderWindow->RemoveRenderer( this->Renderer );
 
   if( this->Renderer )
+  {
     this->Renderer->RemoveViewProp( this->ImageActor );
+    this->Renderer->RemoveViewProp( this->MessageActor );
+    if( this->RenderCallbackTag ) this->Renderer->RemoveObserver( this->RenderCallbackTag );
+  }
+  this->RenderCallbackTag = 0;
+
+  if( this->Interactor && this->CharCallbackTag )
+    this->Interactor->RemoveObserver( this->CharCallbackTag );
+  this->CharCallbackTag = 0;
 
   if( this->Interactor )
   {
@@ -364,9 +773,6 @@ void vtkMedicalImageViewer::InitializeWindowLevel()
   input->UpdateInformation();
   input->Update();
 
-  double dataMin = input->GetScalarRange()[0];
-  double dataMax = input->GetScalarRange()[1];
-
   if( this->MaintainLastWindowLevel )
   {
     this->OriginalWindow = this->Window;
@@ -374,8 +780,21 @@ void vtkMedicalImageViewer::InitializeWindowLevel()
   }
   else
   {
-    this->OriginalWindow = dataMax - dataMin;
-    this->OriginalLevel =  0.5 * ( dataMin + dataMax );
+    // the default window/level is computed once and then kept with the image
+    if( !vtkBirchDefaultWindowLevel::Get(
+          input, this->OriginalWindow, this->OriginalLevel ) )
+    {
+      if( !vtkBirchDefaultWindowLevel::Compute( input ) )
+      {
+        // types without a histogram use the full range of the data
+        double dataMin = input->GetScalarRange()[0];
+        double dataMax = input->GetScalarRange()[1];
+        vtkBirchDefaultWindowLevel::Set(
+          input, dataMax - dataMin, 0.5 * ( dataMin + dataMax ) );
+      }
+      vtkBirchDefaultWindowLevel::Get(
+        input, this->OriginalWindow, this->OriginalLevel );
+    }
   }
 
   if( fabs( this->OriginalWindow ) < 0.001 )
@@ -568,6 +987,8 @@ void vtkMedicalImageViewer::SetSlice( int slice )
 
   if( this->Slice == slice ) return;
 
+  // the slice is cached (along with the slices ahead of it) once it is rendered
+  this->SliceCacheDirection = slice > this->Slice ? 1 : -1;
   this->LastSlice[this->ViewOrientation] =  this->Slice;
   this->RecordCameraView();
  
@@ -575,7 +996,7 @@ void vtkMedicalImageViewer::SetSlice( int slice )
   this->Modified();
 
   this->UpdateDisplayExtent();
-  this->Render();
+  this->RequestRender();
 }
 
 //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
@@ -626,11 +1047,21 @@ void vtkMedicalImageViewer::UpdateDisplayExtent()
 
   // Set the image actor
 
+  bool pyramid = this->UsePyramid();
+  if( !pyramid ) this->SetPyramidLevel( 0 );
+
   switch ( this->ViewOrientation )
   {
     case vtkMedicalImageViewer::VIEW_ORIENTATION_XY:
-      this->ImageActor->SetDisplayExtent(
-        w_ext[0], w_ext[1], w_ext[2], w_ext[3], this->Slice, this->Slice );
+      if( pyramid )
+      {
+        this->UpdatePyramidExtent( false );
+      }
+      else
+      {
+        this->ImageActor->SetDisplayExtent(
+          w_ext[0], w_ext[1], w_ext[2], w_ext[3], this->Slice, this->Slice );
+      }
       break;
 
     case vtkMedicalImageViewer::VIEW_ORIENTATION_XZ:
@@ -644,8 +1075,12 @@ void vtkMedicalImageViewer::UpdateDisplayExtent()
       break;
   }
 
-  this->WindowLevel->GetOutput()->SetUpdateExtent(
-    this->ImageActor->GetDisplayExtent() );
+  // cached slices are displayed without updating the filter
+  vtkImageData *prepared = pyramid ? NULL : this->GetCachedSlice( this->Slice );
+  vtkImageData *actorInput = prepared ? prepared : this->WindowLevel->GetOutput();
+  if( this->ImageActor->GetInput() != actorInput ) this->ImageActor->SetInput( actorInput );
+  if( !prepared )
+    this->WindowLevel->GetOutput()->SetUpdateExtent( this->ImageActor->GetDisplayExtent() );
 
   if( this->Renderer )
   {
@@ -659,13 +1094,274 @@ void vtkMedicalImageViewer::UpdateDisplayExtent()
       this->Renderer->ResetCameraClippingRange( this->ImageActor->GetBounds() );
     }
   }
+
+  if( pyramid ) this->UpdatePyramidExtent( true );
+}
+
+//-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+void vtkMedicalImageViewer::SetTileSize( int size )
+{
+  if( size < 0 ) size = 0;
+  if( this->TileSize == size ) return;
+
+  this->TileSize = size;
+  this->Modified();
+
+  this->ClearPyramid();
+  this->UpdateDisplayExtent();
+  this->Render();
+}
+
+//-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+bool vtkMedicalImageViewer::UsePyramid()
+{
+  if( !this->Input || 0 >= this->TileSize ||
+      vtkMedicalImageViewer::VIEW_ORIENTATION_XY != this->ViewOrientation ) return false;
+
+  int *dims = this->Input->GetDimensions();
+  return 1 >= dims[2] && ( dims[0] > this->TileSize || dims[1] > this->TileSize );
+}
+
+//-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+int vtkMedicalImageViewer::GetNumberOfPyramidLevels()
+{
+  if( !this->UsePyramid() ) return 1;
+  return vtkMedicalImageViewer::GetNumberOfPyramidLevels( this->Input, this->TileSize );
+}
+
+//-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+int vtkMedicalImageViewer::GetNumberOfPyramidLevels( vtkImageData* image, int tileSize )
+{
+  if( !image || 0 >= tileSize ) return 1;
+
+  int *dims = image->GetDimensions();
+  if( 1 < dims[2] ) return 1;
+
+  // keep halving until the level fits in a single tile
+  int width = dims[0], height = dims[1], levels = 1;
+  while( width > tileSize || height > tileSize )
+  {
+    width = ( width + 1 ) / 2;
+    height = ( height + 1 ) / 2;
+    ++levels;
+  }
+  return levels;
+}
+
+//-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+static vtkImageData* vtkMedicalImageViewerShrink( vtkImageData* level )
+{
+  // each level is built by averaging 2x2 blocks of the level below it
+  vtkImageShrink3D *shrink = vtkImageShrink3D::New();
+  shrink->SetInput( level );
+  shrink->SetShrinkFactors( 2, 2, 1 );
+  shrink->AveragingOn();
+  shrink->Update();
+
+  vtkImageData *data = vtkImageData::New();
+  data->ShallowCopy( shrink->GetOutput() );
+  shrink->Delete();
+  return data;
+}
+
+//-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+void vtkMedicalImageViewer::BuildPyramid(
+  vtkImageData* image, int tileSize, std::vector<vtkImageData*>& pyramid )
+{
+  int levels = vtkMedicalImageViewer::GetNumberOfPyramidLevels( image, tileSize );
+  vtkImageData *level = image;
+  for( int i = 1; i < levels; ++i )
+  {
+    level = vtkMedicalImageViewerShrink( level );
+    pyramid.push_back( level );
+  }
+}
+
+//-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+vtkImageData* vtkMedicalImageViewer::GetPyramidLevel( int level )
+{
+  if( 0 >= level ) return this->Input;
+
+  // levels which weren't set along with the input are built here
+  while( (int)this->Pyramid.size() < level )
+    this->Pyramid.push_back(
+      vtkMedicalImageViewerShrink( this->GetPyramidLevel( static_cast<int>( this->Pyramid.size() ) ) ) );
+
+  return this->Pyramid[level - 1];
+}
+
+//-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+void vtkMedicalImageViewer::SetPyramidLevel( int level )
+{
+  if( this->PyramidLevel == level || !this->Input ) return;
+
+  this->PyramidLevel = level;
+  this->WindowLevel->SetInputConnection( this->GetPyramidLevel( level )->GetProducerPort() );
+}
+
+//-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+void vtkMedicalImageViewer::ClearPyramid()
+{
+  this->SetPyramidLevel( 0 );
+
+  std::vector<vtkImageData*>::iterator it;
+  for( it = this->Pyramid.begin(); it != this->Pyramid.end(); ++it )
+    ( *it )->UnRegister( this );
+  this->Pyramid.clear();
+}
+
+//-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+void vtkMedicalImageViewer::UpdatePyramidExtent( bool visibleOnly )
+{
+  if( !this->UsePyramid() ) return;
+
+  vtkCamera *camera = this->Renderer ? this->Renderer->GetActiveCamera() : NULL;
+  int *size = this->Renderer ? this->Renderer->GetSize() : NULL;
+  bool hasView = camera && size && 0 < size[0] && 0 < size[1] &&
+    VTK_FLOAT_MIN != this->CameraParallelScale[this->ViewOrientation];
+
+  // use the coarsest level whose pixels are no larger than a screen pixel
+  int level = 0;
+  if( hasView )
+  {
+    double *spacing = this->Input->GetSpacing();
+    double pixelSize = 2.0 * camera->GetParallelScale() / size[1];
+    double levelSize = spacing[0] < spacing[1] ? spacing[0] : spacing[1];
+    int levels = this->GetNumberOfPyramidLevels();
+    while( level + 1 < levels && 2.0 * levelSize <= pixelSize )
+    {
+      levelSize *= 2.0;
+      ++level;
+    }
+  }
+  else
+  {
+    // before the camera is set up display the coarsest level
+    level = this->GetNumberOfPyramidLevels() - 1;
+  }
+  this->SetPyramidLevel( level );
+
+  vtkImageData *data = this->GetPyramidLevel( level );
+  int extent[6];
+  data->GetExtent( extent );
+
+  if( visibleOnly && hasView )
+  {
+    // the area around the focal point which is visible whatever the camera's roll
+    double *origin = data->GetOrigin();
+    double *spacing = data->GetSpacing();
+    double *focalPoint = camera->GetFocalPoint();
+    double aspect = static_cast<double>( size[0] ) / size[1];
+    double radius = camera->GetParallelScale() * sqrt( 1.0 + aspect * aspect );
+
+    // snap the visible area to tile boundaries so that the display extent (and
+    // therefore the texture) only changes when a new tile becomes visible
+    for( int i = 0; i < 2; ++i )
+    {
+      int first = static_cast<int>( floor( ( focalPoint[i] - radius - origin[i] ) / spacing[i] ) );
+      int last = static_cast<int>( ceil( ( focalPoint[i] + radius - origin[i] ) / spacing[i] ) );
+      first = extent[2*i] +
+        static_cast<int>( floor( static_cast<double>( first - extent[2*i] ) / this->TileSize ) ) *
+        this->TileSize;
+      last = extent[2*i] - 1 +
+        ( static_cast<int>( floor( static_cast<double>( last - extent[2*i] ) / this->TileSize ) ) + 1 ) *
+        this->TileSize;
+      if( first < extent[2*i] ) first = extent[2*i];
+      if( first > extent[2*i+1] ) first = extent[2*i+1];
+      if( last > extent[2*i+1] ) last = extent[2*i+1];
+      if( last < first ) last = first;
+      extent[2*i] = first;
+      extent[2*i+1] = last;
+    }
+  }
+
+  this->ImageActor->SetDisplayExtent( extent );
+  this->WindowLevel->GetOutput()->SetUpdateExtent( extent );
 }
 
 //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
 void vtkMedicalImageViewer::Render()
 {
+  // a pending render request is satisfied by this render
+  this->CancelRenderRequest();
+  this->LastRenderTime = vtkTimerLog::GetUniversalTime();
+  this->NumberOfRenders++;
   if( this->Interactor ) 
     this->Interactor->Render();
+
+  // keep the displayed slice and map the slices ahead of the scrub direction once
+  // the slice is on display (cine playback prepares its own next frame)
+  int direction = this->SliceCacheDirection;
+  this->SliceCacheDirection = 0;
+  if( direction && vtkMedicalImageViewer::STOP == this->CineState )
+  {
+    this->CacheDisplayedSlice();
+    for( int i = 1; i <= this->SliceCacheReadAhead; ++i )
+      this->PrepareSlice( this->Slice + i * direction );
+  }
+}
+
+//-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+void vtkMedicalImageViewer::RequestRender()
+{
+  this->NumberOfRenderRequests++;
+  if( this->RenderPending )
+  {
+    this->NumberOfCoalescedRenders++;
+    return;
+  }
+
+  // render no sooner than one frame after the last render
+  int delay = 0;
+  if( 0.0 < this->LastRenderTime )
+  {
+    double remaining = 1.0 / this->MaximumRenderRate -
+      ( vtkTimerLog::GetUniversalTime() - this->LastRenderTime );
+    if( 0.0 < remaining ) delay = static_cast<int>( 1000.0 * remaining + 0.5 );
+  }
+
+  if( this->Interactor ) this->RenderTimerId = this->Interactor->CreateOneShotTimer( delay );
+  if( !this->RenderTimerId )
+  {
+    this->Render();
+    return;
+  }
+
+  vtkRenderRequestCallback *cbk = vtkRenderRequestCallback::New();
+  cbk->Viewer = this;
+  cbk->TimerId = this->RenderTimerId;
+  this->RenderTimerCallbackTag = this->Interactor->AddObserver( vtkCommand::TimerEvent, cbk );
+  cbk->Delete();
+  this->RenderPending = true;
+}
+
+//-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+void vtkMedicalImageViewer::ProcessRenderRequest()
+{
+  // the interactor destroys one-shot timers once they have fired
+  this->RenderTimerId = 0;
+  if( this->RenderPending ) this->Render();
+}
+
+//-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+void vtkMedicalImageViewer::CancelRenderRequest()
+{
+  if( this->Interactor && this->RenderTimerId )
+    this->Interactor->DestroyTimer( this->RenderTimerId );
+  this->RenderTimerId = 0;
+
+  if( this->Interactor && this->RenderTimerCallbackTag )
+    this->Interactor->RemoveObserver( this->RenderTimerCallbackTag );
+  this->RenderTimerCallbackTag = 0;
+  this->RenderPending = false;
+}
+
+//-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+void vtkMedicalImageViewer::ResetRenderStatistics()
+{
+  this->NumberOfRenderRequests = 0;
+  this->NumberOfCoalescedRenders = 0;
+  this->NumberOfRenders = 0;
 }
 
 //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
@@ -681,6 +1377,7 @@ void vtkMedicalImageViewer::SetColorWindowLevel( const double& w, const double&
   this->Window = w;
   this->Level = l;
 
+  this->ClearSliceCache();
   this->WindowLevel->SetWindow( this->Window );
   this->WindowLevel->SetLevel( this->Level );
 }
@@ -696,7 +1393,7 @@ void vtkMedicalImageViewer::DoStartWindowLevel()
 void vtkMedicalImageViewer::DoResetWindowLevel()
 {
   this->SetColorWindowLevel( this->OriginalWindow, this->OriginalLevel );
-  this->Render();
+  this->RequestRender();
 }
 
 //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
@@ -764,45 +1461,304 @@ void vtkMedicalImageViewer::DoWindowLevel()
   }
 
   this->SetColorWindowLevel( newWindow, newLevel );
-  this->Render();
+  this->RequestRender();
 }
 
 //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
-void vtkMedicalImageViewer::CineLoop()
+void vtkMedicalImageViewer::CineStop()
 {
-  this->CineState = vtkMedicalImageViewer::PLAY;
-  do
+  this->CineStopTimer();
+  if( vtkMedicalImageViewer::PLAY == this->CineState )
   {
-    for( int i = this->GetSliceMin(); 
-             i <= this->GetSliceMax() && 
-             this->CineState != vtkMedicalImageViewer::STOP; ++i )
-    {
-      this->SetSlice( i );
-      this->InvokeEvent( this->PlayEvent, this );
-    }
-  }while( this->CineState != vtkMedicalImageViewer::STOP );
+    this->CineState = vtkMedicalImageViewer::STOP;
+    CineStatistics statistics;
+    this->GetCineStatistics( statistics );
+    this->InvokeEvent( this->CineStatisticsEvent, &statistics );
+  }
+  this->InvokeEvent( this->StopEvent, this );
 }
 
 //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
-void vtkMedicalImageViewer::CineStop()
+void vtkMedicalImageViewer::PrepareSlice( int slice )
 {
-  this->CineState = vtkMedicalImageViewer::STOP;
-  this->InvokeEvent( this->StopEvent, this );
+  // only the slices of volumes are cached, 2D images are displayed once
+  vtkImageData *input = this->GetInput();
+  if( !input || 0 >= this->SliceCacheMemoryLimit || this->UsePyramid() ) return;
+  if( this->GetSliceMin() == this->GetSliceMax() || this->GetCachedSlice( slice ) ) return;
+
+  int extent[6];
+  input->UpdateInformation();
+  input->GetWholeExtent( extent );
+  if( slice < extent[2 * this->ViewOrientation] || slice > extent[2 * this->ViewOrientation + 1] )
+    return;
+  extent[2 * this->ViewOrientation] = slice;
+  extent[2 * this->ViewOrientation + 1] = slice;
+
+  // map the slice with the same settings as the displayed slice
+  vtkImageMapToWindowLevelColors *filter = this->SliceWindowLevel;
+  filter->SetInputConnection( this->WindowLevel->GetInputConnection( 0, 0 ) );
+  filter->SetLookupTable( this->WindowLevel->GetLookupTable() );
+  filter->SetOutputFormat( this->WindowLevel->GetOutputFormat() );
+  filter->SetActiveComponent( this->WindowLevel->GetActiveComponent() );
+  filter->SetPassAlphaToOutput( this->WindowLevel->GetPassAlphaToOutput() );
+  filter->SetWindow( this->WindowLevel->GetWindow() );
+  filter->SetLevel( this->WindowLevel->GetLevel() );
+  filter->SetNumberOfThreads( this->WindowLevel->GetNumberOfThreads() );
+  filter->GetOutput()->UpdateInformation();
+  filter->GetOutput()->SetUpdateExtent( extent );
+  filter->GetOutput()->Update();
+
+  this->AddCachedSlice( slice, filter->GetOutput() );
+}
+
+//-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+void vtkMedicalImageViewer::CacheDisplayedSlice()
+{
+  // only slices of volumes displayed straight from the window/level filter are kept
+  vtkImageData *input = this->GetInput();
+  vtkImageData *output = this->WindowLevel->GetOutput();
+  if( !input || 0 >= this->SliceCacheMemoryLimit || this->UsePyramid() ) return;
+  if( this->GetSliceMin() == this->GetSliceMax() || this->ImageActor->GetInput() != output ) return;
+  if( this->GetCachedSlice( this->Slice ) ) return;
+
+  // the filter has just mapped the displayed slice, copy it rather than mapping it again
+  int extent[6];
+  output->GetExtent( extent );
+  if( this->Slice != extent[2 * this->ViewOrientation] ||
+      this->Slice != extent[2 * this->ViewOrientation + 1] ||
+      output->GetUpdateTime() < this->WindowLevel->GetMTime() ) return;
+
+  this->AddCachedSlice( this->Slice, output );
+}
+
+//-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+void vtkMedicalImageViewer::AddCachedSlice( int slice, vtkImageData* image )
+{
+  std::pair<int,int> key( this->ViewOrientation, slice );
+  SliceCacheEntry entry;
+  entry.Image = vtkImageData::New();
+  entry.Image->DeepCopy( image );
+  entry.Size = entry.Image->GetActualMemorySize();
+  entry.Usage = this->SliceCacheUsage.insert( this->SliceCacheUsage.begin(), key );
+  this->SliceCache[key] = entry;
+  this->SliceCacheMemorySize += entry.Size;
+  this->SliceCacheTime = this->WindowLevel->GetMTime();
+
+  this->TrimSliceCache();
+}
+
+//-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+vtkImageData* vtkMedicalImageViewer::GetCachedSlice( int slice )
+{
+  if( this->SliceCache.empty() ) return NULL;
+
+  // the cached slices are out of date once the window/level filter is modified
+  if( this->SliceCacheTime != this->WindowLevel->GetMTime() )
+  {
+    this->ClearSliceCache();
+    return NULL;
+  }
+
+  std::map< std::pair<int,int>, SliceCacheEntry >::iterator it =
+    this->SliceCache.find( std::pair<int,int>( this->ViewOrientation, slice ) );
+  if( this->SliceCache.end() == it ) return NULL;
+
+  // move the slice to the front of the usage list
+  this->SliceCacheUsage.splice(
+    this->SliceCacheUsage.begin(), this->SliceCacheUsage, it->second.Usage );
+  return it->second.Image;
+}
+
+//-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+void vtkMedicalImageViewer::SetSliceCacheMemoryLimit( int limit )
+{
+  if( this->SliceCacheMemoryLimit == limit ) return;
+  this->SliceCacheMemoryLimit = limit;
+  this->TrimSliceCache();
+  this->Modified();
+}
+
+//-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+void vtkMedicalImageViewer::TrimSliceCache()
+{
+  // the image actor keeps its own reference to the slice it is displaying
+  unsigned long limit =
+    1024 * (unsigned long) ( 0 > this->SliceCacheMemoryLimit ? 0 : this->SliceCacheMemoryLimit );
+  while( this->SliceCacheMemorySize > limit && !this->SliceCacheUsage.empty() )
+  {
+    std::map< std::pair<int,int>, SliceCacheEntry >::iterator it =
+      this->SliceCache.find( this->SliceCacheUsage.back() );
+    this->SliceCacheMemorySize -= it->second.Size;
+    it->second.Image->Delete();
+    this->SliceCache.erase( it );
+    this->SliceCacheUsage.pop_back();
+  }
+}
+
+//-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+void vtkMedicalImageViewer::ClearSliceCache()
+{
+  std::map< std::pair<int,int>, SliceCacheEntry >::iterator it;
+  for( it = this->SliceCache.begin(); it != this->SliceCache.end(); ++it )
+    it->second.Image->Delete();
+  this->SliceCache.clear();
+  this->SliceCacheUsage.clear();
+  this->SliceCacheMemorySize = 0;
+
+  // the image actor may still be displaying a cached slice
+  if( this->ImageActor && this->ImageActor->GetInput() &&
+      this->ImageActor->GetInput() != this->WindowLevel->GetOutput() )
+  {
+    this->ImageActor->SetInput( this->WindowLevel->GetOutput() );
+    this->WindowLevel->GetOutput()->SetUpdateExtent( this->ImageActor->GetDisplayExtent() );
+  }
 }
 
 //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
 void vtkMedicalImageViewer::CinePlay()
 {
+  this->CineStart( false );
+}
+
+//-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+void vtkMedicalImageViewer::CineLoop()
+{
+  this->CineStart( true );
+}
+
+//-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+void vtkMedicalImageViewer::CineStart( bool loop )
+{
+  if( vtkMedicalImageViewer::PLAY == this->CineState ) this->CineStop();
+  if( !this->Interactor )
+  {
+    vtkErrorMacro( "Cine playback requires an interactor" );
+    return;
+  }
+
+  // the timer fires twice per frame so that frames are displayed no later than
+  // half a frame after they are due
+  int period = static_cast<int>( 500.0 / this->CineFrameRate );
+  this->CineTimerId = this->Interactor->CreateRepeatingTimer( 1 > period ? 1 : period );
+  if( !this->CineTimerId )
+  {
+    vtkErrorMacro( "Unable to create the cine playback timer" );
+    return;
+  }
+
+  vtkCineCallback *cbk = vtkCineCallback::New();
+  cbk->Viewer = this;
+  cbk->TimerId = this->CineTimerId;
+  this->CineTimerCallbackTag = this->Interactor->AddObserver( vtkCommand::TimerEvent, cbk );
+  cbk->Delete();
+
   this->CineState = vtkMedicalImageViewer::PLAY;
-   
-  for( int i = this->Slice; 
-           i <= this->GetSliceMax() && 
-           this->CineState != vtkMedicalImageViewer::STOP; ++i )
+  this->CineLoopSlices = loop;
+  this->CineStartSlice = loop ? this->GetSliceMin() : this->Slice;
+  this->CineFrame = 0;
+  this->CineDroppedFrames = 0;
+  this->CineFrameTimes.clear();
+  this->CineFrameTimeCount = 0;
+
+  this->SetSlice( this->CineStartSlice );
+  if( this->RenderPending ) this->Render();
+  this->CineStartTime = vtkTimerLog::GetUniversalTime();
+  this->CineLastFrameTime = this->CineStartTime;
+  this->CineLastReportTime = this->CineStartTime;
+  this->InvokeEvent( this->PlayEvent, this );
+
+  if( vtkMedicalImageViewer::PLAY == this->CineState && this->Slice < this->GetSliceMax() )
+    this->PrepareSlice( this->Slice + 1 );
+}
+
+//-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+void vtkMedicalImageViewer::CineUpdate()
+{
+  if( vtkMedicalImageViewer::PLAY != this->CineState ) return;
+
+  // frames which became due while the previous frame was displayed are dropped
+  double now = vtkTimerLog::GetUniversalTime();
+  int frame = static_cast<int>( ( now - this->CineStartTime ) * this->CineFrameRate );
+  if( frame <= this->CineFrame ) return;
+  this->CineDroppedFrames += frame - this->CineFrame - 1;
+  this->CineFrame = frame;
+
+  int min = this->GetSliceMin();
+  int max = this->GetSliceMax();
+  int slice = this->CineStartSlice + frame;
+  if( this->CineLoopSlices )
+  {
+    slice = min + ( slice - min ) % ( max - min + 1 );
+  }
+  else if( slice > max )
+  {
+    // make sure the last slice is displayed before stopping
+    if( this->Slice >= max )
+    {
+      this->CineStop();
+      return;
+    }
+    slice = max;
+  }
+
+  // frames are rendered as soon as they are due rather than on request
+  this->SetSlice( slice );
+  if( this->RenderPending ) this->Render();
+  now = vtkTimerLog::GetUniversalTime();
+  double frameTime = now - this->CineLastFrameTime;
+  if( vtkMedicalImageViewerCineFrameHistory > static_cast<int>( this->CineFrameTimes.size() ) )
+    this->CineFrameTimes.push_back( frameTime );
+  else this->CineFrameTimes[this->CineFrameTimeCount % vtkMedicalImageViewerCineFrameHistory] = frameTime;
+  this->CineFrameTimeCount++;
+  this->CineLastFrameTime = now;
+  this->InvokeEvent( this->PlayEvent, this );
+  if( vtkMedicalImageViewer::PLAY != this->CineState ) return;
+
+  if( 1.0 <= now - this->CineLastReportTime )
   {
-    this->SetSlice( i );
-    this->InvokeEvent( this->PlayEvent, this );
+    this->CineLastReportTime = now;
+    CineStatistics statistics;
+    this->GetCineStatistics( statistics );
+    this->InvokeEvent( this->CineStatisticsEvent, &statistics );
   }
-  this->CineStop();
+
+  // map the next slice while waiting for it to be due
+  if( slice < max ) this->PrepareSlice( slice + 1 );
+  else if( this->CineLoopSlices ) this->PrepareSlice( min );
+}
+
+//-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+void vtkMedicalImageViewer::CineStopTimer()
+{
+  if( this->Interactor && this->CineTimerId )
+    this->Interactor->DestroyTimer( this->CineTimerId );
+  this->CineTimerId = 0;
+
+  if( this->Interactor && this->CineTimerCallbackTag )
+    this->Interactor->RemoveObserver( this->CineTimerCallbackTag );
+  this->CineTimerCallbackTag = 0;
+}
+
+//-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
+void vtkMedicalImageViewer::GetCineStatistics( CineStatistics& statistics )
+{
+  int count = this->CineFrameTimeCount;
+  double time = this->CineLastFrameTime - this->CineStartTime;
+  statistics.NumberOfFrames = 0.0 < this->CineStartTime ? count + 1 : 0;
+  statistics.NumberOfDroppedFrames = this->CineDroppedFrames;
+  statistics.FrameRate = 0.0 < time ? count / time : 0.0;
+  statistics.FrameTime50 = 0.0;
+  statistics.FrameTime95 = 0.0;
+  statistics.FrameTime99 = 0.0;
+  if( 0 == count ) return;
+
+  // nearest-rank percentiles of the most recent frames
+  std::vector<double> times( this->CineFrameTimes );
+  std::sort( times.begin(), times.end() );
+  int samples = static_cast<int>( times.size() );
+  statistics.FrameTime50 = times[static_cast<int>( ceil( 0.50 * samples ) ) - 1];
+  statistics.FrameTime95 = times[static_cast<int>( ceil( 0.95 * samples ) ) - 1];
+  statistics.FrameTime99 = times[static_cast<int>( ceil( 0.99 * samples ) ) - 1];
 }
 
 //-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-+#+-
@@ -826,6 +1782,16 @@ void vtkMedicalImageViewer::PrintSelf( ostream& os, vtkIndent indent )
   this->WindowLevel->PrintSelf( os, indent.GetNextIndent() );
   os << indent << "Slice: " << this->Slice << endl;
   os << indent << "ViewOrientation: " << this->ViewOrientation << endl;
+  os << indent << "TileSize: " << this->TileSize << endl;
+  os << indent << "PyramidLevel: " << this->PyramidLevel << endl;
+  os << indent << "CineFrameRate: " << this->CineFrameRate << endl;
+  os << indent << "SliceCacheMemoryLimit: " << this->SliceCacheMemoryLimit << endl;
+  os << indent << "SliceCacheReadAhead: " << this->SliceCacheReadAhead << endl;
+  os << indent << "SliceCacheMemorySize: " << this->SliceCacheMemorySize << endl;
+  os << indent << "MaximumRenderRate: " << this->MaximumRenderRate << endl;
+  os << indent << "NumberOfRenderRequests: " << this->NumberOfRenderRequests << endl;
+  os << indent << "NumberOfCoalescedRenders: " << this->NumberOfCoalescedRenders << endl;
+  os << indent << "NumberOfRenders: " << this->NumberOfRenders << endl;
   os << indent << "InteractorStyle: " << endl;
   if( this->InteractorStyle )
   {
@@ -25,6 +25,10 @@
  * supports interactive window/level operations on the image. Note that
  * vtkMedicalImageViewer is simply a wrapper around these classes.
  *
+ * Unsigned char and unsigned short images are window/levelled by
+ * vtkBirchImageMapToWindowLevelColors, which uses a table and SIMD kernel
+ * rather than the generic per pixel arithmetic of its superclass.
+ *
  * vtkMedicalImageViewer uses the 3D rendering and texture mapping engine
  * to draw an image on a plane.  This allows for rapid rendering,
  * zooming, and panning. The image is placed in the 3D scene at a
@@ -47,6 +51,14 @@
  * direction) for achieving this effect is provided by the
  * vtkImagePlaneWidget .
  *
+ * Large 2D images are displayed from a pyramid of successively halved copies
+ * of the input.  The pyramid may be built beforehand (on any thread) and set
+ * along with the input, otherwise levels are built as they are first needed and
+ * kept until the input changes.  Before every render the pyramid level matching the camera's zoom
+ * is chosen and only the tiles of that level which are inside the viewport
+ * are mapped and rendered, so pan and zoom don't depend on the size of the
+ * image and the texture memory used stays bounded.
+ *
  * Note that pressing 'r' will reset the window/level and pressing
  * shift+'r' or control+'r' will reset the camera.
  *
@@ -56,15 +68,20 @@
 #define __vtkMedicalImageViewer_h
 
 #include "vtkObject.h"
+#include <list>
+#include <map>
+#include <utility>
 #include <vector>
 
 class vtkImageActor;
 class vtkImageData;
 class vtkImageMapToWindowLevelColors;
+class vtkImageReader2;
 class vtkInteractorStyleImage;
 class vtkRenderWindow;
 class vtkRenderer;
 class vtkRenderWindowInteractor;
+class vtkTextActor;
 
 class vtkMedicalImageViewer : public vtkObject 
 {
@@ -79,26 +96,163 @@ public:
    * refresh render.  This method allows for forcing a render.
    */
   virtual void Render( void );
+
+  /**
+   * Request a render of the display.
+   * Rather than rendering immediately the view is marked as needing a render
+   * and a one-shot interactor timer renders it once the event loop is idle,
+   * no sooner than one frame (see MaximumRenderRate) after the last render.
+   * Requests made while a render is pending are coalesced into that render, so
+   * a burst of slice or window/level changes renders only once per frame.
+   * Without an interactor timer the display is rendered immediately.
+   */
+  virtual void RequestRender();
+
+  /**
+   * Render the display if a render has been requested.
+   * Called by the render timer, there should be no need to call this method.
+   */
+  void ProcessRenderRequest();
+
+  //@{
+  /**
+   * Set/Get the maximum number of requested renders per second.
+   * Default is 60.
+   */
+  vtkSetClampMacro( MaximumRenderRate, double, 1.0, 1000.0 );
+  vtkGetMacro( MaximumRenderRate, double );
+  //@}
+
+  //@{
+  /**
+   * Get the number of renders requested by RequestRender(), the number of those
+   * requests which were coalesced into a pending render, and the number of renders
+   * executed (including those made by calling Render() directly).
+   */
+  vtkGetMacro( NumberOfRenderRequests, unsigned long );
+  vtkGetMacro( NumberOfCoalescedRenders, unsigned long );
+  vtkGetMacro( NumberOfRenders, unsigned long );
+  //@}
+
+  /** Reset the render counters to zero. */
+  void ResetRenderStatistics();
   
   //@{
   /** 
    * Set/Get the input image to the viewer.
+   * Changing the input only reconnects the window/level filter and resets the
+   * display extent, window/level and camera; the renderer, actors, interactor
+   * and observers are kept.  Setting a NULL input dismantles the pipeline.
    * @param input vtkImageData from the output of a reader
    */
   virtual void SetInput( vtkImageData* input );
   virtual vtkImageData* GetInput();
   //@}
 
+  /**
+   * Set the input image along with its prebuilt pyramid (see BuildPyramid()) so
+   * that the pyramid isn't rebuilt on the GUI thread.  Levels which are missing
+   * are built when they are first needed.
+   * @param input vtkImageData from the output of a reader
+   * @param pyramid levels of the input's pyramid, starting at level 1
+   */
+  virtual void SetInput( vtkImageData* input, const std::vector<vtkImageData*>& pyramid );
+
   /**
    * Load an image from file and display.
    * 
-   * If fileName is valid, load the file via vtkGDCMImageReader and display it.
-   * Returns fails if image fails to load.
+   * If fileName is valid, load the file via ReadImage() and display it.
+   * Returns false if image fails to load.
    * @param fileName Name of a file on disk
    * @return boolean
    */
    bool Load( std::string fileName );
 
+  /**
+   * Read an image from file into an image data object.
+   *
+   * The reader is chosen by CreateReader() and the image is copied into output so
+   * that it is not connected to the reader's pipeline.  Only objects created by this
+   * method are used so it may be called from any thread.
+   * @param fileName Name of a file on disk
+   * @param output vtkImageData to copy the image into
+   * @return boolean
+   */
+  static bool ReadImage( std::string fileName, vtkImageData* output );
+
+  /**
+   * Read a reduced resolution version of an image from file.
+   *
+   * JPEG files are decoded at 1/2, 1/4 or 1/8 of their size by scaling in the
+   * DCT domain, which is considerably faster than decoding the full image.  The
+   * spacing and origin of the output are set so that it covers the same area as
+   * the full resolution image, so one may replace the other without moving the
+   * camera.  Only JPEG files are supported, other formats return false.  The
+   * content of output is undefined if the image can't be read.  This method may
+   * be called from any thread.
+   * @param fileName Name of a file on disk
+   * @param output vtkImageData to decode the image into
+   * @param shrinkFactor 2, 4 or 8
+   * @return boolean
+   */
+  static bool ReadPreviewImage( std::string fileName, vtkImageData* output, int shrinkFactor );
+
+  /**
+   * Enum constants for the image file formats recognized by GetFileFormat(). */
+  enum
+  {
+    FORMAT_UNKNOWN = 0, /**< enum value FORMAT_UNKNOWN. */
+    FORMAT_JPEG = 1,    /**< enum value FORMAT_JPEG. */
+    FORMAT_PNG = 2,     /**< enum value FORMAT_PNG. */
+    FORMAT_DICOM = 3    /**< enum value FORMAT_DICOM. */
+  };
+
+  /**
+   * Determine the format of an image file from its content.
+   * The leading bytes of the file are compared to the signature of each
+   * format in the reader registry, the file's extension is ignored.
+   * @param fileName Name of a file on disk
+   * @return one of the FORMAT enum values
+   */
+  static int GetFileFormat( std::string fileName );
+
+  /**
+   * Get the name of a file format (e.g., "JPEG").
+   * @param format one of the FORMAT enum values
+   */
+  static const char* GetFileFormatName( int format );
+
+  /**
+   * Create a reader able to decode an image file.
+   * JPEG and PNG files are decoded by VTK's own readers rather than by GDCM,
+   * which is only used for DICOM files (including files which have no DICOM
+   * preamble).  The caller is responsible for deleting the reader.
+   * @param fileName Name of a file on disk
+   * @return a new reader, or NULL if the file can't be read
+   */
+  static vtkImageReader2* CreateReader( std::string fileName );
+
+  /**
+   * Build the pyramid used to display a large 2D image (see SetTileSize()).
+   * Levels 1 and up are appended to the pyramid and the caller takes over their
+   * references; nothing is appended if the image is displayed without a pyramid.
+   * This method may be called from any thread.
+   */
+  static void BuildPyramid( vtkImageData* image, int tileSize, std::vector<vtkImageData*>& pyramid );
+
+  /**
+   * Get the number of levels (including level 0) in the pyramid of an image, 1 if
+   * the image is displayed without a pyramid.
+   */
+  static int GetNumberOfPyramidLevels( vtkImageData* image, int tileSize );
+
+  /**
+   * Display a message in place of the image.
+   * Used while an image is being loaded or when it can't be displayed.  The
+   * message is removed by passing an empty string or by setting a new input.
+   * @param message Text to display centered in the view
+   */
+  void SetMessage( std::string message );
 
   /**
    * Enum constants for orthonormal slice orientations. */
@@ -269,8 +423,14 @@ public:
    * Scroll once through slices.
    * Scrolling starts at the current slice and proceeds to the last slice.
    * At start, the state ivar is set to PLAY.  At each slice change the
-   * PlayEvent is invoked.  Stops either when the state ivar is set to STOP
-   * or when the last slice is reached at which point state is set to STOP.
+   * PlayEvent is invoked.  Stops when CineStop() is called or when the last
+   * slice is reached at which point state is set to STOP.
+   *
+   * Slices are displayed by a repeating interactor timer at CineFrameRate
+   * frames per second, so this method returns immediately and the event loop
+   * keeps running during playback.  Slices which are due while a previous one
+   * is still being rendered are skipped (and counted as dropped frames) to keep
+   * up with the frame rate.  Playback requires an interactor.
    */
   void CinePlay();
 
@@ -278,7 +438,8 @@ public:
    * Scroll continuously through slices.
    * Scrolling starts at the first slice, proceeds to the last slice and
    * then repeats.  State ivar is set to PLAY, invokes PlayEvent at each
-   * slice change, until the state is set to STOP.
+   * slice change, until CineStop() is called.
+   * @sa CinePlay()
    */
   void CineLoop();
 
@@ -287,10 +448,17 @@ public:
 
   /**
    * Stop Scrolling through slices.
-   * State ivar is set to STOP and a StopEvent is invoked.
+   * State ivar is set to STOP, the CineStatisticsEvent and StopEvent are
+   * invoked.
    */
   void CineStop();
 
+  /**
+   * Display the slice which is due according to the cine frame rate.
+   * Called by the cine timer, there should be no need to call this method.
+   */
+  void CineUpdate();
+
   /** State enum for control of slice scrolling. */
   enum
   {
@@ -298,12 +466,95 @@ public:
     STOP
   };
 
+  /** Get the state of slice scrolling (PLAY or STOP). */
+  vtkGetMacro( CineState, int );
+
+  //@{
+  /**
+   * Set/Get the cine playback frame rate (in frames per second).
+   * Default is 25.
+   */
+  vtkSetClampMacro( CineFrameRate, double, 0.1, 1000.0 );
+  vtkGetMacro( CineFrameRate, double );
+  //@}
+
+  /** Statistics of cine playback */
+  struct CineStatistics
+  {
+    int NumberOfFrames;        /**< Number of slices displayed */
+    int NumberOfDroppedFrames; /**< Number of slices skipped to keep up */
+    double FrameRate;          /**< Achieved frames per second */
+    double FrameTime50;        /**< Median time between the last 1000 frames (seconds) */
+    double FrameTime95;        /**< 95th percentile of the time between frames */
+    double FrameTime99;        /**< 99th percentile of the time between frames */
+  };
+
+  /**
+   * Get the statistics of the current (or last) cine playback.
+   * The statistics are also passed as call data of the CineStatisticsEvent,
+   * which is invoked every second during playback and when it stops.
+   */
+  void GetCineStatistics( CineStatistics& statistics );
+
+  //@{
+  /**
+   * Set/Get the amount of memory used to cache window/levelled slices of
+   * volumes (in megabytes).  Slices are cached for each orientation as they
+   * are displayed, along with the next SliceCacheReadAhead slices in the
+   * direction the slice is changing, so scrubbing back and forth through a
+   * volume doesn't map the same slices again.  The cache is emptied whenever
+   * the window/level changes.  The least recently used slices are removed once
+   * the limit is exceeded.  A limit of 0 turns the cache off.  Default is 64.
+   */
+  virtual void SetSliceCacheMemoryLimit( int );
+  vtkGetMacro( SliceCacheMemoryLimit, int );
+  //@}
+
+  //@{
+  /**
+   * Set/Get the number of slices mapped ahead of the displayed slice in the
+   * direction the slice is changing.  Default is 2.
+   */
+  vtkSetClampMacro( SliceCacheReadAhead, int, 0, VTK_INT_MAX );
+  vtkGetMacro( SliceCacheReadAhead, int );
+  //@}
+
+  /** Remove all slices from the slice cache. */
+  void ClearSliceCache();
+
+  /** Get the amount of memory used by the slice cache (in kilobytes). */
+  unsigned long GetSliceCacheMemorySize() { return this->SliceCacheMemorySize; }
+
   //@{
   /** Get event id tags for control of scrolling through 3D images. */
   vtkGetMacro( PlayEvent, int );
   vtkGetMacro( StopEvent, int );
+  vtkGetMacro( CineStatisticsEvent, int );
+  //@}
+
+  //@{
+  /**
+   * Set/Get the size of the image pyramid's tiles (in pixels).
+   * Only 2D images larger than a tile are displayed from a pyramid.
+   * A tile size of 0 turns the pyramid off.  Default is 512.
+   */
+  virtual void SetTileSize( int );
+  vtkGetMacro( TileSize, int );
   //@}
 
+  /**
+   * Get the pyramid level currently displayed.
+   * Level 0 is the input, each following level has half its resolution.
+   */
+  vtkGetMacro( PyramidLevel, int );
+
+  /**
+   * Choose the pyramid level and tiles to display.
+   * Called automatically before every render.
+   * @param visibleOnly if false all tiles of the level are displayed
+   */
+  void UpdatePyramidExtent( bool visibleOnly );
+
 protected:
   vtkMedicalImageViewer();
   ~vtkMedicalImageViewer();
@@ -325,6 +576,33 @@ protected:
   vtkImageActor                   *ImageActor;
   vtkRenderWindowInteractor       *Interactor;
   vtkInteractorStyleImage         *InteractorStyle;
+  vtkTextActor                    *MessageActor;
+  //@}
+
+  vtkImageData *Input;              /**< The input image (pyramid level 0) */
+
+  //@{
+  /** Image pyramid used to display large 2D images */
+  std::vector<vtkImageData*> Pyramid; /**< Levels built or set so far, starting at level 1 */
+  int TileSize;
+  int PyramidLevel;
+  unsigned long RenderCallbackTag;
+  unsigned long CharCallbackTag;
+
+  /** Whether the input is displayed from the pyramid */
+  bool UsePyramid();
+
+  /** Get the number of levels in the pyramid of the input (including level 0) */
+  int GetNumberOfPyramidLevels();
+
+  /** Get (building it if necessary) a level of the pyramid */
+  vtkImageData* GetPyramidLevel( int level );
+
+  /** Connect a level of the pyramid to the window/level filter */
+  void SetPyramidLevel( int level );
+
+  /** Delete all levels of the pyramid and display the input */
+  void ClearPyramid();
   //@}
 
   int Slice;        /**< Current slice index */
@@ -332,8 +610,69 @@ protected:
 
   int PlayEvent;    /**< VTK unique event id for the PlayEvent */
   int StopEvent;    /**< VTK unique event id for the StopEvent */
+  int CineStatisticsEvent; /**< VTK unique event id for the CineStatisticsEvent */
   int CineState;    /**< Current state of play or stop for cine methods */
 
+  //@{
+  /** Cine playback (see CinePlay()) */
+  void CineStart( bool loop );
+  void CineStopTimer();
+  double CineFrameRate;
+  bool CineLoopSlices;       /**< Whether playback wraps around to the first slice */
+  int CineTimerId;
+  unsigned long CineTimerCallbackTag;
+  int CineStartSlice;
+  int CineFrame;             /**< Number of frame periods since playback started */
+  int CineDroppedFrames;
+  double CineStartTime;
+  double CineLastFrameTime;
+  double CineLastReportTime;
+  std::vector<double> CineFrameTimes; /**< Ring of the most recent times between frames */
+  int CineFrameTimeCount;    /**< Number of times between frames since playback started */
+  //@}
+
+  //@{
+  /** Render request coalescing (see RequestRender()) */
+  void CancelRenderRequest();
+  bool RenderPending;
+  int RenderTimerId;
+  unsigned long RenderTimerCallbackTag;
+  double MaximumRenderRate;
+  double LastRenderTime;
+  unsigned long NumberOfRenderRequests;
+  unsigned long NumberOfCoalescedRenders;
+  unsigned long NumberOfRenders;
+  //@}
+
+  //@{
+  /**
+   * Cache of window/levelled slices of volumes, see SetSliceCacheMemoryLimit().
+   * PrepareSlice() maps a slice into the cache (unless it is already cached),
+   * CacheDisplayedSlice() copies the slice the window/level filter has just
+   * mapped for display into the cache and GetCachedSlice() returns a cached
+   * slice of the current orientation.
+   */
+  void PrepareSlice( int slice );
+  void CacheDisplayedSlice();
+  void AddCachedSlice( int slice, vtkImageData* image );
+  vtkImageData* GetCachedSlice( int slice );
+  void TrimSliceCache();
+  struct SliceCacheEntry
+  {
+    vtkImageData *Image;
+    unsigned long Size;
+    std::list< std::pair<int,int> >::iterator Usage;
+  };
+  vtkImageMapToWindowLevelColors *SliceWindowLevel; /**< Maps slices into the cache */
+  std::map< std::pair<int,int>, SliceCacheEntry > SliceCache; /**< Keyed by orientation, slice */
+  std::list< std::pair<int,int> > SliceCacheUsage; /**< Most recently used first */
+  unsigned long SliceCacheMemorySize;
+  unsigned long SliceCacheTime; /**< Modified time of the window/level filter */
+  int SliceCacheMemoryLimit;
+  int SliceCacheReadAhead;
+  int SliceCacheDirection; /**< Direction to read ahead once the slice is rendered */
+  //@}
+
   /** Maintain window level settings between image changes */
   int MaintainLastWindowLevel; 
   double OriginalWindow; /**< Original window computed from input */
@@ -350,6 +689,9 @@ protected:
    */
   std::vector<unsigned long> WindowLevelCallbackTags;
 
+  /** Whether InstallPipeline() has been called since the last UnInstallPipeline() */
+  bool PipelineInstalled;
+
   /** Calculate the original window and level parameters
     * @sa OriginalWindow, OriginalLevel
     */
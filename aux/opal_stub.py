@@ -0,0 +1,156 @@
+#! /usr/bin/env python
+#
+# A local stand-in for an Opal server, used to measure the performance of Birch's
+# Opal service without access to a live Opal instance.
+#
+# Only the web services used by Birch are served:
+#
+#  /ws/datasource/xxx/table/yyy/entities
+#    All entities of a table
+#
+#  /ws/datasource/xxx/table/yyy/valueSets?offset=n&limit=m&select=name().eq('vvv')
+#    A page of values of a variable
+#
+#  /ws/datasource/xxx/table/yyy/valueSet/zzz?select=name().eq('vvv')
+#    The value of a variable for a single entity (unknown entities fail with 404, as
+#    they do in Opal)
+#
+# Responses are either synthetic (generated from --entities) or replayed from a
+# directory of recorded responses (--replay).  A recorded response is a file named
+# after the url-quoted web service path (including the query) with a .json
+# extension, for instance the output of:
+#
+#   opal.py ... --ws "/datasource/xxx/table/yyy/entities" --out <file>
+#
+# Usage:
+#   opal_stub.py --help
+#
+# Example (serve 50000 synthetic entities with 20ms latency per request):
+#   opal_stub.py --port 8843 --entities 50000 --latency 20
+#
+# Birch must be configured to use plain http to connect to the stub:
+#   <Opal><Protocol>http</Protocol><Host>localhost</Host><Port>8843</Port></Opal>
+#
+
+import argparse
+import datetime
+import json
+import os
+import re
+import sys
+import time
+
+try:
+  from BaseHTTPServer import BaseHTTPRequestHandler, HTTPServer
+  from SocketServer import ThreadingMixIn
+  from urllib import quote, unquote
+  from urlparse import urlparse, parse_qs
+except ImportError:
+  from http.server import BaseHTTPRequestHandler, HTTPServer
+  from socketserver import ThreadingMixIn
+  from urllib.parse import quote, unquote, urlparse, parse_qs
+
+#
+# Parse arguments
+#
+parser = argparse.ArgumentParser(description='Local Opal stub server.')
+parser.add_argument('--port', '-p', type=int, default=8843, help='Port to listen on')
+parser.add_argument('--entities', '-e', type=int, default=1000, help='Number of synthetic entities')
+parser.add_argument('--latency', '-l', type=float, default=0.0, help='Latency added to every request (ms)')
+parser.add_argument('--page-size', '-s', type=int, default=0,
+  help='Maximum number of value sets returned per request (0 to honour the requested limit)')
+parser.add_argument('--replay', '-r', help='Directory of recorded responses to serve instead of synthetic data')
+parser.add_argument('--verbose', '-v', action='store_true', help='Log every request')
+args = parser.parse_args()
+
+#
+# Synthetic data
+#
+def identifier(index):
+  return 'A%06d' % (index + 1)
+
+def value(variable, index):
+  if variable.endswith('.user'):
+    return 'interviewer%d' % (index % 25)
+  elif variable.endswith('.timeStart'):
+    start = datetime.datetime(2012, 1, 1) + datetime.timedelta(minutes=37 * index)
+    return start.strftime('%Y-%m-%dT%H:%M:%S')
+  return '%s-%d' % (variable, index)
+
+def entities():
+  return [{'identifier': identifier(i), 'entityType': 'Participant'} for i in range(args.entities)]
+
+def selected_variable(query):
+  match = re.search(r"name\(\)\.eq\('([^']*)'\)", query.get('select', [''])[0])
+  return match.group(1) if match else 'value'
+
+def value_sets(query):
+  offset = int(query.get('offset', ['0'])[0])
+  limit = int(query.get('limit', ['100'])[0])
+  if 0 < args.page_size: limit = min(limit, args.page_size)
+  return value_set_list(selected_variable(query), range(offset, min(offset + limit, args.entities)))
+
+def value_set(entity, query):
+  match = re.match(r'A(\d+)$', entity)
+  if not match or not 0 < int(match.group(1)) <= args.entities: return None
+  return value_set_list(selected_variable(query), [int(match.group(1)) - 1])
+
+def value_set_list(variable, indices):
+  sets = []
+  for i in indices:
+    sets.append({'identifier': identifier(i), 'values': [{'value': value(variable, i)}]})
+  return {'variables': [variable], 'valueSets': sets}
+
+#
+# Request handler
+#
+class Handler(BaseHTTPRequestHandler):
+  def do_GET(self):
+    if 0 < args.latency: time.sleep(args.latency / 1000.0)
+
+    url = urlparse(self.path)
+    path = url.path[3:] if url.path.startswith('/ws') else url.path
+    body = None
+
+    if args.replay:
+      ws = path + ('?' + url.query if url.query else '')
+      filename = os.path.join(args.replay, quote(unquote(ws), safe='') + '.json')
+      if os.path.exists(filename):
+        f = open(filename, 'rb')
+        body = f.read()
+        f.close()
+    elif path.endswith('/entities'):
+      body = json.dumps(entities()).encode('utf-8')
+    elif path.endswith('/valueSets'):
+      body = json.dumps(value_sets(parse_qs(url.query))).encode('utf-8')
+    elif '/valueSet/' in path:
+      response = value_set(unquote(path.rsplit('/', 1)[1]), parse_qs(url.query))
+      if response is not None: body = json.dumps(response).encode('utf-8')
+
+    if body is None:
+      self.send_error(404)
+      return
+
+    self.send_response(200)
+    self.send_header('Content-Type', 'application/json')
+    self.send_header('Content-Length', str(len(body)))
+    self.end_headers()
+    self.wfile.write(body)
+
+  def log_message(self, format, *arguments):
+    if args.verbose: BaseHTTPRequestHandler.log_message(self, format, *arguments)
+
+class Server(ThreadingMixIn, HTTPServer):
+  daemon_threads = True
+
+#
+# Serve until interrupted
+#
+server = Server(('', args.port), Handler)
+sys.stderr.write('Opal stub listening on port %d\n' % args.port)
+try:
+  server.serve_forever()
+except KeyboardInterrupt:
+  pass
+finally:
+  server.server_close()
@@ -0,0 +1,7 @@
+-- -----------------------------------------------------
+-- Adds the (optional) columns caching the default window/level of each image
+-- to databases created before they were added to schema.sql
+-- -----------------------------------------------------
+ALTER TABLE `birch`.`Image`
+  ADD COLUMN `default_window` DOUBLE NULL AFTER `laterality` ,
+  ADD COLUMN `default_level` DOUBLE NULL AFTER `default_window` ;
@@ -0,0 +1,16 @@
+-- -----------------------------------------------------
+-- Adds the unique index on the image and user of each rating (used to write
+-- ratings in a single INSERT ... ON DUPLICATE KEY UPDATE statement) to databases
+-- created before it was added to schema.sql
+-- -----------------------------------------------------
+
+-- only the most recent of any duplicate ratings is kept
+DELETE older
+  FROM `birch`.`Rating` AS older
+  JOIN `birch`.`Rating` AS newer
+    ON older.`image_id` = newer.`image_id`
+   AND older.`user_id` = newer.`user_id`
+   AND older.`id` < newer.`id` ;
+
+ALTER TABLE `birch`.`Rating`
+  ADD UNIQUE INDEX `uq_image_id_user_id` (`image_id` ASC, `user_id` ASC) ;
@@ -0,0 +1,13 @@
+-- -----------------------------------------------------
+-- Adds the table recording the policy the review queue was last ranked by (so that
+-- it is applied again after the study database is updated) to databases created
+-- before it was added to schema.sql
+-- -----------------------------------------------------
+
+CREATE  TABLE IF NOT EXISTS `birch`.`ReviewQueue` (
+  `id` INT UNSIGNED NOT NULL AUTO_INCREMENT ,
+  `update_timestamp` TIMESTAMP NOT NULL ,
+  `create_timestamp` TIMESTAMP NOT NULL ,
+  `policy` VARCHAR(45) NOT NULL ,
+  PRIMARY KEY (`id`) )
+ENGINE = InnoDB;
@@ -0,0 +1,28 @@
+-- -----------------------------------------------------
+-- Adds the table used to lease studies to raters (so that raters working at the
+-- same time are given different studies) to databases created before it was added
+-- to schema.sql (claiming studies requires MySQL 8.0 or later)
+-- -----------------------------------------------------
+
+CREATE  TABLE IF NOT EXISTS `birch`.`StudyLease` (
+  `id` INT UNSIGNED NOT NULL AUTO_INCREMENT ,
+  `update_timestamp` TIMESTAMP NOT NULL ,
+  `create_timestamp` TIMESTAMP NOT NULL ,
+  `study_id` INT UNSIGNED NOT NULL ,
+  `user_id` INT UNSIGNED NOT NULL ,
+  `expiry` DATETIME NOT NULL ,
+  PRIMARY KEY (`id`) ,
+  UNIQUE INDEX `uq_study_id` (`study_id` ASC) ,
+  INDEX `fk_study_lease_user_id` (`user_id` ASC) ,
+  INDEX `dk_expiry` (`expiry` ASC) ,
+  CONSTRAINT `fk_study_lease_study_id`
+    FOREIGN KEY (`study_id` )
+    REFERENCES `birch`.`Study` (`id` )
+    ON DELETE NO ACTION
+    ON UPDATE NO ACTION,
+  CONSTRAINT `fk_study_lease_user_id`
+    FOREIGN KEY (`user_id` )
+    REFERENCES `birch`.`User` (`id` )
+    ON DELETE NO ACTION
+    ON UPDATE NO ACTION)
+ENGINE = InnoDB;
@@ -0,0 +1,9 @@
+-- -----------------------------------------------------
+-- Adds the review queue's rank (studies are reviewed in order of rank then uid) and
+-- the index used to find the next study in the queue to databases created before
+-- they were added to schema.sql
+-- -----------------------------------------------------
+
+ALTER TABLE `birch`.`Study`
+  ADD COLUMN `queue_rank` INT NOT NULL DEFAULT 0 AFTER `note` ,
+  ADD INDEX `dk_queue_rank_uid` (`queue_rank` ASC, `uid` ASC) ;
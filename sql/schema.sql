@@ -17,12 +17,14 @@ CREATE  TABLE IF NOT EXISTS `birch`.`Study` (
   `interviewer` VARCHAR(45) NOT NULL ,
   `datetime_acquired` DATETIME NOT NULL ,
   `note` TEXT NULL ,
+  `queue_rank` INT NOT NULL DEFAULT 0 ,
   PRIMARY KEY (`id`) ,
   INDEX `dk_uid` (`uid` ASC) ,
   INDEX `dk_site` (`site` ASC) ,
   INDEX `dk_datetime_acquired` (`datetime_acquired` ASC) ,
   INDEX `dk_interviewer` (`interviewer` ASC) ,
-  UNIQUE INDEX `uq_uid` (`uid` ASC) )
+  UNIQUE INDEX `uq_uid` (`uid` ASC) ,
+  INDEX `dk_queue_rank_uid` (`queue_rank` ASC, `uid` ASC) )
 ENGINE = InnoDB;
 
 
@@ -37,6 +39,8 @@ CREATE  TABLE IF NOT EXISTS `birch`.`Image` (
   `create_timestamp` TIMESTAMP NOT NULL ,
   `study_id` INT UNSIGNED NOT NULL ,
   `laterality` ENUM('left','right') NOT NULL ,
+  `default_window` DOUBLE NULL ,
+  `default_level` DOUBLE NULL ,
   PRIMARY KEY (`id`) ,
   INDEX `fk_study_id` (`study_id` ASC) ,
   CONSTRAINT `fk_image_study_id`
@@ -86,6 +90,7 @@ CREATE  TABLE IF NOT EXISTS `birch`.`Rating` (
   `rating` TINYINT(1) NULL ,
   PRIMARY KEY (`id`) ,
   INDEX `fk_rating_image_id` (`image_id` ASC) ,
+  UNIQUE INDEX `uq_image_id_user_id` (`image_id` ASC, `user_id` ASC) ,
   INDEX `fk_rating_user_id` (`user_id` ASC) ,
   INDEX `dk_rating` (`rating` ASC) ,
   CONSTRAINT `fk_rating_image_id`
@@ -101,6 +106,49 @@ CREATE  TABLE IF NOT EXISTS `birch`.`Rating` (
 ENGINE = InnoDB;
 
 
+-- -----------------------------------------------------
+-- Table `birch`.`StudyLease`
+-- -----------------------------------------------------
+DROP TABLE IF EXISTS `birch`.`StudyLease` ;
+
+CREATE  TABLE IF NOT EXISTS `birch`.`StudyLease` (
+  `id` INT UNSIGNED NOT NULL AUTO_INCREMENT ,
+  `update_timestamp` TIMESTAMP NOT NULL ,
+  `create_timestamp` TIMESTAMP NOT NULL ,
+  `study_id` INT UNSIGNED NOT NULL ,
+  `user_id` INT UNSIGNED NOT NULL ,
+  `expiry` DATETIME NOT NULL ,
+  PRIMARY KEY (`id`) ,
+  UNIQUE INDEX `uq_study_id` (`study_id` ASC) ,
+  INDEX `fk_study_lease_user_id` (`user_id` ASC) ,
+  INDEX `dk_expiry` (`expiry` ASC) ,
+  CONSTRAINT `fk_study_lease_study_id`
+    FOREIGN KEY (`study_id` )
+    REFERENCES `birch`.`Study` (`id` )
+    ON DELETE NO ACTION
+    ON UPDATE NO ACTION,
+  CONSTRAINT `fk_study_lease_user_id`
+    FOREIGN KEY (`user_id` )
+    REFERENCES `birch`.`User` (`id` )
+    ON DELETE NO ACTION
+    ON UPDATE NO ACTION)
+ENGINE = InnoDB;
+
+
+-- -----------------------------------------------------
+-- Table `birch`.`ReviewQueue`
+-- -----------------------------------------------------
+DROP TABLE IF EXISTS `birch`.`ReviewQueue` ;
+
+CREATE  TABLE IF NOT EXISTS `birch`.`ReviewQueue` (
+  `id` INT UNSIGNED NOT NULL AUTO_INCREMENT ,
+  `update_timestamp` TIMESTAMP NOT NULL ,
+  `create_timestamp` TIMESTAMP NOT NULL ,
+  `policy` VARCHAR(45) NOT NULL ,
+  PRIMARY KEY (`id`) )
+ENGINE = InnoDB;
+
+
 
 SET SQL_MODE=@OLD_SQL_MODE;
 SET FOREIGN_KEY_CHECKS=@OLD_FOREIGN_KEY_CHECKS;